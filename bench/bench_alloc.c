@@ -0,0 +1,77 @@
+/*
+ * Count allocator calls made while parsing large arrays of tables:
+ *
+ *   [[records]]
+ *   id = 1
+ *   name = "record-1"
+ *   tags = ["a", "b"]
+ */
+#include "../src/tomlc17.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static long g_ncall = 0;
+
+static void *counting_realloc(void *ptr, size_t size) {
+  g_ncall++;
+  return realloc(ptr, size);
+}
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate a document with n [[records]] entries. Caller must free.
+static char *gendoc(int n, int *ret_len) {
+  int max = n * 80 + 1;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = 0;
+  for (int i = 0; i < n; i++) {
+    len += snprintf(buf + len, max - len,
+                    "[[records]]\nid = %d\nname = \"record-%d\"\n"
+                    "tags = [\"a\", \"b\"]\n",
+                    i, i);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  toml_option_t opt = toml_default_option();
+  opt.mem_realloc = counting_realloc;
+  toml_set_option(opt);
+
+  printf("%10s %12s %12s %10s\n", "records", "alloc-calls", "calls/elem",
+         "parse-ms");
+  static const int nrec[] = {1000, 10000, 100000, 200000};
+  for (size_t i = 0; i < sizeof(nrec) / sizeof(nrec[0]); i++) {
+    int n = nrec[i];
+    int len;
+    char *doc = gendoc(n, &len);
+
+    g_ncall = 0;
+    double t0 = now();
+    toml_result_t result = toml_parse(doc, len);
+    double t1 = now();
+    if (!result.ok) {
+      error(result.errmsg);
+    }
+    printf("%10d %12ld %12.2f %10.1f\n", n, g_ncall, (double)g_ncall / n,
+           (t1 - t0) * 1e3);
+
+    toml_free(result);
+    free(doc);
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Measure cold-start loading: parse a big document with toml_parse(),
+ * and load its binary image with toml_load_binary(). Reports the best
+ * time of each, including one lookup.
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NSERVICE 100000 // sections per document
+#define NRUN 5          // report the best of NRUN loads
+#define IMGFILE "bench_binary.img"
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate NSERVICE sections. Caller must free.
+static char *gendoc(int *ret_len) {
+  int max = NSERVICE * 300 + 1000;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = sprintf(buf, "title = \"services\"\n");
+  for (int i = 0; i < NSERVICE; i++) {
+    len += sprintf(buf + len,
+                   "[service.s%d]\n"
+                   "host = \"host-%d.example.com\"\n"
+                   "port = %d\n"
+                   "weight = %d.5\n"
+                   "tags = [\"a\", \"b\", \"c\"]\n"
+                   "limits.cpu = %d\n"
+                   "limits.mem = \"%dMi\"\n",
+                   i, i, 1024 + i % 60000, i % 100, i % 16 + 1, i % 4096);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  int len;
+  char *src = gendoc(&len);
+  toml_result_t result = toml_parse(src, len);
+  if (!result.ok) {
+    error(result.errmsg);
+  }
+  if (toml_save_binary(&result, IMGFILE)) {
+    error("cannot save image");
+  }
+  toml_free(result);
+
+  printf("%10s %10s %10s\n", "mode", "MB", "ms");
+  for (int load = 0; load < 2; load++) {
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      double t0 = now();
+      result = load ? toml_load_binary(IMGFILE) : toml_parse(src, len);
+      if (!result.ok) {
+        error(result.errmsg);
+      }
+      toml_datum_t port = toml_seek(result.toptab, "service.s4242.port");
+      double t1 = now();
+      if (port.type != TOML_INT64 || port.u.int64 != 1024 + 4242) {
+        error("bad value");
+      }
+      toml_free(result);
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%10s %10.1f %10.3f\n", load ? "binary" : "parse", len / 1e6,
+           best * 1e3);
+  }
+  remove(IMGFILE);
+  free(src);
+  return 0;
+}
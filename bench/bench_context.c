@@ -0,0 +1,92 @@
+/*
+ * Parse many small documents, each with toml_parse_n() and with a
+ * reused toml_context_t. Reports the time and allocator calls per parse.
+ */
+#include "../src/tomlc17.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NDOC 100   // distinct payloads
+#define NPARSE 200 // parses of each payload
+
+static long g_ncall = 0;
+
+static void *counting_realloc(void *ptr, size_t size) {
+  g_ncall++;
+  return realloc(ptr, size);
+}
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate a small payload. Caller must free.
+static char *gendoc(int i, int *ret_len) {
+  int max = 1000;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  *ret_len = snprintf(buf, max,
+                      "route = \"/api/v%d/items\"\n"
+                      "timeout = %d\n"
+                      "retry.count = %d\n"
+                      "retry.backoff = %d.5\n"
+                      "[upstream]\n"
+                      "hosts = [\"a-%d:80\", \"b-%d:80\", \"c-%d:80\"]\n"
+                      "weight = [1, 2, 3]\n"
+                      "[headers]\n"
+                      "x-request-id = \"req-%d\"\n"
+                      "x-tenant = \"tenant-%d\"\n",
+                      i % 4, 100 + i, i % 5, i % 3, i, i, i, i, i % 17);
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  toml_option_t opt = toml_default_option();
+  opt.mem_realloc = counting_realloc;
+  toml_set_option(opt);
+
+  char *doc[NDOC];
+  int len[NDOC];
+  for (int i = 0; i < NDOC; i++) {
+    doc[i] = gendoc(i, &len[i]);
+  }
+
+  printf("%10s %12s %12s\n", "mode", "us/parse", "calls/parse");
+  for (int with = 0; with < 2; with++) {
+    toml_context_t *ctx = toml_context_new();
+    g_ncall = 0;
+    double t0 = now();
+    for (int n = 0; n < NPARSE; n++) {
+      for (int i = 0; i < NDOC; i++) {
+        toml_result_t result =
+            with ? toml_parse_with(ctx, doc[i], len[i])
+                 : toml_parse_n(doc[i], len[i]);
+        if (!result.ok) {
+          error(result.errmsg);
+        }
+        toml_free(result);
+        toml_context_reset(ctx);
+      }
+    }
+    double t1 = now();
+    printf("%10s %12.2f %12.2f\n", with ? "context" : "parse_n",
+           (t1 - t0) * 1e6 / (NPARSE * NDOC),
+           (double)g_ncall / (NPARSE * NDOC));
+    toml_context_free(ctx);
+  }
+
+  for (int i = 0; i < NDOC; i++) {
+    free(doc[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Measure toml_dump() and toml_to_json() throughput: parse a big document
+ * of [service.X] sections with strings, integers, floats and dates, and
+ * write it out to a writer that only counts bytes. Reports the best of
+ * NRUN dumps in each format.
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NSERVICE 100000 // sections per document
+#define NRUN 5          // report the best of NRUN dumps
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate NSERVICE sections. Caller must free.
+static char *gendoc(int *ret_len) {
+  int max = NSERVICE * 300 + 1000;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = sprintf(buf, "title = \"services\"\n");
+  for (int i = 0; i < NSERVICE; i++) {
+    len += sprintf(buf + len,
+                   "[service.s%d]\n"
+                   "host = \"host-%d.example.com\"\n"
+                   "port = %d\n"
+                   "weight = %.6g\n"
+                   "tags = [\"a\", \"b\\tc\", \"d\"]\n"
+                   "since = 2024-%02d-%02dT12:30:00Z\n"
+                   "limits.cpu = %d\n"
+                   "limits.mem = %d\n",
+                   i, i, 1024 + i % 60000, i / 7.0, i % 12 + 1, i % 28 + 1,
+                   i % 16 + 1, i * 4096);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int count(void *ctx, const char *buf, int len) {
+  (void)buf;
+  *(int64_t *)ctx += len;
+  return 0;
+}
+
+int main(void) {
+  int len;
+  char *src = gendoc(&len);
+  toml_result_t result = toml_parse(src, len);
+  if (!result.ok) {
+    error(result.errmsg);
+  }
+
+  static const char *const fmt[] = {"toml", "json", "json-typed"};
+  printf("%10s %10s %10s %10s\n", "format", "MB", "ms", "MB/s");
+  for (int f = 0; f < 3; f++) {
+    double best = 0;
+    int64_t nbyte = 0;
+    for (int run = 0; run < NRUN; run++) {
+      nbyte = 0;
+      double t0 = now();
+      int rc = (f == 0 ? toml_dump(result.toptab, count, &nbyte)
+                       : toml_to_json(result.toptab, count, &nbyte,
+                                      f == 1 ? TOML_JSON_COMPACT
+                                             : TOML_JSON_TYPED));
+      double t1 = now();
+      if (rc) {
+        error("dump failed");
+      }
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%10s %10.1f %10.1f %10.1f\n", fmt[f], nbyte / 1e6, best * 1e3,
+           nbyte / 1e6 / best);
+  }
+  toml_free(result);
+  free(src);
+  return 0;
+}
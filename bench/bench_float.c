@@ -0,0 +1,105 @@
+/*
+ * Measure float parsing: documents made mostly of floats, as arrays of
+ * 8 per line. Reports MB/s and millions of floats per second.
+ *
+ *   short  : few digits, e.g. 12.5, -0.375
+ *   full   : random doubles printed with 17 significant digits
+ *   sci    : scientific notation over the whole exponent range
+ *   money  : two decimals with underscores, e.g. 1_234_567.89
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NFLOAT (4 << 20) // floats per document
+#define NRUN 5           // report the best of NRUN parses
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+static uint64_t rnd(void) {
+  static uint64_t x = 88172645463325252ull; // xorshift64
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return x;
+}
+
+// Print one float of the given kind into buf. Return #bytes.
+static int genfloat(char *buf, int kind) {
+  switch (kind) {
+  case 0:
+    return sprintf(buf, "%s%d.%d", rnd() % 2 ? "-" : "", (int)(rnd() % 1000),
+                   (int)(rnd() % 1000));
+  case 1: {
+    double d = (double)(rnd() >> 11) / (double)(1ull << 53) * 1000;
+    return sprintf(buf, "%.17g", d + 1); // +1 keeps it out of exponent form
+  }
+  case 2: {
+    double m = 1 + (double)(rnd() >> 11) / (double)(1ull << 53) * 9;
+    return sprintf(buf, "%.15ge%d", m, (int)(rnd() % 600) - 300);
+  }
+  default: {
+    int n = rnd() % 10000000;
+    return sprintf(buf, "%d_%03d_%03d.%02d", n / 1000000 + 1, n / 1000 % 1000,
+                   n % 1000, (int)(rnd() % 100));
+  }
+  }
+}
+
+// Generate NFLOAT floats of a kind. Caller must free.
+static char *gendoc(int kind, int *ret_len) {
+  int max = NFLOAT * 40 + 1000;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = 0;
+  for (int i = 0; i < NFLOAT / 8; i++) {
+    len += sprintf(buf + len, "f%d = [", i);
+    for (int j = 0; j < 8; j++) {
+      len += genfloat(buf + len, kind);
+      buf[len++] = (j < 7 ? ',' : ']');
+    }
+    buf[len++] = '\n';
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  static const char *name[] = {"short", "full", "sci", "money"};
+  printf("%10s %10s %10s %12s\n", "doc", "MB", "MB/s", "Mfloat/s");
+  for (int kind = 0; kind < 4; kind++) {
+    int len;
+    char *src = gendoc(kind, &len);
+
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      double t0 = now();
+      toml_result_t result = toml_parse(src, len);
+      double t1 = now();
+      if (!result.ok) {
+        error(result.errmsg);
+      }
+      toml_free(result);
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%10s %10.1f %10.1f %12.1f\n", name[kind], len / 1e6,
+           len / 1e6 / best, NFLOAT / 1e6 / best);
+    free(src);
+  }
+  return 0;
+}
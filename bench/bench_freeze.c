@@ -0,0 +1,100 @@
+/*
+ * Measure toml_freeze() on tables of 1 to 16384 keys. Reports the time to
+ * freeze a table, per key, and the time per lookup of its keys before and
+ * after the freeze, with toml_get() and with toml_get_h(), which leaves
+ * out hashing the key.
+ */
+#include "../src/tomlc17.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAXKEY 16384
+#define NLOOKUP 200000 // lookups per run
+#define NRUN 50        // report the best of NRUN runs
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char key[MAXKEY][32];
+static int keylen[MAXKEY];
+static uint32_t keyhash[MAXKEY];
+
+// Return the best time of NRUN runs of NLOOKUP lookups of the n keys of
+// tab, per lookup, with toml_get_h() if hashed.
+static double lookup(toml_datum_t tab, int n, bool hashed) {
+  double best = 0;
+  for (int run = 0; run < NRUN; run++) {
+    int64_t sum = 0;
+    double t0 = now();
+    for (int i = 0, k = 0; i < NLOOKUP; i++) {
+      sum += (hashed ? toml_get_h(tab, key[k], keylen[k], keyhash[k])
+                     : toml_get(tab, key[k]))
+                 .u.int64;
+      k = (k + 7 < n ? k + 7 : (k + 7) % n);
+    }
+    double t1 = now();
+    if (sum < 0) {
+      error("bad value");
+    }
+    if (run == 0 || t1 - t0 < best) {
+      best = t1 - t0;
+    }
+  }
+  return best / NLOOKUP;
+}
+
+int main(void) {
+  static char src[MAXKEY * 48];
+  printf("%8s %10s %10s %10s %10s %10s %10s\n", "keys", "freeze-us",
+         "ns/key", "get", "frozen", "get_h", "frozen");
+  for (int n = 1; n <= MAXKEY; n *= 4) {
+    int len = sprintf(src, "[t]\n");
+    for (int i = 0; i < n; i++) {
+      keylen[i] = sprintf(key[i], "field_%d", i);
+      keyhash[i] = toml_hash(key[i], keylen[i]);
+      len += sprintf(src + len, "%s = %d\n", key[i], i);
+    }
+
+    double best = 0;
+    double get[4] = {0};
+    for (int run = 0; run < NRUN; run++) {
+      toml_result_t result = toml_parse(src, len);
+      if (!result.ok) {
+        error(result.errmsg);
+      }
+      toml_datum_t tab = toml_get(result.toptab, "t");
+      if (run == 0) {
+        get[0] = lookup(tab, n, false);
+        get[2] = lookup(tab, n, true);
+      }
+      double t0 = now();
+      if (toml_freeze(&result)) {
+        error("freeze failed");
+      }
+      double t1 = now();
+      if (run == 0) {
+        get[1] = lookup(tab, n, false);
+        get[3] = lookup(tab, n, true);
+      }
+      toml_free(result);
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%8d %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", n, best * 1e6,
+           best * 1e9 / n, get[0] * 1e9, get[1] * 1e9, get[2] * 1e9,
+           get[3] * 1e9);
+  }
+  return 0;
+}
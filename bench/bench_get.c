@@ -0,0 +1,77 @@
+/*
+ * Measure lookups in a table of 200 keys: toml_get() with NUL terminated
+ * keys, toml_get_n() with their lengths, and toml_get_h() with hashes
+ * computed once up front. Reports the time per lookup.
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NKEY 200 // keys in the table
+#define NLOOKUP 10000000
+#define NRUN 5 // report the best of NRUN runs
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char key[NKEY][32];
+static int keylen[NKEY];
+static uint32_t keyhash[NKEY];
+
+int main(void) {
+  static char src[NKEY * 64];
+  int len = sprintf(src, "[request]\n");
+  for (int i = 0; i < NKEY; i++) {
+    keylen[i] = sprintf(key[i], "header_field_%d", i);
+    keyhash[i] = toml_hash(key[i], keylen[i]);
+    len += sprintf(src + len, "%s = %d\n", key[i], i);
+  }
+  toml_result_t result = toml_parse(src, len);
+  if (!result.ok) {
+    error(result.errmsg);
+  }
+  toml_datum_t tab = toml_get(result.toptab, "request");
+
+  static const char *const mode[] = {"get", "get_n", "get_h"};
+  printf("%10s %10s %10s\n", "mode", "ms", "ns/lookup");
+  for (int m = 0; m < 3; m++) {
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      int64_t sum = 0;
+      double t0 = now();
+      for (int i = 0; i < NLOOKUP; i++) {
+        int k = (i * 7) % NKEY;
+        toml_datum_t d;
+        if (m == 0) {
+          d = toml_get(tab, key[k]);
+        } else if (m == 1) {
+          d = toml_get_n(tab, key[k], keylen[k]);
+        } else {
+          d = toml_get_h(tab, key[k], keylen[k], keyhash[k]);
+        }
+        sum += d.u.int64;
+      }
+      double t1 = now();
+      if (sum != (int64_t)NLOOKUP / NKEY * (NKEY - 1) * NKEY / 2) {
+        error("bad value");
+      }
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%10s %10.1f %10.1f\n", mode[m], best * 1e3, best * 1e9 / NLOOKUP);
+  }
+
+  toml_free(result);
+  return 0;
+}
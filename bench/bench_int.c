@@ -0,0 +1,109 @@
+/*
+ * Measure integer parsing: documents made mostly of integers, as arrays
+ * of 8 per line. Reports MB/s and millions of integers per second.
+ *
+ *   port   : 1 to 65535
+ *   id     : 8 to 12 digits, e.g. 1700000042
+ *   big    : around the int64 limits, signed
+ *   group  : underscores between groups, e.g. 1_234_567
+ *   hex    : 0x with 8 hex digits and an underscore, e.g. 0xdead_beef
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NINT (4 << 20) // integers per document
+#define NRUN 5           // report the best of NRUN parses
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+static uint64_t rnd(void) {
+  static uint64_t x = 88172645463325252ull; // xorshift64
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return x;
+}
+
+// Print one integer of the given kind into buf. Return #bytes.
+static int genint(char *buf, int kind) {
+  switch (kind) {
+  case 0:
+    return sprintf(buf, "%d", (int)(rnd() % 65535) + 1);
+  case 1:
+    return sprintf(buf, "%llu",
+                   (unsigned long long)(rnd() % 999990000000ull + 10000000));
+  case 2: {
+    unsigned long long n = rnd() % 1000000000000000000ull;
+    return sprintf(buf, "%s%llu", rnd() % 2 ? "-" : "",
+                   n + 8000000000000000000ull);
+  }
+  case 3: {
+    int n = rnd() % 1000000000;
+    return sprintf(buf, "%d_%03d_%03d", n / 1000000 + 1, n / 1000 % 1000,
+                   n % 1000);
+  }
+  default: {
+    unsigned n = (unsigned)rnd();
+    return sprintf(buf, "0x%04x_%04x", n >> 16, n & 0xffff);
+  }
+  }
+}
+
+// Generate NINT integers of a kind. Caller must free.
+static char *gendoc(int kind, int *ret_len) {
+  int max = NINT * 24 + 1000;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = 0;
+  for (int i = 0; i < NINT / 8; i++) {
+    len += sprintf(buf + len, "f%d = [", i);
+    for (int j = 0; j < 8; j++) {
+      len += genint(buf + len, kind);
+      buf[len++] = (j < 7 ? ',' : ']');
+    }
+    buf[len++] = '\n';
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  static const char *name[] = {"port", "id", "big", "group", "hex"};
+  printf("%10s %10s %10s %12s\n", "doc", "MB", "MB/s", "Mint/s");
+  for (int kind = 0; kind < 5; kind++) {
+    int len;
+    char *src = gendoc(kind, &len);
+
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      double t0 = now();
+      toml_result_t result = toml_parse(src, len);
+      double t1 = now();
+      if (!result.ok) {
+        error(result.errmsg);
+      }
+      toml_free(result);
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%10s %10.1f %10.1f %12.1f\n", name[kind], len / 1e6,
+           len / 1e6 / best, NINT / 1e6 / best);
+    free(src);
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Measure key interning on a big array of tables:
+ *
+ *   [[hosts]]
+ *   name = "host-1"
+ *   addr = "10.0.0.1"
+ *   port = 8001
+ *
+ * Reports the parse time, the bytes of key text in the tree, and the time
+ * per lookup of "port" in each table with toml_get(), toml_get_h() and
+ * toml_get_interned().
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NHOST 100000 // tables in the array
+#define NRUN 5       // report the best of NRUN runs
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate NHOST [[hosts]] tables. Caller must free.
+static char *gendoc(int *ret_len) {
+  int max = NHOST * 80 + 1;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = 0;
+  for (int i = 0; i < NHOST; i++) {
+    len += snprintf(buf + len, max - len,
+                    "[[hosts]]\nname = \"host-%d\"\naddr = \"10.0.%d.%d\"\n"
+                    "port = %d\n",
+                    i, i / 256 % 256, i % 256, 8000 + i % 1000);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  int len;
+  char *src = gendoc(&len);
+  double t0 = now();
+  toml_result_t result = toml_parse(src, len);
+  double t1 = now();
+  if (!result.ok) {
+    error(result.errmsg);
+  }
+  toml_datum_t hosts = toml_get(result.toptab, "hosts");
+  if (hosts.type != TOML_ARRAY || hosts.u.arr.size != NHOST) {
+    error("bad array");
+  }
+
+  // Add up the copies of the keys, counting a key that the previous table
+  // points to as well once.
+  size_t keybytes = 0;
+  for (int i = 0; i < NHOST; i++) {
+    toml_datum_t tab = hosts.u.arr.elem[i];
+    toml_datum_t prev = hosts.u.arr.elem[i ? i - 1 : 0];
+    for (int j = 0; j < tab.u.tab.size; j++) {
+      if (i == 0 || tab.u.tab.key[j] != prev.u.tab.key[j]) {
+        keybytes += tab.u.tab.len[j] + 1;
+      }
+    }
+  }
+  printf("%10s %10s %10s\n", "hosts", "parse-ms", "key-bytes");
+  printf("%10d %10.1f %10zu\n\n", NHOST, (t1 - t0) * 1e3, keybytes);
+
+  toml_key_t port = toml_intern(&result, "port", 4);
+  if (!port.ptr) {
+    error("port not interned");
+  }
+  static const char *const mode[] = {"get", "get_h", "get_interned"};
+  printf("%12s %10s %10s\n", "mode", "ms", "ns/lookup");
+  for (int m = 0; m < 3; m++) {
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      int64_t sum = 0;
+      double t2 = now();
+      for (int i = 0; i < NHOST; i++) {
+        toml_datum_t tab = hosts.u.arr.elem[i];
+        toml_datum_t d;
+        if (m == 0) {
+          d = toml_get(tab, "port");
+        } else if (m == 1) {
+          d = toml_get_h(tab, "port", 4, port.hash);
+        } else {
+          d = toml_get_interned(tab, port);
+        }
+        sum += d.u.int64;
+      }
+      double t3 = now();
+      if (sum != (int64_t)NHOST / 1000 * (8000 * 1000 + 999 * 1000 / 2)) {
+        error("bad value");
+      }
+      if (run == 0 || t3 - t2 < best) {
+        best = t3 - t2;
+      }
+    }
+    printf("%12s %10.2f %10.1f\n", mode[m], best * 1e3, best * 1e9 / NHOST);
+  }
+
+  toml_free(result);
+  free(src);
+  return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Measure lazy parsing: a big document of [service.X] sections, of which
+ * only one is read. Reports the time to parse the document and fetch
+ * one value, eagerly and with the lazy option.
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NSERVICE 200000 // sections per document
+#define NRUN 5          // report the best of NRUN parses
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate NSERVICE sections. Caller must free.
+static char *gendoc(int *ret_len) {
+  int max = NSERVICE * 300 + 1000;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = sprintf(buf, "title = \"services\"\n");
+  for (int i = 0; i < NSERVICE; i++) {
+    len += sprintf(buf + len,
+                   "[service.s%d]\n"
+                   "host = \"host-%d.example.com\"\n"
+                   "port = %d\n"
+                   "weight = %d.5\n"
+                   "tags = [\"a\", \"b\", \"c\"]\n"
+                   "limits.cpu = %d\n"
+                   "limits.mem = \"%dMi\"\n"
+                   "# comment with [brackets]\n",
+                   i, i, 1024 + i % 60000, i % 100, i % 16 + 1, i % 4096);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  int len;
+  char *src = gendoc(&len);
+  printf("%10s %10s %10s %10s\n", "mode", "MB", "ms", "MB/s");
+  for (int lazy = 0; lazy < 2; lazy++) {
+    toml_option_t opt = toml_default_option();
+    opt.lazy = lazy;
+    toml_set_option(opt);
+
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      double t0 = now();
+      toml_result_t result = toml_parse(src, len);
+      if (!result.ok) {
+        error(result.errmsg);
+      }
+      toml_datum_t port = toml_seek(result.toptab, "service.s4242.port");
+      double t1 = now();
+      if (port.type != TOML_INT64 || port.u.int64 != 1024 + 4242) {
+        error("bad value");
+      }
+      toml_free(result);
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%10s %10.1f %10.1f %10.1f\n", lazy ? "lazy" : "eager", len / 1e6,
+           best * 1e3, len / 1e6 / best);
+  }
+  free(src);
+  return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * Measure a small override merged onto a big base document of NSERVICE
+ * tables:
+ *
+ *   [service.svc-1]
+ *   host = "svc-1.example.com"
+ *   port = 9001
+ *   tags = ["a", "b", "c"]
+ *   ...
+ *
+ * The override changes the port of a few services and adds a table.
+ * Reports the time per merge with toml_merge(), which copies the base,
+ * and toml_merge_shared(), which points to it. Then the base and NLAYER
+ * such overrides are merged, in turn with toml_merge() and in one pass
+ * with toml_merge_many().
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NSERVICE 50000 // tables in the base
+#define NRUN 5         // report the best of NRUN runs
+#define NLAYER 5       // overrides on top of the base
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate the base document. Caller must free.
+static char *gendoc(int *ret_len) {
+  int max = NSERVICE * 200 + 1;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = 0;
+  for (int i = 0; i < NSERVICE; i++) {
+    len += snprintf(buf + len, max - len,
+                    "[service.svc-%d]\nhost = \"svc-%d.example.com\"\n"
+                    "port = %d\ntags = [\"a\", \"b\", \"c\"]\n"
+                    "owner = \"team-%d\"\nenabled = true\n",
+                    i, i, 9000 + i % 1000, i % 97);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  int len;
+  char *src = gendoc(&len);
+  toml_result_t base = toml_parse(src, len);
+  if (!base.ok) {
+    error(base.errmsg);
+  }
+  static char over[4096];
+  toml_result_t layer[NLAYER + 1];
+  const toml_result_t *layers[NLAYER + 1];
+  layer[0] = base;
+  layers[0] = &layer[0];
+  int olen = 0;
+  for (int k = 1; k <= NLAYER; k++) {
+    olen = 0;
+    for (int i = 0; i < NSERVICE; i += NSERVICE / 20) {
+      olen += sprintf(over + olen, "[service.svc-%d]\nport = %d%d\n", i + k,
+                      k, i);
+    }
+    olen += sprintf(over + olen, "[extra]\nname = \"override-%d\"\n", k);
+    layer[k] = toml_parse(over, olen);
+    if (!layer[k].ok) {
+      error(layer[k].errmsg);
+    }
+    layers[k] = &layer[k];
+  }
+  toml_result_t r2 = layer[1];
+
+  printf("%10s %10s %10s\n", "base-KB", "over-B", "services");
+  printf("%10d %10d %10d\n\n", len / 1024, olen, NSERVICE);
+  static const char *const mode[] = {"merge", "merge_shared"};
+  printf("%14s %10s\n", "mode", "ms");
+  for (int m = 0; m < 2; m++) {
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      double t0 = now();
+      toml_result_t r = m ? toml_merge_shared(&base, &r2)
+                          : toml_merge(&base, &r2);
+      double t1 = now();
+      if (!r.ok) {
+        error(r.errmsg);
+      }
+      if (toml_seek(r.toptab, "service.svc-1.port").u.int64 != 10) {
+        error("bad value");
+      }
+      toml_free(r);
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%14s %10.3f\n", mode[m], best * 1e3);
+  }
+
+  printf("\n%14s %10s\n", "layers", "ms");
+  static const char *const lmode[] = {"merge", "merge_many"};
+  for (int m = 0; m < 2; m++) {
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      double t0 = now();
+      toml_result_t r;
+      if (m) {
+        r = toml_merge_many(layers, NLAYER + 1);
+      } else {
+        r = toml_merge(&base, &layer[1]);
+        for (int k = 2; k <= NLAYER && r.ok; k++) {
+          toml_result_t next = toml_merge(&r, &layer[k]);
+          toml_free(r);
+          r = next;
+        }
+      }
+      double t1 = now();
+      if (!r.ok) {
+        error(r.errmsg);
+      }
+      if (toml_seek(r.toptab, "service.svc-5.port").u.int64 != 50) {
+        error("bad value");
+      }
+      toml_free(r);
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%14s %10.3f\n", lmode[m], best * 1e3);
+  }
+
+  for (int k = 1; k <= NLAYER; k++) {
+    toml_free(layer[k]);
+  }
+  toml_free(base);
+  free(src);
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Measure parallel parsing: an inventory of [[host]] entries and
+ * [service.X] sections. Reports MB/s of toml_parse_n() and of
+ * toml_parse_parallel() with 1, 2, 4 and 8 threads.
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NHOST 300000 // entries of each kind per document
+#define NRUN 5       // report the best of NRUN parses
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate the document. Caller must free.
+static char *gendoc(int *ret_len) {
+  int max = NHOST * 400 + 1000;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = sprintf(buf, "title = \"inventory\"\n");
+  for (int i = 0; i < NHOST; i++) {
+    len += sprintf(buf + len,
+                   "[[host]]\n"
+                   "name = \"host-%d.example.com\"\n"
+                   "ip = \"10.%d.%d.%d\"\n"
+                   "cores = %d\n"
+                   "load = %d.25\n"
+                   "tags = [\"rack-%d\", \"zone-%d\"]\n"
+                   "[host.disk]\n"
+                   "size = %d\n",
+                   i, i >> 16 & 255, i >> 8 & 255, i & 255, 1 << (i % 6),
+                   i % 100, i % 40, i % 4, 1000 + i % 9000);
+  }
+  for (int i = 0; i < NHOST; i++) {
+    len += sprintf(buf + len,
+                   "[service.s%d]\n"
+                   "port = %d\n"
+                   "owner = \"team-%d\"\n",
+                   i, 1024 + i % 60000, i % 50);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  int len;
+  char *src = gendoc(&len);
+  printf("%10s %10s %10s %10s\n", "threads", "MB", "MB/s", "speedup");
+  static const int nthreads[] = {0, 1, 2, 4, 8};
+  double base = 0;
+  for (int k = 0; k < 5; k++) {
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      double t0 = now();
+      toml_result_t result = nthreads[k]
+                                 ? toml_parse_parallel(src, len, nthreads[k])
+                                 : toml_parse_n(src, len);
+      double t1 = now();
+      if (!result.ok) {
+        error(result.errmsg);
+      }
+      toml_free(result);
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    base = (k == 0 ? best : base);
+    char name[20];
+    snprintf(name, sizeof(name), "%d", nthreads[k]);
+    printf("%10s %10.1f %10.1f %10.2f\n", nthreads[k] ? name : "serial",
+           len / 1e6, len / 1e6 / best, base / best);
+  }
+  free(src);
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Measure repeated lookups of a few dotted keys in a config of [service.X]
+ * sections: toml_seek() on every call vs a path compiled once with
+ * toml_path_compile() and evaluated with toml_path_eval(). Reports the
+ * time per lookup.
+ */
+#include "../src/tomlc17.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NSERVICE 1000 // sections per document
+#define NLOOKUP 2000000
+#define NRUN 5 // report the best of NRUN runs
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate NSERVICE sections. Caller must free.
+static char *gendoc(int *ret_len) {
+  int max = NSERVICE * 300 + 1000;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = sprintf(buf, "title = \"services\"\n");
+  for (int i = 0; i < NSERVICE; i++) {
+    len += sprintf(buf + len,
+                   "[service.s%d]\n"
+                   "host = \"host-%d.example.com\"\n"
+                   "port = %d\n"
+                   "weight = %d.5\n"
+                   "tags = [\"a\", \"b\", \"c\"]\n"
+                   "limits.cpu = %d\n"
+                   "limits.mem = \"%dMi\"\n",
+                   i, i, 1024 + i % 60000, i % 100, i % 16 + 1, i % 4096);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *const keys[] = {
+    "title",
+    "service.s42.port",
+    "service.s500.limits.cpu",
+    "service.s999.host",
+};
+#define NKEY (int)(sizeof(keys) / sizeof(keys[0]))
+
+int main(void) {
+  int len;
+  char *src = gendoc(&len);
+  toml_result_t result = toml_parse(src, len);
+  if (!result.ok) {
+    error(result.errmsg);
+  }
+  toml_path_t *path[NKEY];
+  for (int i = 0; i < NKEY; i++) {
+    path[i] = toml_path_compile(keys[i]);
+    if (!path[i]) {
+      error("toml_path_compile failed");
+    }
+  }
+
+  printf("%10s %10s %10s\n", "mode", "ms", "ns/lookup");
+  for (int compiled = 0; compiled < 2; compiled++) {
+    double best = 0;
+    for (int run = 0; run < NRUN; run++) {
+      int64_t sum = 0;
+      double t0 = now();
+      for (int i = 0; i < NLOOKUP; i++) {
+        int k = i % NKEY;
+        toml_datum_t d = compiled ? toml_path_eval(result.toptab, path[k])
+                                  : toml_seek(result.toptab, keys[k]);
+        sum += d.type;
+      }
+      double t1 = now();
+      if (sum == 0) {
+        error("bad value");
+      }
+      if (run == 0 || t1 - t0 < best) {
+        best = t1 - t0;
+      }
+    }
+    printf("%10s %10.1f %10.1f\n", compiled ? "path" : "seek", best * 1e3,
+           best * 1e9 / NLOOKUP);
+  }
+
+  for (int i = 0; i < NKEY; i++) {
+    toml_path_free(path[i]);
+  }
+  toml_free(result);
+  free(src);
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Measure parse throughput in MB/s on string-heavy documents: long
+ * basic, literal and multi-line strings, comments, indentation, and
+ * non-ASCII text. The last column has toml_option_t::check_utf8 on.
+ */
+#include "../src/tomlc17.h"
+#include <stdlib.h>
+#include <time.h>
+
+#define DOCSZ (32 << 20) // bytes per document
+#define NRUN 5           // report the best of NRUN parses
+
+static const char text[] = "Lorem ipsum dolor sit amet, consectetur "
+                           "adipiscing elit, sed do eiusmod tempor "
+                           "incididunt ut labore et dolore magna aliqua.";
+static const char utext[] = "Příliš žluťoučký kůň úpěl ďábelské ódy. "
+                            "いろはにほへと ちりぬるを わかよたれそ "
+                            "Съешь же ещё этих мягких французских булок";
+
+static void error(const char *msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  exit(1);
+}
+
+// Generate about DOCSZ bytes by repeating fmt, which takes the line
+// number and txt as arguments. Caller must free.
+static char *gendoc(const char *fmt, const char *txt, int *ret_len) {
+  int max = DOCSZ + 1024;
+  char *buf = malloc(max);
+  if (!buf) {
+    error("out of memory");
+  }
+  int len = 0;
+  for (int i = 0; len < DOCSZ; i++) {
+    len += snprintf(buf + len, max - len, fmt, i, txt);
+  }
+  *ret_len = len;
+  return buf;
+}
+
+static double now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Return the best time of NRUN parses of src[].
+static double timeit(const char *src, int len, bool check_utf8) {
+  toml_option_t opt = toml_default_option();
+  opt.check_utf8 = check_utf8;
+  toml_set_option(opt);
+
+  double best = 0;
+  for (int run = 0; run < NRUN; run++) {
+    double t0 = now();
+    toml_result_t result = toml_parse(src, len);
+    double t1 = now();
+    if (!result.ok) {
+      error(result.errmsg);
+    }
+    toml_free(result);
+    if (run == 0 || t1 - t0 < best) {
+      best = t1 - t0;
+    }
+  }
+  return best;
+}
+
+int main(void) {
+  static const struct {
+    const char *name;
+    const char *fmt;
+    const char *txt;
+  } doc[] = {
+      {"string", "k%d = \"%s\"\n", text},
+      {"litstring", "k%d = '%s'\n", text},
+      {"mlstring", "k%d = \"\"\"\n%s\n\"\"\"\n", text},
+      {"comment", "# %d %s\n", text},
+      {"indent", "[t%d]\n                a = '%s'\n", text},
+      {"unicode", "k%d = \"%s\"\n", utext},
+  };
+
+  printf("%10s %10s %10s %10s\n", "doc", "MB", "MB/s", "utf8-MB/s");
+  for (size_t i = 0; i < sizeof(doc) / sizeof(doc[0]); i++) {
+    int len;
+    char *src = gendoc(doc[i].fmt, doc[i].txt, &len);
+    double t = timeit(src, len, false);
+    double tu = timeit(src, len, true);
+    printf("%10s %10.1f %10.1f %10.1f\n", doc[i].name, len / 1e6,
+           len / 1e6 / t, len / 1e6 / tu);
+    free(src);
+  }
+  return 0;
+}
@@ -166,7 +166,9 @@ toml_bind_result_t toml_binder_bind(const toml_binder_t* binder, toml_datum_t da
                       SP_FMT_U64(value.type));
         return result;
       }
-      *(sp_str_t*)field_ptr = sp_str_view(value.u.s);
+      // View by length: with borrow_src the string is not NUL terminated.
+      *(sp_str_t*)field_ptr =
+          (sp_str_t){.data = value.u.str.ptr, .len = (u32)value.u.str.len};
       break;
     }
 
@@ -225,7 +227,8 @@ toml_bind_result_t toml_binder_bind(const toml_binder_t* binder, toml_datum_t da
                         SP_FMT_S64(j), SP_FMT_U64(elem.type));
           return result;
         }
-        sp_dyn_array_push(*array_ptr, sp_str_view(elem.u.s));
+        sp_str_t str = {.data = elem.u.str.ptr, .len = (u32)elem.u.str.len};
+        sp_dyn_array_push(*array_ptr, str);
       }
       break;
     }
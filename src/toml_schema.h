@@ -145,6 +145,12 @@ void toml_schema_set_root(toml_schema_t* schema, toml_schema_rule_t* root);
 #include <stddef.h>
 #include <string.h>
 
+// Keys and strings of a result parsed with borrow_src point into the
+// source text and are not NUL terminated, so always view them by length.
+static sp_str_t str_view_n(const c8* ptr, int len) {
+  return (sp_str_t){.data = ptr, .len = (u32)len};
+}
+
 static void add_error(sp_da(toml_schema_error_t) * errors, sp_str_t path, sp_str_t message) {
   toml_schema_error_t error = SP_ZERO_INITIALIZE();
   error.path = path;
@@ -202,7 +208,7 @@ static void validate_string(const toml_schema_string_rule_t* rule, toml_datum_t
                             sp_str_t path, sp_da(toml_schema_error_t) * errors) {
   SP_ASSERT(data.type == TOML_STRING);
 
-  sp_str_t value = sp_str_view(data.u.s);
+  sp_str_t value = str_view_n(data.u.str.ptr, data.u.str.len);
 
   if (rule->has_min_length && value.len < rule->min_length) {
     sp_str_t msg = sp_format("string length {} is less than minimum {}", SP_FMT_U64(value.len),
@@ -312,8 +318,10 @@ static void validate_table(const toml_schema_table_rule_t* rule, toml_datum_t da
   sp_ht_set_fns(seen_properties, sp_ht_on_hash_str_key, sp_ht_on_compare_str_key);
 
   for (s32 i = 0; i < data.u.tab.size; i++) {
-    sp_str_t key = sp_str_view(data.u.tab.key[i]);
-    toml_datum_t value = data.u.tab.value[i];
+    sp_str_t key = str_view_n(data.u.tab.key[i], data.u.tab.len[i]);
+    // Look the value up rather than read value[i]: toml_get_n() loads the
+    // sections of a lazy result.
+    toml_datum_t value = toml_get_n(data, key.data, (int)key.len);
 
     sp_str_t prop_path = sp_str_empty(path) ? key : sp_format("{}.{}", SP_FMT_STR(path), SP_FMT_STR(key));
 
@@ -577,7 +585,7 @@ static toml_schema_rule_t* parse_schema_rule(toml_datum_t rule_data) {
     return toml_schema_any();
   }
 
-  toml_schema_type_t type = parse_type(sp_str_view(type_datum.u.s));
+  toml_schema_type_t type = parse_type(str_view_n(type_datum.u.str.ptr, type_datum.u.str.len));
   toml_schema_rule_t* rule = SP_NULLPTR;
 
   switch (type) {
@@ -610,8 +618,9 @@ static toml_schema_rule_t* parse_schema_rule(toml_datum_t rule_data) {
     if (enum_datum.type == TOML_ARRAY) {
       sp_da(sp_str_t) enum_values = SP_NULLPTR;
       for (s32 i = 0; i < enum_datum.u.arr.size; i++) {
-        if (enum_datum.u.arr.elem[i].type == TOML_STRING) {
-          sp_dyn_array_push(enum_values, sp_str_copy(sp_str_view(enum_datum.u.arr.elem[i].u.s)));
+        toml_datum_t elem = enum_datum.u.arr.elem[i];
+        if (elem.type == TOML_STRING) {
+          sp_dyn_array_push(enum_values, sp_str_copy(str_view_n(elem.u.str.ptr, elem.u.str.len)));
         }
       }
       toml_schema_enum(rule, enum_values);
@@ -653,10 +662,10 @@ static toml_schema_rule_t* parse_schema_rule(toml_datum_t rule_data) {
     }
   } else if (type == TOML_SCHEMA_TABLE) {
     for (s32 i = 0; i < rule_data.u.tab.size; i++) {
-      const c8* key = rule_data.u.tab.key[i];
-      if (key[0] != '$') {
-        sp_str_t prop_key = sp_str_copy(sp_str_view(key));
-        toml_datum_t prop_schema = rule_data.u.tab.value[i];
+      sp_str_t key = str_view_n(rule_data.u.tab.key[i], rule_data.u.tab.len[i]);
+      if (key.len == 0 || key.data[0] != '$') {
+        sp_str_t prop_key = sp_str_copy(key);
+        toml_datum_t prop_schema = toml_get_n(rule_data, key.data, (int)key.len);
         toml_schema_rule_t* property = parse_schema_rule(prop_schema);
         toml_schema_add_property(rule, prop_key, property);
       }
@@ -1,11 +1,16 @@
 /* Copyright (c) 2024-2025, CK Tan.
  * https://github.com/cktan/tomlc17/blob/main/LICENSE
  */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // for mmap(), madvise() and MAP_POPULATE
+#endif
 #include "tomlc17.h"
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <float.h>
 #include <limits.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -13,13 +18,58 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define HAVE_PTHREAD 1
+#endif
+
+// Vector kernels for the scanner. AVX2 and SSSE3 need -mavx2, -mssse3
+// (or -march=...); SSE2 is always there on x86-64. Other targets use the
+// scalar loops.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#define HAVE_SSSE3 1
+#define HAVE_SSE2 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define HAVE_SSSE3 1
+#define HAVE_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
 const toml_datum_t DATUM_ZERO = {0};
 
-static toml_option_t toml_option = {0, realloc, free};
+static toml_option_t toml_option = {0, realloc, free, 0, 0, 0, 0, 0, 0};
+
+// Allocate with the allocator of the options opt.
+static inline void *opt_realloc(const toml_option_t *opt, void *p, size_t n) {
+  return opt->mem_realloc_ex ? opt->mem_realloc_ex(opt->mem_user, p, n)
+                             : opt->mem_realloc(p, n);
+}
+
+static inline void opt_free(const toml_option_t *opt, void *p) {
+  if (opt->mem_realloc_ex) {
+    opt->mem_free_ex(opt->mem_user, p);
+  } else {
+    opt->mem_free(p);
+  }
+}
 
-#define MALLOC(n) toml_option.mem_realloc(0, n)
-#define REALLOC(p, n) toml_option.mem_realloc(p, n)
-#define FREE(p) toml_option.mem_free(p)
+#define MALLOC(opt, n) opt_realloc(opt, 0, n)
+#define REALLOC(opt, p, n) opt_realloc(opt, p, n)
+#define FREE(opt, p) opt_free(opt, p)
 
 #define DO(x)                                                                  \
   if (x)                                                                       \
@@ -54,36 +104,49 @@ static int RETERROR(ebuf_t ebuf, int lineno, const char *fmt, ...) {
 }
 
 /*
- *  Memory pool. Allocated a big block once and hand out piecemeal.
+ *  Memory pool. Allocated a big block once and hand out piecemeal. If
+ *  the block runs out, spill into extra blocks that double in size.
  */
 typedef struct pool_t pool_t;
 struct pool_t {
   int top, max;
-  char buf[1]; // first byte starts here
+  pool_t *more;             // spill blocks, newest first; NULL if none
+  const toml_option_t *opt; // allocator
+  char buf[1];              // first byte starts here
 };
 
 /**
- *  Create a memory pool of N bytes. Return the memory pool on
- *  success, or NULL if out of memory.
+ *  Create a memory pool of N bytes, allocated with opt, which must
+ *  outlive it. Return the memory pool on success, or NULL if out of
+ *  memory.
  */
-static pool_t *pool_create(int N) {
+static pool_t *pool_create(const toml_option_t *opt, int N) {
   if (N <= 0) {
     N = 100; // minimum
   }
   int totalsz = sizeof(pool_t) + N;
-  pool_t *pool = MALLOC(totalsz);
+  pool_t *pool = MALLOC(opt, totalsz);
   if (!pool) {
     return NULL;
   }
-  memset(pool, 0, totalsz);
+  // Do not touch buf[]; pages of a big pool are only faulted in as used.
+  pool->top = 0;
   pool->max = N;
+  pool->more = NULL;
+  pool->opt = opt;
   return pool;
 }
 
 /**
  *  Destroy a memory pool.
  */
-static void pool_destroy(pool_t *pool) { FREE(pool); }
+static void pool_destroy(pool_t *pool) {
+  while (pool) {
+    pool_t *next = pool->more;
+    FREE(pool->opt, pool);
+    pool = next;
+  }
+}
 
 /**
  *  Allocate n bytes from pool. Return the memory allocated on
@@ -91,13 +154,293 @@ static void pool_destroy(pool_t *pool) { FREE(pool); }
  */
 static char *pool_alloc(pool_t *pool, int n) {
   if (pool->top + n > pool->max) {
-    return NULL;
+    // Spill into the newest block; add a bigger one if that is full too.
+    pool_t *blk = pool->more;
+    if (!blk || blk->top + n > blk->max) {
+      int N = (blk ? blk->max : pool->max);
+      N = (N < INT_MAX / 4 ? N * 2 : INT_MAX / 2);
+      blk = pool_create(pool->opt, N > n ? N : n);
+      if (!blk) {
+        return NULL;
+      }
+      blk->more = pool->more;
+      pool->more = blk;
+    }
+    pool = blk;
   }
   char *ret = pool->buf + pool->top;
   pool->top += n;
   return ret;
 }
 
+/*
+ *  A position in a pool. Rewinding to it releases everything allocated
+ *  after it was taken.
+ */
+typedef struct pool_mark_t pool_mark_t;
+struct pool_mark_t {
+  pool_t *more; // newest spill block
+  int top;      // top of the first block
+  int moretop;  // top of more, if any
+};
+
+static pool_mark_t pool_mark(pool_t *pool) {
+  pool_mark_t mark = {pool->more, pool->top, 0};
+  mark.moretop = pool->more ? pool->more->top : 0;
+  return mark;
+}
+
+static void pool_rewind(pool_t *pool, pool_mark_t mark) {
+  while (pool->more != mark.more) {
+    pool_t *blk = pool->more;
+    pool->more = blk->more;
+    FREE(pool->opt, blk);
+  }
+  pool->top = mark.top;
+  if (mark.more) {
+    mark.more->top = mark.moretop;
+  }
+}
+
+/**
+ *  Return #bytes allocated from pool.
+ */
+static int pool_used(const pool_t *pool) {
+  int n = 0;
+  for (; pool; pool = pool->more) {
+    n += pool->top;
+  }
+  return n;
+}
+
+/**
+ *  Release everything allocated from pool, keeping a single block with
+ *  room for at least N bytes and for as much as was allocated. Return
+ *  the pool, which may have moved. If out of memory, the old first block
+ *  is kept instead.
+ */
+static pool_t *pool_reset(pool_t *pool, int N) {
+  int used = pool_used(pool);
+  N = (N < used ? used : N);
+  pool_rewind(pool, (pool_mark_t){0});
+  if (pool->max < N) {
+    pool_t *tmp = pool_create(pool->opt, N);
+    if (tmp) {
+      pool_destroy(pool);
+      pool = tmp;
+    }
+  }
+  return pool;
+}
+
+/*
+ *  Arena. A list of chunks that hand out memory piecemeal. Memory is
+ *  released all at once when the arena is destroyed.
+ */
+typedef struct arena_chunk_t arena_chunk_t;
+struct arena_chunk_t {
+  arena_chunk_t *next; // previously filled chunk
+  char *buf;           // 8-byte aligned; follows this header
+  size_t top, max;     // bytes used and available in buf[]
+};
+
+typedef struct arena_t arena_t;
+struct arena_t {
+  arena_chunk_t *chunk;     // current chunk
+  char *last;               // the most recent allocation
+  const toml_option_t *opt; // allocator
+};
+
+#define ARENA_CHUNK_MIN 4096
+
+static inline size_t align8(size_t x) { return (x + 7) & ~(size_t)7; }
+
+/**
+ *  Add a chunk with room for N bytes to the arena. Return 0 on
+ *  success, or -1 if out of memory.
+ */
+static int arena_grow(arena_t *arena, size_t N) {
+  size_t hdrsz = align8(sizeof(arena_chunk_t));
+  arena_chunk_t *chunk = MALLOC(arena->opt, hdrsz + N);
+  if (!chunk) {
+    return -1;
+  }
+  chunk->next = arena->chunk;
+  chunk->buf = (char *)chunk + hdrsz;
+  chunk->top = 0;
+  chunk->max = N;
+  arena->chunk = chunk;
+  return 0;
+}
+
+/**
+ *  Create an arena whose first chunk has room for N bytes, allocated
+ *  with opt, which must outlive it. Return the arena on success, or NULL
+ *  if out of memory.
+ */
+static arena_t *arena_create(const toml_option_t *opt, size_t N) {
+  arena_t *arena = MALLOC(opt, sizeof(*arena));
+  if (!arena) {
+    return NULL;
+  }
+  memset(arena, 0, sizeof(*arena));
+  arena->opt = opt;
+  if (arena_grow(arena, N < ARENA_CHUNK_MIN ? ARENA_CHUNK_MIN : align8(N))) {
+    FREE(opt, arena);
+    return NULL;
+  }
+  return arena;
+}
+
+/**
+ *  Destroy an arena and all memory allocated from it.
+ */
+static void arena_destroy(arena_t *arena) {
+  if (!arena) {
+    return;
+  }
+  arena_chunk_t *chunk = arena->chunk;
+  while (chunk) {
+    arena_chunk_t *next = chunk->next;
+    FREE(arena->opt, chunk);
+    chunk = next;
+  }
+  FREE(arena->opt, arena);
+}
+
+/**
+ *  Allocate n bytes, 8-byte aligned, from arena. Return the memory
+ *  allocated on success, or NULL if out of memory.
+ */
+static void *arena_alloc(arena_t *arena, size_t n) {
+  n = align8(n);
+  arena_chunk_t *chunk = arena->chunk;
+  if (chunk->top + n > chunk->max) {
+    // Start a new chunk, doubling in size each time.
+    size_t max = chunk->max * 2;
+    if (arena_grow(arena, max < n ? n : max)) {
+      return NULL;
+    }
+    chunk = arena->chunk;
+  }
+  char *ret = chunk->buf + chunk->top;
+  chunk->top += n;
+  arena->last = ret;
+  return ret;
+}
+
+/**
+ *  Resize an allocation of oldn bytes at p to n bytes. The most recent
+ *  allocation is resized in place if it fits. Return the new memory on
+ *  success, or NULL if out of memory.
+ */
+static void *arena_realloc(arena_t *arena, void *p, size_t oldn, size_t n) {
+  if (p && p == arena->last) {
+    arena_chunk_t *chunk = arena->chunk;
+    size_t off = (char *)p - chunk->buf;
+    if (off + align8(n) <= chunk->max) {
+      chunk->top = off + align8(n);
+      return p;
+    }
+  }
+  void *q = arena_alloc(arena, n);
+  if (q && p) {
+    memcpy(q, p, oldn < n ? oldn : n);
+  }
+  return q;
+}
+
+/**
+ *  Release everything allocated from arena, keeping a single chunk with
+ *  room for as much as was allocated. If out of memory, the newest (and
+ *  biggest) chunk is kept instead.
+ */
+static void arena_reset(arena_t *arena) {
+  arena_chunk_t *chunk = arena->chunk;
+  size_t used = 0;
+  for (arena_chunk_t *p = chunk; p; p = p->next) {
+    used += p->top;
+  }
+  while (chunk->next) {
+    arena_chunk_t *next = chunk->next;
+    chunk->next = next->next;
+    FREE(arena->opt, next);
+  }
+  if (chunk->max < used && 0 == arena_grow(arena, align8(used))) {
+    arena->chunk->next = NULL;
+    FREE(arena->opt, chunk);
+  }
+  arena->chunk->top = 0;
+  arena->last = NULL;
+}
+
+/*
+ *  Memory owned by a toml_result_t. toml_result_t::__internal points to
+ *  one of these. Strings are allocated from pool. Tables and arrays are
+ *  allocated from the heap, or from arena in arena mode, in which case
+ *  they are released all at once.
+ *
+ *  With toml_option_t::borrow_src, escape-free strings and keys point
+ *  into the source text instead of pool, and borrow records where that
+ *  is. If the source was read by tomlc17 itself, the result owns it via
+ *  srcbuf or srcmap and releases it with the rest.
+ *
+ *  With toml_option_t::lazy, the sections not parsed yet are kept in
+ *  lazy_t records, which the memory also owns. toml_parse_parallel()
+ *  gives each thread a memory of its own and chains them on next.
+ *
+ *  Each distinct key is stored once per memory: keys holds the
+ *  canonical copies, as the keys of a table whose values are unused, and
+ *  the tree points to them. Equal keys of one result are thus equal
+ *  pointers.
+ *
+ *  A toml_context_t keeps one memory for all the results parsed with it,
+ *  and reuses it after toml_context_reset(); toml_free() leaves it alone.
+ *
+ *  toml_merge_shared() gives its result the subtrees of r1 that r2 does
+ *  not touch, flagged FLAG_SHARED where the result points to them. Its
+ *  memory keeps that of r1 as base, and looks up keys there before
+ *  interning its own. base->nshare counts the results holding base;
+ *  whichever of them is freed last releases it, with the tree in top.
+ *
+ *  The memory keeps a copy of the options it was made with, so that all
+ *  of it is allocated and released with the same allocator.
+ */
+typedef struct lazy_t lazy_t;
+typedef struct mem_t mem_t;
+struct mem_t {
+  pool_t *pool;       // strings
+  arena_t *arena;     // tables and arrays in arena mode; NULL otherwise
+  const char *borrow; // src[] that strings may point into; NULL otherwise
+  char *srcbuf;       // heap copy of src[] owned by the result, or NULL
+  void *srcmap;       // mmap of src[] owned by the result, or NULL
+  size_t srcmaplen;
+  lazy_t *lazy;      // list of lazy sections
+  toml_datum_t keys; // the interned keys
+  mem_t *next;       // more memory of the same result
+  mem_t *base;       // memory this one shares subtrees with, or NULL
+  int nshare;        // results holding this memory besides its own
+  toml_datum_t top;  // tree of the result, once it is freed while shared
+  bool kept;    // owned by a toml_context_t rather than by the result
+  bool image;   // the tree is a binary image in srcmap or srcbuf
+  toml_option_t opt;
+};
+
+static inline void *mem_alloc(mem_t *mem, size_t n) {
+  return mem->arena ? arena_alloc(mem->arena, n) : MALLOC(&mem->opt, n);
+}
+
+static inline void *mem_realloc(mem_t *mem, void *p, size_t oldn, size_t n) {
+  return mem->arena ? arena_realloc(mem->arena, p, oldn, n)
+                    : REALLOC(&mem->opt, p, n);
+}
+
+static inline void mem_free(mem_t *mem, void *p) {
+  if (!mem->arena) {
+    FREE(&mem->opt, p);
+  }
+}
+
 /* This is a string view. */
 typedef struct span_t span_t;
 struct span_t {
@@ -115,19 +458,22 @@ struct keypart_t {
 
 static int utf8_to_ucs(const char *s, int len, uint32_t *ret);
 static int ucs_to_utf8(uint32_t code, char buf[4]);
+static int parse_decimal(const char *p, const char *endp, double *ret);
+static int shortest_digits(double x, char dig[17], int *ret_e10);
+static const char *scan_blank(const char *p, const char *endp);
 
 // flags for toml_datum_t::flag.
 #define FLAG_INLINED 1
 #define FLAG_STDEXPR 2
 #define FLAG_EXPLICIT 4
+#define FLAG_LAZY 8    // placeholder of a section not parsed yet
+#define FLAG_SHARED 16 // points to a subtree of another result
 
 // Maximum levels of brackets and braces to prevent
 // stack overflow during recursive descent of the parser.
 #define BRACKET_LEVEL_MAX 30
 #define BRACE_LEVEL_MAX 30
 
-static inline size_t align8(size_t x) { return (((x) + 7) & ~7); }
-
 enum toktyp_t {
   TOK_DOT = 1,
   TOK_EQUAL,
@@ -186,8 +532,8 @@ struct token_t {
 
 // Scanner object
 struct scanner_t {
-  const char *src;  // src[] is a NUL-terminated string
-  const char *endp; // end of src[]. always pointing at a NUL char.
+  const char *src;  // src[]
+  const char *endp; // end of src[]. never dereferenced.
   const char *cur;  // current char in src[]
   int lineno;       // line number of current char
   char *errmsg;     // point to errbuf if there was an error
@@ -195,9 +541,10 @@ struct scanner_t {
 
   int bracket_level;  // count depth of [ ] 
   int brace_level;  // count depth of { }
+  bool check_utf8;  // validate string and comment bodies
 };
 static void scan_init(scanner_t *sp, const char *src, int len, char *errbuf,
-                      int errbufsz);
+                      int errbufsz, bool check_utf8);
 static int scan_key(scanner_t *sp, token_t *tok);
 static int scan_value(scanner_t *sp, token_t *tok);
 // restore scanner to state before tok was returned
@@ -210,50 +557,280 @@ struct parser_t {
   scanner_t scanner;
   toml_datum_t toptab;  // top table
   toml_datum_t *curtab; // current table
-  pool_t *pool;         // memory pool for strings
+  mem_t *mem;           // memory for strings, tables and arrays
   ebuf_t ebuf;
+  const toml_option_t *opt; // options of this parse
+
+  // In SAX mode, the tree only keeps what the duplicate and redefinition
+  // checks need, and values are reported to the handler instead.
+  const toml_sax_handler_t *sax; // NULL if building a tree
+  void *saxctx;
+
+  keypart_t hdrkey; // key of the last table header, for lazy parsing
 };
 
-static toml_datum_t *tab_emplace(toml_datum_t *tab, span_t key,
-                                 const char **reason) {
-  assert(tab->type == TOML_TABLE);
-  int N = tab->u.tab.size;
-  for (int i = 0; i < N; i++) {
-    if (tab->u.tab.len[i] == key.len &&
-        0 == memcmp(tab->u.tab.key[i], key.ptr, key.len)) {
-      return &tab->u.tab.value[i];
-    }
+/*
+ *  Every u.tab.key[] allocated by tomlc17 is preceded by a tabmeta_t.
+ *  It records the capacity of key[], len[] and value[], which grow
+ *  geometrically. Once a table has TAB_INDEX_MIN keys, the header also
+ *  carries an open-addressing hash index into key[] so that lookups and
+ *  duplicate checks do not need a linear scan. Each slot keeps the hash
+ *  of its key, so a probe only reads key[] when the hashes match. The
+ *  index is kept after parsing.
+ *
+ *  toml_freeze() replaces an index by a minimal perfect hash (hash and
+ *  displace): the keys fall into FROZEN_NBUCKET(n) buckets by hash, and
+ *  each bucket has a displacement that sends its keys to distinct slots
+ *  of n, one per key. A lookup then probes a single slot.
+ */
+typedef struct tabslot_t tabslot_t;
+struct tabslot_t {
+  int32_t idx;   // 1 + an index into key[], or 0 if empty
+  uint32_t hash; // hash_key() of the key
+};
+
+typedef struct tabmeta_t tabmeta_t;
+struct tabmeta_t {
+  int32_t cap;     // #entries allocated in key[], len[] and value[]
+  int32_t nslot;   // #entries in slot[]; a power of 2, or 0 if not indexed
+  tabslot_t *slot; // slot[nslot]
+  uint32_t *disp;  // disp[FROZEN_NBUCKET(nslot)] if frozen; NULL otherwise
+};
+
+/*
+ *  Every u.arr.elem[] allocated by tomlc17 is preceded by an arrmeta_t
+ *  recording its capacity.
+ */
+typedef struct arrmeta_t arrmeta_t;
+struct arrmeta_t {
+  int32_t cap;   // #entries allocated in elem[]
+  int32_t spare; // keeps elem[] 8-byte aligned
+};
+
+#define TAB_INDEX_MIN 16
+#define CAPACITY_MIN 4
+
+// Return the header of a table's key[], or NULL if key[] is not allocated.
+static inline tabmeta_t *tab_meta(const toml_datum_t *tab) {
+  return tab->u.tab.key ? (tabmeta_t *)tab->u.tab.key - 1 : NULL;
+}
+
+// Return the header of an array's elem[], or NULL if elem[] is not allocated.
+static inline arrmeta_t *arr_meta(const toml_datum_t *arr) {
+  return arr->u.arr.elem ? (arrmeta_t *)arr->u.arr.elem - 1 : NULL;
+}
+
+// Return the capacity to grow to from cap in order to hold n entries.
+static inline int grow_capacity(int cap, int n) {
+  cap = (cap < CAPACITY_MIN ? CAPACITY_MIN : cap);
+  while (cap < n) {
+    cap = (cap > INT_MAX / 2 ? INT_MAX : cap * 2);
   }
-  // Expand pkey[], plen[] and value[]
-  {
-    char **pkey = REALLOC(tab->u.tab.key, sizeof(*pkey) * align8(N + 1));
-    if (!pkey) {
-      *reason = "out of memory";
-      FREE(pkey);
-      return NULL;
+  return cap;
+}
+
+// FNV-1a hash of a key.
+static inline uint32_t hash_key(const char *key, int len) {
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < len; i++) {
+    h ^= (unsigned char)key[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+#define FROZEN_NBUCKET(n) ((n) / 2 + 1)
+#define FROZEN_MAXBUCKET 32 // keys in a bucket, beyond which freezing fails
+
+// Map h to [0, n).
+static inline uint32_t fastrange(uint32_t h, uint32_t n) {
+  return (uint32_t)(((uint64_t)h * n) >> 32);
+}
+
+// The finalizer of MurmurHash3.
+static inline uint32_t mix32(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  return x;
+}
+
+// Spread the hash h of a key in a frozen table: its bucket is chosen by
+// the high half, and its slot by f + d * g, for displacement d, with f the
+// low half and g the high half made odd. FNV-1a leaves the high bits of
+// similar keys alike, so the product carries its low bits up.
+static inline uint64_t frozen_spread(uint32_t h) {
+  return h * 0x9e3779b97f4a7c15u;
+}
+
+// The bucket of spread hash m in a frozen table of n keys.
+static inline uint32_t frozen_bucket(uint64_t m, uint32_t n) {
+  return fastrange(m >> 32, FROZEN_NBUCKET(n));
+}
+
+// The slot of spread hash m in frozen table meta, displaced by d.
+static inline uint32_t frozen_slot_d(const tabmeta_t *meta, uint64_t m,
+                                     uint32_t d) {
+  return fastrange((uint32_t)m + d * ((uint32_t)(m >> 32) | 1), meta->nslot);
+}
+
+// The slot of frozen table meta for a key with hash h.
+static inline uint32_t frozen_slot(const tabmeta_t *meta, uint32_t h) {
+  uint64_t m = frozen_spread(h);
+  return frozen_slot_d(meta, m, meta->disp[frozen_bucket(m, meta->nslot)]);
+}
+
+// Insert key[idx] with hash h into the index. There must be a free slot.
+static void tab_index_put(tabmeta_t *meta, uint32_t h, int idx) {
+  uint32_t mask = meta->nslot - 1;
+  uint32_t i = h & mask;
+  while (meta->slot[i].idx) {
+    i = (i + 1) & mask;
+  }
+  meta->slot[i] = (tabslot_t){idx + 1, h};
+}
+
+// (Re)build the index of tab with nslot entries. Return 0 on success, -1
+// otherwise.
+static int tab_index_build(mem_t *mem, toml_datum_t *tab, int nslot) {
+  tabmeta_t *meta = tab_meta(tab);
+  tabslot_t *slot = mem_alloc(mem, sizeof(*slot) * nslot);
+  if (!slot) {
+    return -1;
+  }
+  memset(slot, 0, sizeof(*slot) * nslot);
+  mem_free(mem, meta->slot);
+  meta->slot = slot;
+  meta->nslot = nslot;
+  for (int i = 0, top = tab->u.tab.size; i < top; i++) {
+    tab_index_put(meta, hash_key(tab->u.tab.key[i], tab->u.tab.len[i]), i);
+  }
+  return 0;
+}
+
+// Find key in tab using the index. Return its index, or -1 if not found.
+static int tab_index_find(toml_datum_t *tab, tabmeta_t *meta, span_t key,
+                          uint32_t h) {
+  uint32_t mask = meta->nslot - 1;
+  for (uint32_t i = h & mask; meta->slot[i].idx; i = (i + 1) & mask) {
+    int j = meta->slot[i].idx - 1;
+    if (meta->slot[i].hash == h &&
+        (tab->u.tab.key[j] == key.ptr ||
+         (tab->u.tab.len[j] == key.len &&
+          0 == memcmp(tab->u.tab.key[j], key.ptr, key.len)))) {
+      return j;
     }
-    tab->u.tab.key = (const char **)pkey;
   }
+  return -1;
+}
 
-  {
-    int *plen = REALLOC(tab->u.tab.len, sizeof(*plen) * align8(N + 1));
-    if (!plen) {
-      *reason = "out of memory";
-      FREE(plen);
-      return NULL;
+// Find key, whose hash is h, in tab and return its index. If not found,
+// return -1.
+static int tab_find_h(toml_datum_t *tab, span_t key, uint32_t h) {
+  assert(tab->type == TOML_TABLE);
+  tabmeta_t *meta = tab_meta(tab);
+  if (meta && meta->disp) {
+    const tabslot_t *slot = &meta->slot[frozen_slot(meta, h)];
+    int j = slot->idx - 1;
+    return (slot->hash == h &&
+            (tab->u.tab.key[j] == key.ptr ||
+             (tab->u.tab.len[j] == key.len &&
+              0 == memcmp(tab->u.tab.key[j], key.ptr, key.len))))
+               ? j
+               : -1;
+  }
+  if (meta && meta->nslot) {
+    return tab_index_find(tab, meta, key, h);
+  }
+  for (int i = 0, top = tab->u.tab.size; i < top; i++) {
+    if (tab->u.tab.key[i] == key.ptr ||
+        (tab->u.tab.len[i] == key.len &&
+         0 == memcmp(tab->u.tab.key[i], key.ptr, key.len))) {
+      return i;
     }
-    tab->u.tab.len = plen;
   }
+  return -1;
+}
 
-  {
-    toml_datum_t *value =
-        REALLOC(tab->u.tab.value, sizeof(*value) * align8(N + 1));
-    if (!value) {
-      *reason = "out of memory";
-      FREE(value);
+// Find key in tab and return its index. If not found, return -1.
+static int tab_find(toml_datum_t *tab, span_t key) {
+  // Only an indexed table needs the hash.
+  tabmeta_t *meta = tab_meta(tab);
+  uint32_t h = (meta && meta->nslot ? hash_key(key.ptr, key.len) : 0);
+  return tab_find_h(tab, key, h);
+}
+
+// Make room for at least n keys in tab. Return 0 on success, -1 otherwise.
+// On error, reason will point to an error message.
+static int tab_reserve(mem_t *mem, toml_datum_t *tab, int n,
+                       const char **reason) {
+  assert(tab->type == TOML_TABLE);
+  tabmeta_t *meta = tab_meta(tab);
+  if (n <= (meta ? meta->cap : 0)) {
+    return 0;
+  }
+
+  // key[], value[] and len[] share a single block behind the header.
+  // value[] holds 8-byte members; on 32-bit targets an odd n would leave
+  // it 4-byte aligned after key[], so round its offset up.
+  const size_t align = _Alignof(toml_datum_t);
+  size_t valoff = sizeof(tabmeta_t) + sizeof(char *) * n;
+  valoff = (valoff + align - 1) / align * align;
+  size_t total = valoff + (sizeof(toml_datum_t) + sizeof(int)) * n;
+  tabmeta_t *newmeta = mem_alloc(mem, total);
+  if (!newmeta) {
+    *reason = "out of memory";
+    return -1;
+  }
+  *newmeta = meta ? *meta : (tabmeta_t){0};
+  const char **pkey = (const char **)(newmeta + 1);
+  toml_datum_t *pvalue = (toml_datum_t *)((char *)newmeta + valoff);
+  int *plen = (int *)(pvalue + n);
+  assert((uintptr_t)pvalue % align == 0);
+  int N = tab->u.tab.size;
+  if (N) {
+    memcpy(pkey, tab->u.tab.key, sizeof(*pkey) * N);
+    memcpy(pvalue, tab->u.tab.value, sizeof(*pvalue) * N);
+    memcpy(plen, tab->u.tab.len, sizeof(*plen) * N);
+  }
+  mem_free(mem, meta);
+  tab->u.tab.key = pkey;
+  tab->u.tab.value = pvalue;
+  tab->u.tab.len = plen;
+  newmeta->cap = n;
+  return 0;
+}
+
+
+// Find key in tab, or append it with a zero value if not found. Return a
+// pointer to the value on success, or NULL otherwise.
+// On error, reason will point to an error message.
+static toml_datum_t *tab_emplace(mem_t *mem, toml_datum_t *tab, span_t key,
+                                 const char **reason) {
+  assert(tab->type == TOML_TABLE);
+  int N = tab->u.tab.size;
+  tabmeta_t *meta = tab_meta(tab);
+  assert(!meta || !meta->disp); // a frozen table does not change
+  uint32_t h = 0;
+  int j;
+  if (meta && meta->nslot) {
+    h = hash_key(key.ptr, key.len);
+    j = tab_index_find(tab, meta, key, h);
+  } else {
+    j = tab_find(tab, key);
+  }
+  if (j >= 0) {
+    return &tab->u.tab.value[j];
+  }
+
+  // Make room for the new key.
+  if (N == (meta ? meta->cap : 0)) {
+    if (tab_reserve(mem, tab, grow_capacity(N, N + 1), reason)) {
       return NULL;
     }
-    tab->u.tab.value = value;
+    meta = tab_meta(tab);
   }
 
   // Append the new key/value
@@ -261,49 +838,191 @@ static toml_datum_t *tab_emplace(toml_datum_t *tab, span_t key,
   tab->u.tab.key[N] = (char *)key.ptr;
   tab->u.tab.len[N] = key.len;
   tab->u.tab.value[N] = DATUM_ZERO;
+
+  // Maintain the index. Keep the load factor at or below 1/2.
+  if (meta->nslot && (N + 1) * 2 <= meta->nslot) {
+    tab_index_put(meta, h, N);
+  } else if (N + 1 >= TAB_INDEX_MIN) {
+    int nslot = meta->nslot ? meta->nslot * 2 : TAB_INDEX_MIN * 4;
+    if (tab_index_build(mem, tab, nslot)) {
+      tab->u.tab.size = N;
+      *reason = "out of memory";
+      return NULL;
+    }
+  }
   return &tab->u.tab.value[N];
 }
 
-// Find key in tab and return its index. If not found, return -1.
-static int tab_find(toml_datum_t *tab, span_t key) {
+// Try to place the keys ent[0..n) of one bucket, whose hashes are in
+// hash[], in the free slots of meta with displacement d. Return true and
+// take the slots on success.
+static bool frozen_place(tabmeta_t *meta, const uint32_t *hash,
+                         const int *ent, int n, uint32_t d) {
+  int i;
+  for (i = 0; i < n; i++) {
+    uint64_t m = frozen_spread(hash[ent[i]]);
+    tabslot_t *slot = &meta->slot[frozen_slot_d(meta, m, d)];
+    if (slot->idx) {
+      break;
+    }
+    slot->idx = ent[i] + 1;
+  }
+  if (i == n) {
+    return true;
+  }
+  while (i-- > 0) {
+    uint64_t m = frozen_spread(hash[ent[i]]);
+    meta->slot[frozen_slot_d(meta, m, d)].idx = 0;
+  }
+  return false;
+}
+
+// Replace the index of tab by a minimal perfect hash. A table too small
+// to have an index keeps its scan, which is cheaper than hashing the key,
+// and a table whose keys cannot be so placed, e.g. because two of them
+// have the same hash, keeps its index. Return 0 on success, -1 otherwise.
+// On error, reason will point to an error message.
+static int tab_freeze(mem_t *mem, toml_datum_t *tab, const char **reason) {
   assert(tab->type == TOML_TABLE);
-  for (int i = 0, top = tab->u.tab.size; i < top; i++) {
-    if (tab->u.tab.len[i] == key.len &&
-        0 == memcmp(tab->u.tab.key[i], key.ptr, key.len)) {
-      return i;
+  int n = tab->u.tab.size;
+  tabmeta_t *meta = tab_meta(tab);
+  if (n < TAB_INDEX_MIN || meta->disp) {
+    return 0;
+  }
+  int ret = 0;
+  int nbucket = FROZEN_NBUCKET(n);
+  tabmeta_t tmp = {.nslot = n};
+  tmp.slot = mem_alloc(mem, sizeof(*tmp.slot) * n);
+  tmp.disp = mem_alloc(mem, sizeof(*tmp.disp) * nbucket);
+  // hash[n], then the keys by bucket in ent[n], starting at start[b] for
+  // bucket b.
+  uint32_t *hash = MALLOC(&mem->opt, sizeof(uint32_t) * n +
+                                         sizeof(int) * (n + nbucket + 1));
+  if (!tmp.slot || !tmp.disp || !hash) {
+    *reason = "out of memory";
+    ret = -1;
+    goto bail;
+  }
+  int *ent = (int *)(hash + n);
+  int *start = ent + n;
+  memset(tmp.slot, 0, sizeof(*tmp.slot) * n);
+  memset(start, 0, sizeof(*start) * (nbucket + 1));
+  for (int i = 0; i < n; i++) {
+    hash[i] = hash_key(tab->u.tab.key[i], tab->u.tab.len[i]);
+    start[frozen_bucket(frozen_spread(hash[i]), n) + 1]++;
+  }
+  int maxsz = 0;
+  for (int b = 0; b < nbucket; b++) {
+    maxsz = (start[b + 1] > maxsz ? start[b + 1] : maxsz);
+    start[b + 1] += start[b];
+  }
+  if (maxsz > FROZEN_MAXBUCKET) {
+    goto bail;
+  }
+  for (int i = 0; i < n; i++) {
+    ent[start[frozen_bucket(frozen_spread(hash[i]), n)]++] = i;
+  }
+  // start[b] is now the end of bucket b.
+
+  // Place the biggest buckets first, while most slots are free. Keys of
+  // equal hash are never placed apart.
+  for (int sz = maxsz; sz > 0; sz--) {
+    for (int b = 0; b < nbucket; b++) {
+      int *bent = ent + (b ? start[b - 1] : 0);
+      if (ent + start[b] - bent != sz) {
+        continue;
+      }
+      for (int i = 1; i < sz; i++) {
+        for (int k = 0; k < i; k++) {
+          if (hash[bent[i]] == hash[bent[k]]) {
+            goto bail;
+          }
+        }
+      }
+      // Try displacements at random: for odd g, d * g is then at random
+      // too, where a run of d would step through few slots for some g.
+      uint32_t k = 0;
+      uint32_t maxk = (uint32_t)n * 64 + 1024;
+      while (!frozen_place(&tmp, hash, bent, sz, mix32(k))) {
+        if (++k == maxk) {
+          goto bail;
+        }
+      }
+      tmp.disp[b] = mix32(k);
     }
   }
-  return -1;
+  for (int i = 0; i < n; i++) {
+    tmp.slot[i].hash = hash[tmp.slot[i].idx - 1];
+  }
+  FREE(&mem->opt, hash);
+  mem_free(mem, meta->slot);
+  meta->slot = tmp.slot;
+  meta->nslot = n;
+  meta->disp = tmp.disp;
+  return 0;
+
+bail:
+  FREE(&mem->opt, hash);
+  mem_free(mem, tmp.slot);
+  mem_free(mem, tmp.disp);
+  return ret;
 }
 
 // Add a new key in tab. Return 0 on success, -1 otherwise.
 // On error, reason will point to an error message.
-static int tab_add(toml_datum_t *tab, span_t newkey, toml_datum_t newvalue,
-                   const char **reason) {
+static int tab_add(mem_t *mem, toml_datum_t *tab, span_t newkey,
+                   toml_datum_t newvalue, const char **reason) {
   assert(tab->type == TOML_TABLE);
-  if (-1 != tab_find(tab, newkey)) {
-    *reason = "duplicate key";
+  int N = tab->u.tab.size;
+  toml_datum_t *pvalue = tab_emplace(mem, tab, newkey, reason);
+  if (!pvalue) {
     return -1;
   }
-  toml_datum_t *pvalue = tab_emplace(tab, newkey, reason);
-  if (!pvalue) {
+  if (tab->u.tab.size == N) {
+    *reason = "duplicate key";
     return -1;
   }
   *pvalue = newvalue;
   return 0;
 }
 
-// Add a new element into an array. Return 0 on success, -1 otherwise.
-// On error, reason will point to an error message.
-static toml_datum_t *arr_emplace(toml_datum_t *arr, const char **reason) {
+// Make room for at least n elements in arr. Return 0 on success, -1
+// otherwise. On error, reason will point to an error message.
+static int arr_reserve(mem_t *mem, toml_datum_t *arr, int n,
+                       const char **reason) {
   assert(arr->type == TOML_ARRAY);
-  int n = arr->u.arr.size;
-  toml_datum_t *elem = REALLOC(arr->u.arr.elem, sizeof(*elem) * align8(n + 1));
-  if (!elem) {
+  arrmeta_t *meta = arr_meta(arr);
+  int cap = meta ? meta->cap : 0;
+  if (n <= cap) {
+    return 0;
+  }
+  arrmeta_t *newmeta =
+      mem_realloc(mem, meta, sizeof(*meta) + sizeof(toml_datum_t) * cap,
+                  sizeof(*newmeta) + sizeof(toml_datum_t) * n);
+  if (!newmeta) {
     *reason = "out of memory";
-    return NULL;
+    return -1;
+  }
+  newmeta->cap = n;
+  newmeta->spare = 0;
+  arr->u.arr.elem = (toml_datum_t *)(newmeta + 1);
+  return 0;
+}
+
+// Add a new element into an array. Return a pointer to the new element on
+// success, or NULL otherwise. On error, reason will point to an error
+// message.
+static toml_datum_t *arr_emplace(mem_t *mem, toml_datum_t *arr,
+                                 const char **reason) {
+  assert(arr->type == TOML_ARRAY);
+  int n = arr->u.arr.size;
+  arrmeta_t *meta = arr_meta(arr);
+  if (n == (meta ? meta->cap : 0)) {
+    if (arr_reserve(mem, arr, grow_capacity(n, n + 1), reason)) {
+      return NULL;
+    }
   }
-  arr->u.arr.elem = elem;
+  toml_datum_t *elem = arr->u.arr.elem;
   arr->u.arr.size = n + 1;
   elem[n] = DATUM_ZERO;
   return &elem[n];
@@ -312,9 +1031,14 @@ static toml_datum_t *arr_emplace(toml_datum_t *arr, const char **reason) {
 // ------------------- parser section
 static int parse_norm(parser_t *pp, token_t tok, span_t *ret_span);
 static int parse_val(parser_t *pp, token_t tok, toml_datum_t *ret);
+static int parse_key(parser_t *pp, token_t tok, keypart_t *ret_keypart);
 static int parse_keyvalue_expr(parser_t *pp, token_t tok);
 static int parse_std_table_expr(parser_t *pp, token_t tok);
 static int parse_array_table_expr(parser_t *pp, token_t tok);
+static void lazy_destroy(mem_t *mem);
+static int lazy_load(toml_datum_t *datum, const char **reason);
+static const char *scan_plain(const char *p, const char *endp, char c1,
+                              char c2);
 
 static toml_datum_t mkdatum(toml_type_t ty) {
   toml_datum_t ret = {0};
@@ -333,57 +1057,203 @@ static toml_datum_t mkdatum(toml_type_t ty) {
   return ret;
 }
 
-// Recursively free any dynamically allocated memory in the datum tree
-static void datum_free(toml_datum_t *datum) {
-  if (datum->type == TOML_TABLE) {
+// Recursively free any dynamically allocated memory in the datum tree.
+// In arena mode, the memory is released with the arena instead, and a
+// binary image with its mapping. A shared subtree is left to its owner.
+static void datum_free(mem_t *mem, toml_datum_t *datum) {
+  if (mem->arena || mem->image || (datum->flag & FLAG_SHARED)) {
+    ; // nothing to do
+  } else if (datum->type == TOML_TABLE) {
     for (int i = 0, top = datum->u.tab.size; i < top; i++) {
-      datum_free(&datum->u.tab.value[i]);
+      datum_free(mem, &datum->u.tab.value[i]);
+    }
+    tabmeta_t *meta = tab_meta(datum);
+    if (meta) {
+      FREE(&mem->opt, meta->slot);
+      FREE(&mem->opt, meta->disp);
+      FREE(&mem->opt, meta);
     }
-    FREE(datum->u.tab.key);
-    FREE(datum->u.tab.len);
-    FREE(datum->u.tab.value);
   } else if (datum->type == TOML_ARRAY) {
     for (int i = 0, top = datum->u.arr.size; i < top; i++) {
-      datum_free(&datum->u.arr.elem[i]);
+      datum_free(mem, &datum->u.arr.elem[i]);
     }
-    FREE(datum->u.arr.elem);
+    FREE(&mem->opt, arr_meta(datum));
   }
   // other types do not allocate memory
   *datum = DATUM_ZERO;
 }
 
-static int datum_copy(toml_datum_t *dst, toml_datum_t src, pool_t *pool,
+/**
+ *  Create the memory for a result parsed with the options opt, with a
+ *  string pool of poolsz bytes. In arena mode, the first arena chunk has
+ *  room for arenasz bytes. Return the memory on success, or NULL if out
+ *  of memory.
+ */
+static mem_t *mem_create(const toml_option_t *opt, int poolsz,
+                         size_t arenasz) {
+  mem_t *mem = MALLOC(opt, sizeof(*mem));
+  if (!mem) {
+    return NULL;
+  }
+  memset(mem, 0, sizeof(*mem));
+  mem->opt = *opt;
+  mem->keys = mkdatum(TOML_TABLE);
+  mem->pool = pool_create(&mem->opt, poolsz);
+  if (!mem->pool) {
+    FREE(opt, mem);
+    return NULL;
+  }
+  if (opt->use_arena) {
+    mem->arena = arena_create(&mem->opt, arenasz);
+    if (!mem->arena) {
+      pool_destroy(mem->pool);
+      FREE(opt, mem);
+      return NULL;
+    }
+  }
+  return mem;
+}
+
+/**
+ *  Release the memory of a result, including the tree rooted at toptab.
+ */
+static void mem_destroy(mem_t *mem, toml_datum_t *toptab) {
+  if (!mem || mem->kept) {
+    return;
+  }
+  if (mem->nshare > 0) {
+    // Another result still points into the tree.
+    mem->nshare--;
+    mem->top = *toptab;
+    return;
+  }
+  mem_t *base = mem->base;
+  datum_free(mem, toptab);
+  lazy_destroy(mem);
+  while (mem) {
+    mem_t *next = mem->next;
+    toml_option_t opt = mem->opt;
+    datum_free(mem, &mem->keys);
+    arena_destroy(mem->arena);
+    pool_destroy(mem->pool);
+    FREE(&opt, mem->srcbuf);
+#ifdef HAVE_MMAP
+    if (mem->srcmap) {
+      munmap(mem->srcmap, mem->srcmaplen);
+    }
+#endif
+    FREE(&opt, mem);
+    mem = next;
+  }
+  if (base) {
+    mem_destroy(base, &base->top);
+  }
+}
+
+// Forget all but the first n interned keys of mem.
+static void mem_unintern(mem_t *mem, int n) {
+  toml_datum_t *keys = &mem->keys;
+  if (keys->u.tab.size <= n) {
+    return;
+  }
+  keys->u.tab.size = n;
+  tabmeta_t *meta = tab_meta(keys);
+  if (meta->nslot) {
+    memset(meta->slot, 0, sizeof(*meta->slot) * meta->nslot);
+    for (int i = 0; i < n; i++) {
+      tab_index_put(meta, hash_key(keys->u.tab.key[i], keys->u.tab.len[i]),
+                    i);
+    }
+  }
+}
+
+// Point key to the interned copy of its text in mem or its bases,
+// interning key itself if there is none, or a copy of it in the pool if
+// copy. Return 0 on success, -1 otherwise.
+// On error, reason will point to an error message.
+static int mem_intern(mem_t *mem, span_t *key, bool copy,
+                      const char **reason) {
+  mem_t *owner = mem;
+  for (mem_t *b = mem->base; b; b = b->base) {
+    int i = tab_find(&b->keys, *key);
+    if (i >= 0) {
+      key->ptr = b->keys.u.tab.key[i];
+      return 0;
+    }
+    if (b->lazy) {
+      // A section of b not loaded yet may have the key; intern it there,
+      // so that the section uses the same copy.
+      owner = b;
+      copy = true;
+    }
+  }
+  toml_datum_t *keys = &owner->keys;
+  int n = keys->u.tab.size;
+  toml_datum_t *pv = tab_emplace(owner, keys, *key, reason);
+  if (!pv) {
+    return -1;
+  }
+  int i = pv - keys->u.tab.value;
+  if (i == n && copy) {
+    char *p = pool_alloc(owner->pool, key->len + 1);
+    if (!p) {
+      mem_unintern(owner, n);
+      *reason = "out of memory";
+      return -1;
+    }
+    memcpy(p, key->ptr, key->len);
+    p[key->len] = 0;
+    keys->u.tab.key[i] = p;
+  }
+  key->ptr = keys->u.tab.key[i];
+  return 0;
+}
+
+static int datum_copy(mem_t *mem, toml_datum_t *dst, toml_datum_t src,
                       const char **reason) {
+  *dst = DATUM_ZERO;
+  DO(lazy_load(&src, reason));
   *dst = mkdatum(src.type);
   switch (src.type) {
   case TOML_STRING:
-    dst->u.str.ptr = pool_alloc(pool, src.u.str.len + 1);
+    dst->u.str.ptr = pool_alloc(mem->pool, src.u.str.len + 1);
     if (!dst->u.str.ptr) {
       *reason = "out of memory";
       goto bail;
     }
     dst->u.str.len = src.u.str.len;
-    memcpy((char *)dst->u.str.ptr, src.u.str.ptr, src.u.str.len + 1);
+    // src may borrow from a source buffer; do not copy past len.
+    memcpy((char *)dst->u.str.ptr, src.u.str.ptr, src.u.str.len);
+    ((char *)dst->u.str.ptr)[src.u.str.len] = 0;
     break;
   case TOML_TABLE:
+    if (tab_reserve(mem, dst, src.u.tab.size, reason)) {
+      goto bail;
+    }
     for (int i = 0; i < src.u.tab.size; i++) {
       span_t newkey = {src.u.tab.key[i], src.u.tab.len[i]};
-      toml_datum_t *pvalue = tab_emplace(dst, newkey, reason);
+      if (mem_intern(mem, &newkey, true, reason)) {
+        goto bail;
+      }
+      toml_datum_t *pvalue = tab_emplace(mem, dst, newkey, reason);
       if (!pvalue) {
         goto bail;
       }
-      if (datum_copy(pvalue, src.u.tab.value[i], pool, reason)) {
+      if (datum_copy(mem, pvalue, src.u.tab.value[i], reason)) {
         goto bail;
       }
     }
     break;
   case TOML_ARRAY:
+    if (arr_reserve(mem, dst, src.u.arr.size, reason)) {
+      goto bail;
+    }
     for (int i = 0; i < src.u.arr.size; i++) {
-      toml_datum_t *pelem = arr_emplace(dst, reason);
+      toml_datum_t *pelem = arr_emplace(mem, dst, reason);
       if (!pelem) {
         goto bail;
       }
-      if (datum_copy(pelem, src.u.arr.elem[i], pool, reason)) {
+      if (datum_copy(mem, pelem, src.u.arr.elem[i], reason)) {
         goto bail;
       }
     }
@@ -396,7 +1266,7 @@ static int datum_copy(toml_datum_t *dst, toml_datum_t src, pool_t *pool,
   return 0;
 
 bail:
-  datum_free(dst);
+  datum_free(mem, dst);
   return -1;
 }
 
@@ -408,41 +1278,111 @@ static inline bool is_array_of_tables(toml_datum_t datum) {
   return ret;
 }
 
-static int datum_merge(toml_datum_t *dst, toml_datum_t src, pool_t *pool,
+// Give the shared table or array *d a key[] and value[], or elem[], of
+// its own, which point to its children in turn. Return 0 on success, -1
+// otherwise.
+// On error, reason will point to an error message.
+static int datum_unshare(mem_t *mem, toml_datum_t *d, const char **reason) {
+  if (!(d->flag & FLAG_SHARED)) {
+    return 0;
+  }
+  DO(lazy_load(d, reason));
+  toml_datum_t src = *d;
+  toml_datum_t own = mkdatum(src.type);
+  own.flag = src.flag & ~FLAG_SHARED;
+  int n = (src.type == TOML_TABLE ? src.u.tab.size : src.u.arr.size);
+  if (n == 0) {
+    ; // nothing to copy
+  } else if (src.type == TOML_TABLE) {
+    if (tab_reserve(mem, &own, n, reason)) {
+      goto bail;
+    }
+    memcpy(own.u.tab.key, src.u.tab.key, sizeof(*src.u.tab.key) * n);
+    memcpy(own.u.tab.len, src.u.tab.len, sizeof(*src.u.tab.len) * n);
+    memcpy(own.u.tab.value, src.u.tab.value, sizeof(*src.u.tab.value) * n);
+    own.u.tab.size = n;
+    // Keep the index, which has the same keys at the same places. A
+    // frozen one is rebuilt, so that the copy can take more keys.
+    tabmeta_t *smeta = tab_meta(&src);
+    tabmeta_t *meta = tab_meta(&own);
+    if (smeta->nslot && !smeta->disp) {
+      meta->slot = mem_alloc(mem, sizeof(*meta->slot) * smeta->nslot);
+      if (!meta->slot) {
+        *reason = "out of memory";
+        goto bail;
+      }
+      memcpy(meta->slot, smeta->slot, sizeof(*meta->slot) * smeta->nslot);
+      meta->nslot = smeta->nslot;
+    } else if (n >= TAB_INDEX_MIN) {
+      int nslot = TAB_INDEX_MIN * 4;
+      while (nslot < n * 2) {
+        nslot *= 2;
+      }
+      if (tab_index_build(mem, &own, nslot)) {
+        *reason = "out of memory";
+        goto bail;
+      }
+    }
+    for (int i = 0; i < n; i++) {
+      own.u.tab.value[i].flag |= FLAG_SHARED;
+    }
+  } else {
+    if (arr_reserve(mem, &own, n, reason)) {
+      goto bail;
+    }
+    memcpy(own.u.arr.elem, src.u.arr.elem, sizeof(*src.u.arr.elem) * n);
+    own.u.arr.size = n;
+    for (int i = 0; i < n; i++) {
+      own.u.arr.elem[i].flag |= FLAG_SHARED;
+    }
+  }
+  *d = own;
+  return 0;
+
+bail:
+  datum_free(mem, &own);
+  return -1;
+}
+
+static int datum_merge(mem_t *mem, toml_datum_t *dst, toml_datum_t src,
                        const char **reason) {
+  DO(lazy_load(&src, reason));
   if (dst->type != src.type) {
-    datum_free(dst);
-    return datum_copy(dst, src, pool, reason);
+    datum_free(mem, dst);
+    return datum_copy(mem, dst, src, reason);
   }
   switch (src.type) {
   case TOML_TABLE:
+    DO(datum_unshare(mem, dst, reason));
     // for key-value in src:
     //    override key-value in dst.
     for (int i = 0; i < src.u.tab.size; i++) {
       span_t key;
       key.ptr = src.u.tab.key[i];
       key.len = src.u.tab.len[i];
-      toml_datum_t *pvalue = tab_emplace(dst, key, reason);
+      DO(mem_intern(mem, &key, true, reason));
+      toml_datum_t *pvalue = tab_emplace(mem, dst, key, reason);
       if (!pvalue) {
         return -1;
       }
       if (pvalue->type) {
-        DO(datum_merge(pvalue, src.u.tab.value[i], pool, reason));
+        DO(datum_merge(mem, pvalue, src.u.tab.value[i], reason));
       } else {
-        datum_free(pvalue);
-        DO(datum_copy(pvalue, src.u.tab.value[i], pool, reason));
+        datum_free(mem, pvalue);
+        DO(datum_copy(mem, pvalue, src.u.tab.value[i], reason));
       }
     }
     return 0;
   case TOML_ARRAY:
     if (is_array_of_tables(src)) {
       // append src array to dst
+      DO(datum_unshare(mem, dst, reason));
       for (int i = 0; i < src.u.arr.size; i++) {
-        toml_datum_t *pelem = arr_emplace(dst, reason);
+        toml_datum_t *pelem = arr_emplace(mem, dst, reason);
         if (!pelem) {
           return -1;
         }
-        DO(datum_copy(pelem, src.u.arr.elem[i], pool, reason));
+        DO(datum_copy(mem, pelem, src.u.arr.elem[i], reason));
       }
       return 0;
     }
@@ -450,11 +1390,116 @@ static int datum_merge(toml_datum_t *dst, toml_datum_t src, pool_t *pool,
   default:
     break;
   }
-  datum_free(dst);
-  return datum_copy(dst, src, pool, reason);
+  datum_free(mem, dst);
+  return datum_copy(mem, dst, src, reason);
+}
+
+// Merge the values v[0..n) that n layers have for a key into *dst, as
+// merging each into the one before with datum_merge() does, but copying
+// only the values that no later one replaces, once. v[] is scratch.
+// Return 0 on success, -1 otherwise.
+// On error, reason will point to an error message.
+static int datum_merge_many(mem_t *mem, toml_datum_t *dst, toml_datum_t *v,
+                            int n, const char **reason) {
+  *dst = DATUM_ZERO;
+  for (int i = 0; i < n; i++) {
+    DO(lazy_load(&v[i], reason));
+  }
+  // Start from the last value that replaces the ones before it.
+  int s = n - 1;
+  while (s > 0 && v[s].type == v[s - 1].type &&
+         (v[s].type == TOML_TABLE || is_array_of_tables(v[s]))) {
+    s--;
+  }
+  if (s == n - 1) {
+    return datum_copy(mem, dst, v[s], reason);
+  }
+  v += s;
+  n -= s;
+
+  *dst = mkdatum(v[0].type);
+  toml_datum_t *pv;
+  if (v[0].type == TOML_ARRAY) {
+    // Arrays of tables append.
+    int total = 0;
+    for (int i = 0; i < n; i++) {
+      total += v[i].u.arr.size;
+    }
+    if (arr_reserve(mem, dst, total, reason)) {
+      goto bail;
+    }
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < v[i].u.arr.size; j++) {
+        if (!(pv = arr_emplace(mem, dst, reason)) ||
+            datum_copy(mem, pv, v[i].u.arr.elem[j], reason)) {
+          goto bail;
+        }
+      }
+    }
+    return 0;
+  }
+
+  // Tables merge: each key, in the order the layers add it, gets the
+  // values of the layers that have it.
+  toml_datum_t local[8];
+  toml_datum_t *kid = local;
+  if (n > (int)(sizeof(local) / sizeof(local[0]))) {
+    kid = MALLOC(&mem->opt, sizeof(*kid) * n);
+    if (!kid) {
+      *reason = "out of memory";
+      goto bail;
+    }
+  }
+  int maxsz = 0;
+  for (int i = 0; i < n; i++) {
+    maxsz = (maxsz > v[i].u.tab.size ? maxsz : v[i].u.tab.size);
+  }
+  if (tab_reserve(mem, dst, maxsz, reason)) {
+    goto bail_kid;
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < v[i].u.tab.size; j++) {
+      span_t key = {v[i].u.tab.key[j], v[i].u.tab.len[j]};
+      if (mem_intern(mem, &key, true, reason) ||
+          !(pv = tab_emplace(mem, dst, key, reason))) {
+        goto bail_kid;
+      }
+      if (pv->type) {
+        continue; // merged from an earlier layer
+      }
+      uint32_t h = hash_key(key.ptr, key.len);
+      int m = 0;
+      kid[m++] = v[i].u.tab.value[j];
+      for (int k = i + 1; k < n; k++) {
+        int idx = tab_find_h(&v[k], key, h);
+        if (idx >= 0) {
+          kid[m++] = v[k].u.tab.value[idx];
+        }
+      }
+      if (datum_merge_many(mem, pv, kid, m, reason)) {
+        goto bail_kid;
+      }
+    }
+  }
+  if (kid != local) {
+    FREE(&mem->opt, kid);
+  }
+  return 0;
+
+bail_kid:
+  if (kid != local) {
+    FREE(&mem->opt, kid);
+  }
+bail:
+  datum_free(mem, dst);
+  return -1;
 }
 
 static bool datum_equiv(toml_datum_t a, toml_datum_t b) {
+  const char *reason;
+  if (lazy_load(&a, &reason) || lazy_load(&b, &reason)) {
+    return false;
+  }
   if (a.type != b.type) {
     return false;
   }
@@ -520,6 +1565,62 @@ static bool datum_equiv(toml_datum_t a, toml_datum_t b) {
   return false;
 }
 
+// Merge r2 into r1 as toml_merge() does. If share, the result points to
+// the subtrees of r1 that r2 leaves alone instead of copying them, unless
+// r1 belongs to a toml_context_t, whose memory may be reset under it.
+static toml_result_t merge_results(const toml_result_t *r1,
+                                   const toml_result_t *r2, bool share) {
+  const char *reason = "";
+  toml_result_t ret = {0};
+  mem_t *mem = 0;
+  if (!r1->ok) {
+    reason = "param error: r1 not ok";
+    goto bail;
+  }
+  if (!r2->ok) {
+    reason = "param error: r2 not ok";
+    goto bail;
+  }
+  {
+    mem_t *r1mem = (mem_t *)r1->__internal;
+    mem_t *r2mem = (mem_t *)r2->__internal;
+    share = share && !r1mem->kept;
+    int poolsz = pool_used(r2mem->pool);
+    if (!share) {
+      poolsz += pool_used(r1mem->pool);
+    }
+    // The result is allocated with the options of r1.
+    mem = mem_create(&r1mem->opt, poolsz, poolsz);
+    if (!mem) {
+      reason = "out of memory";
+      goto bail;
+    }
+    if (share) {
+      mem->base = r1mem;
+      r1mem->nshare++;
+      ret.toptab = r1->toptab;
+      ret.toptab.flag |= FLAG_SHARED;
+    }
+  }
+
+  if (!mem->base && datum_copy(mem, &ret.toptab, r1->toptab, &reason)) {
+    goto bail;
+  }
+  if (datum_merge(mem, &ret.toptab, r2->toptab, &reason)) {
+    goto bail;
+  }
+
+  ret.ok = 1;
+  ret.__internal = mem;
+  return ret;
+
+bail:
+  mem_destroy(mem, &ret.toptab);
+  ret.toptab = DATUM_ZERO;
+  snprintf(ret.errmsg, sizeof(ret.errmsg), "%s", reason);
+  return ret;
+}
+
 /**
  *  Override values in r1 using r2. Return a new result. All results
  *  (i.e., r1, r2 and the returned result) must be freed using toml_free()
@@ -540,40 +1641,57 @@ static bool datum_equiv(toml_datum_t a, toml_datum_t b) {
  *         override
  */
 toml_result_t toml_merge(const toml_result_t *r1, const toml_result_t *r2) {
+  return merge_results(r1, r2, false);
+}
+
+toml_result_t toml_merge_shared(const toml_result_t *r1,
+                                const toml_result_t *r2) {
+  return merge_results(r1, r2, true);
+}
+
+toml_result_t toml_merge_many(const toml_result_t **layers, int n) {
   const char *reason = "";
   toml_result_t ret = {0};
-  pool_t *pool = 0;
-  if (!r1->ok) {
-    reason = "param error: r1 not ok";
-    goto bail;
-  }
-  if (!r2->ok) {
-    reason = "param error: r2 not ok";
+  mem_t *mem = 0;
+  toml_datum_t *top = 0;
+  if (n <= 0) {
+    reason = "param error: no layers";
     goto bail;
   }
-  {
-    pool_t *r1pool = (pool_t *)r1->__internal;
-    pool_t *r2pool = (pool_t *)r2->__internal;
-    pool = pool_create(r1pool->top + r2pool->top);
-    if (!pool) {
-      reason = "out of memory";
+  int poolsz = 0;
+  for (int i = 0; i < n; i++) {
+    if (!layers[i]->ok) {
+      reason = "param error: layer not ok";
       goto bail;
     }
-  }
-
-  if (datum_copy(&ret.toptab, r1->toptab, pool, &reason)) {
+    poolsz += pool_used(((mem_t *)layers[i]->__internal)->pool);
+  }
+  // The result is allocated with the options of the first layer, with
+  // room for the strings of all of them.
+  mem = mem_create(&((mem_t *)layers[0]->__internal)->opt, poolsz, poolsz);
+  top = mem ? MALLOC(&mem->opt, sizeof(*top) * n) : NULL;
+  if (!top) {
+    reason = "out of memory";
     goto bail;
   }
-  if (datum_merge(&ret.toptab, r2->toptab, pool, &reason)) {
+  for (int i = 0; i < n; i++) {
+    top[i] = layers[i]->toptab;
+  }
+  if (datum_merge_many(mem, &ret.toptab, top, n, &reason)) {
     goto bail;
   }
+  FREE(&mem->opt, top);
 
   ret.ok = 1;
-  ret.__internal = pool;
+  ret.__internal = mem;
   return ret;
 
 bail:
-  pool_destroy(pool);
+  if (top) {
+    FREE(&mem->opt, top);
+  }
+  mem_destroy(mem, &ret.toptab);
+  ret.toptab = DATUM_ZERO;
   snprintf(ret.errmsg, sizeof(ret.errmsg), "%s", reason);
   return ret;
 }
@@ -585,22 +1703,157 @@ bool toml_equiv(const toml_result_t *r1, const toml_result_t *r2) {
   return datum_equiv(r1->toptab, r2->toptab);
 }
 
+uint32_t toml_hash(const char *key, int len) { return hash_key(key, len); }
+
+// Return the value of key in the table datum. If hashed, h is the hash
+// of key; otherwise it is computed if the table is indexed.
+static toml_datum_t get_value(toml_datum_t datum, span_t key, uint32_t h,
+                              bool hashed) {
+  toml_datum_t ret = {0};
+  const char *reason;
+  if (lazy_load(&datum, &reason)) {
+    return ret;
+  }
+  if (datum.type == TOML_TABLE) {
+    int i = hashed ? tab_find_h(&datum, key, h) : tab_find(&datum, key);
+    if (i >= 0) {
+      ret = datum.u.tab.value[i];
+      if (lazy_load(&ret, &reason)) {
+        ret = DATUM_ZERO;
+      }
+    }
+  }
+  return ret;
+}
+
 /**
  * Find a key in a toml_table. Return the value of the key if found,
  * or a TOML_UNKNOWN otherwise.
  */
 toml_datum_t toml_get(toml_datum_t datum, const char *key) {
+  // Keys may not be NUL terminated; compare by length.
+  span_t span = {key, (int)strlen(key)};
+  return get_value(datum, span, 0, false);
+}
+
+toml_datum_t toml_get_n(toml_datum_t datum, const char *key, int keylen) {
+  span_t span = {key, keylen};
+  return get_value(datum, span, 0, false);
+}
+
+toml_datum_t toml_get_h(toml_datum_t datum, const char *key, int keylen,
+                        uint32_t hash) {
+  span_t span = {key, keylen};
+  return get_value(datum, span, hash, true);
+}
+
+toml_key_t toml_intern(const toml_result_t *result, const char *key,
+                       int len) {
+  toml_key_t ret = {0};
+  mem_t *mem = (mem_t *)result->__internal;
+  if (!result->ok || !mem) {
+    return ret;
+  }
+  span_t span = {key, len};
+  bool lazy = false;
+  for (mem_t *m = mem; m; m = m->base) {
+    int i = tab_find(&m->keys, span);
+    if (i >= 0) {
+      ret.ptr = m->keys.u.tab.key[i];
+      break;
+    }
+    lazy = lazy || m->lazy;
+  }
+  if (!ret.ptr && lazy) {
+    // A section not loaded yet may have the key. Intern a copy, which
+    // the section will use when it is loaded.
+    const char *reason;
+    if (mem_intern(mem, &span, true, &reason)) {
+      return ret;
+    }
+    ret.ptr = span.ptr;
+  }
+  if (ret.ptr) {
+    ret.len = len;
+    ret.hash = hash_key(ret.ptr, len);
+  }
+  return ret;
+}
+
+// Freeze every table under *d. Return 0 on success, -1 otherwise.
+// On error, reason will point to an error message.
+static int datum_freeze(mem_t *mem, toml_datum_t *d, const char **reason) {
+  if (d->flag & FLAG_SHARED) {
+    return 0; // frozen with the result that owns it
+  }
+  // A unit shares its key[] and value[] with its placeholder's copy.
+  toml_datum_t tmp = *d;
+  DO(lazy_load(&tmp, reason));
+  if (tmp.type == TOML_TABLE) {
+    DO(tab_freeze(mem, &tmp, reason));
+    for (int i = 0; i < tmp.u.tab.size; i++) {
+      DO(datum_freeze(mem, &tmp.u.tab.value[i], reason));
+    }
+  } else if (tmp.type == TOML_ARRAY) {
+    for (int i = 0; i < tmp.u.arr.size; i++) {
+      DO(datum_freeze(mem, &tmp.u.arr.elem[i], reason));
+    }
+  }
+  return 0;
+}
+
+int toml_freeze(toml_result_t *result) {
+  mem_t *mem = (mem_t *)result->__internal;
+  if (!result->ok || !mem) {
+    return -1;
+  }
+  if (mem->image && !mem->arena) {
+    // The index of an image lives in the image; put the new one in an
+    // arena, which goes with the image.
+    mem->arena = arena_create(&mem->opt, 0);
+    if (!mem->arena) {
+      return -1;
+    }
+  }
+  const char *reason;
+  return datum_freeze(mem, &result->toptab, &reason);
+}
+
+toml_datum_t toml_get_interned(toml_datum_t datum, toml_key_t key) {
   toml_datum_t ret = {0};
-  if (datum.type == TOML_TABLE) {
-    int n = datum.u.tab.size;
-    const char **pkey = datum.u.tab.key;
-    toml_datum_t *pvalue = datum.u.tab.value;
-    for (int i = 0; i < n; i++) {
-      if (0 == strcmp(pkey[i], key)) {
-        return pvalue[i];
+  const char *reason;
+  if (!key.ptr || lazy_load(&datum, &reason) || datum.type != TOML_TABLE) {
+    return ret;
+  }
+  // The table's copy of the key is the interned one, if it has the key.
+  tabmeta_t *meta = tab_meta(&datum);
+  int j = -1;
+  if (meta && meta->disp) {
+    int k = meta->slot[frozen_slot(meta, key.hash)].idx - 1;
+    j = (datum.u.tab.key[k] == key.ptr ? k : -1);
+  } else if (meta && meta->nslot) {
+    uint32_t mask = meta->nslot - 1;
+    for (uint32_t i = key.hash & mask; meta->slot[i].idx; i = (i + 1) & mask) {
+      int k = meta->slot[i].idx - 1;
+      if (datum.u.tab.key[k] == key.ptr) {
+        j = k;
+        break;
+      }
+    }
+  } else {
+    for (int i = 0; i < datum.u.tab.size; i++) {
+      if (datum.u.tab.key[i] == key.ptr) {
+        j = i;
+        break;
       }
     }
   }
+  if (j >= 0) {
+    ret = datum.u.tab.value[j];
+    if (lazy_load(&ret, &reason)) {
+      ret = DATUM_ZERO;
+    }
+  }
   return ret;
 }
 
@@ -612,68 +1865,326 @@ toml_datum_t toml_get(toml_datum_t datum, const char *key) {
  * chars.
  */
 toml_datum_t toml_seek(toml_datum_t table, const char *multipart_key) {
-  if (table.type != TOML_TABLE) {
-    return DATUM_ZERO;
-  }
-
-  char buf[128];
-  int bufsz = strlen(multipart_key) + 1;
-  if (bufsz >= (int)sizeof(buf)) {
-    return DATUM_ZERO;
-  }
-  memcpy(buf, multipart_key, bufsz);
-
-  char *p = buf;
-  char *q = strchr(p, '.');
+  const char *reason;
   toml_datum_t datum = table;
-  while (q && datum.type == TOML_TABLE) {
-    *q = 0;
-    datum = toml_get(datum, p);
-    if (datum.type == TOML_TABLE) {
-      p = q + 1;
-      q = strchr(p, '.');
+  const char *p = multipart_key;
+  for (;;) {
+    if (lazy_load(&datum, &reason) || datum.type != TOML_TABLE) {
+      return DATUM_ZERO;
+    }
+    const char *q = strchr(p, '.');
+    span_t key = {p, q ? (int)(q - p) : (int)strlen(p)};
+    int i = tab_find(&datum, key);
+    if (i < 0) {
+      return DATUM_ZERO;
     }
+    datum = datum.u.tab.value[i];
+    if (!q) {
+      break;
+    }
+    p = q + 1;
   }
-
-  if (!q && datum.type == TOML_TABLE) {
-    return toml_get(datum, p);
+  if (lazy_load(&datum, &reason)) {
+    return DATUM_ZERO;
   }
-
-  return DATUM_ZERO;
+  return datum;
 }
 
-/**
- *  Return the default options.
+/*
+ *  Compiled key paths. The path is split once, and the hash of each key
+ *  computed once, so that toml_path_eval() only probes the tables.
  */
-toml_option_t toml_default_option(void) {
-  toml_option_t opt = {0, realloc, free};
-  return opt;
-}
+typedef struct pathseg_t pathseg_t;
+struct pathseg_t {
+  const char *key; // NUL terminated; NULL for an array index
+  int len;         // length of key, or the array index
+  uint32_t hash;   // hash_key(key, len)
+};
 
-/**
- *  Override the current options.
- */
-void toml_set_option(toml_option_t opt) { toml_option = opt; }
+struct toml_path_t {
+  toml_option_t opt; // allocator of this path
+  int nseg;
+  pathseg_t seg[]; // seg[nseg], followed by the text of the keys
+};
 
-/**
- *  Free the result returned by toml_parse().
- */
-void toml_free(toml_result_t result) {
-  datum_free(&result.toptab);
-  pool_destroy((pool_t *)result.__internal);
+static inline bool is_barekey_char(int ch) {
+  return ('a' <= ch && ch <= 'z') || ('A' <= ch && ch <= 'Z') ||
+         ('0' <= ch && ch <= '9') || ch == '_' || ch == '-';
 }
 
-/**
- *  Parse a toml document.
- */
-toml_result_t toml_parse_file_ex(const char *fname) {
-  toml_result_t result = {0};
-  FILE *fp = fopen(fname, "r");
-  if (!fp) {
+// Parse the key at *pp into dst[], which has room for it, and advance *pp
+// past it. Return the length of the key, or -1 on a syntax error.
+static int path_key(const char **pp, char *dst) {
+  const char *p = *pp;
+  int n = 0;
+  if (*p == '\'') {
+    const char *q = strchr(p + 1, '\'');
+    if (!q) {
+      return -1;
+    }
+    n = q - p - 1;
+    memcpy(dst, p + 1, n);
+    *pp = q + 1;
+    return n;
+  }
+
+  if (*p == '"') {
+    for (p++; *p != '"'; p++) {
+      if (!*p) {
+        return -1;
+      }
+      if (*p != '\\') {
+        dst[n++] = *p;
+        continue;
+      }
+      p++;
+      switch (*p) {
+      case '"':
+      case '\\':
+        dst[n++] = *p;
+        break;
+      case 'b':
+        dst[n++] = '\b';
+        break;
+      case 'f':
+        dst[n++] = '\f';
+        break;
+      case 't':
+        dst[n++] = '\t';
+        break;
+      case 'r':
+        dst[n++] = '\r';
+        break;
+      case 'n':
+        dst[n++] = '\n';
+        break;
+      case 'u':
+      case 'U': {
+        int sz = (*p == 'u' ? 4 : 8);
+        uint32_t ucs = 0;
+        for (int i = 1; i <= sz; i++) {
+          int ch = (unsigned char)p[i];
+          if (!isxdigit(ch)) {
+            return -1;
+          }
+          ucs = ucs * 16 + (isdigit(ch) ? ch - '0' : (ch | 0x20) - 'a' + 10);
+        }
+        if (0xD800 <= ucs && ucs <= 0xDFFF) {
+          return -1;
+        }
+        int k = ucs_to_utf8(ucs, dst + n);
+        if (k < 0) {
+          return -1;
+        }
+        n += k;
+        p += sz;
+        break;
+      }
+      default:
+        return -1;
+      }
+    }
+    *pp = p + 1;
+    return n;
+  }
+
+  for (; is_barekey_char((unsigned char)*p); p++) {
+    dst[n++] = *p;
+  }
+  *pp = p;
+  return n ? n : -1;
+}
+
+toml_path_t *toml_path_compile(const char *path) {
+  return toml_path_compile_ex(path, &toml_option);
+}
+
+toml_path_t *toml_path_compile_ex(const char *path,
+                                  const toml_option_t *opt) {
+  // Each segment but the first starts with a '.' or a '['.
+  int maxseg = 1;
+  for (const char *p = path; *p; p++) {
+    maxseg += (*p == '.' || *p == '[');
+  }
+  // Keys are no longer than their text; add a NUL for each.
+  size_t sz = sizeof(toml_path_t) + sizeof(pathseg_t) * maxseg +
+              strlen(path) + maxseg;
+  toml_path_t *ret = MALLOC(opt, sz);
+  if (!ret) {
+    return NULL;
+  }
+  ret->opt = *opt;
+  ret->nseg = 0;
+  char *dst = (char *)(ret->seg + maxseg);
+
+  const char *p = path;
+  while (*p) {
+    pathseg_t *seg = &ret->seg[ret->nseg];
+    if (*p == '[') {
+      // An array index: [N]
+      int64_t idx = 0;
+      for (p++; isdigit((unsigned char)*p) && idx <= INT32_MAX; p++) {
+        idx = idx * 10 + (*p - '0');
+      }
+      if (p[-1] == '[' || idx > INT32_MAX || *p++ != ']') {
+        goto fail;
+      }
+      *seg = (pathseg_t){NULL, (int)idx, 0};
+    } else {
+      // A key; it follows a '.' unless it comes first.
+      if (ret->nseg && *p++ != '.') {
+        goto fail;
+      }
+      int n = path_key(&p, dst);
+      if (n < 0) {
+        goto fail;
+      }
+      dst[n] = 0;
+      *seg = (pathseg_t){dst, n, hash_key(dst, n)};
+      dst += n + 1;
+    }
+    ret->nseg++;
+  }
+  return ret;
+
+fail:
+  toml_path_free(ret);
+  return NULL;
+}
+
+toml_datum_t toml_path_eval(toml_datum_t datum, const toml_path_t *path) {
+  const char *reason;
+  for (int i = 0; i < path->nseg; i++) {
+    const pathseg_t *seg = &path->seg[i];
+    if (lazy_load(&datum, &reason)) {
+      return DATUM_ZERO;
+    }
+    if (seg->key) {
+      if (datum.type != TOML_TABLE) {
+        return DATUM_ZERO;
+      }
+      span_t key = {seg->key, seg->len};
+      int j = tab_find_h(&datum, key, seg->hash);
+      if (j < 0) {
+        return DATUM_ZERO;
+      }
+      datum = datum.u.tab.value[j];
+    } else {
+      if (datum.type != TOML_ARRAY || seg->len >= datum.u.arr.size) {
+        return DATUM_ZERO;
+      }
+      datum = datum.u.arr.elem[seg->len];
+    }
+  }
+  if (lazy_load(&datum, &reason)) {
+    return DATUM_ZERO;
+  }
+  return datum;
+}
+
+void toml_path_free(toml_path_t *path) {
+  if (path) {
+    toml_option_t opt = path->opt;
+    FREE(&opt, path);
+  }
+}
+
+/**
+ *  Return the default options.
+ */
+toml_option_t toml_default_option(void) {
+  toml_option_t opt = {0, realloc, free, 0, 0, 0, 0, 0, 0};
+  return opt;
+}
+
+/**
+ *  Override the current options.
+ */
+void toml_set_option(toml_option_t opt) { toml_option = opt; }
+
+/**
+ *  Free the result returned by toml_parse().
+ */
+void toml_free(toml_result_t result) {
+  mem_destroy((mem_t *)result.__internal, &result.toptab);
+}
+
+/**
+ *  Parse a toml document.
+ */
+#ifdef HAVE_MMAP
+/**
+ *  Parse a toml file by mapping it into memory. Return 0 if the file was
+ *  handled (successfully or not), or -1 if the caller should fall back
+ *  to reading the file with stdio.
+ */
+static int parse_file_mmap(const char *fname, const toml_option_t *opt,
+                           toml_result_t *result) {
+  int fd = open(fname, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return -1;
+  }
+  if (st.st_size > INT_MAX - 1) {
+    close(fd);
+    snprintf(result->errmsg, sizeof(result->errmsg),
+             "file is bigger than %d bytes", INT_MAX - 1);
+    return 0;
+  }
+  int len = st.st_size;
+  if (len == 0) {
+    close(fd);
+    return -1; // cannot mmap an empty file
+  }
+
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE; // prefault; we are going to read every byte
+#endif
+  void *addr = mmap(NULL, len, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return -1;
+  }
+  madvise(addr, len, MADV_SEQUENTIAL);
+
+  *result = toml_parse_ex((const char *)addr, len, opt);
+  mem_t *mem = (mem_t *)result->__internal;
+  if (mem && (mem->borrow || mem->lazy)) {
+    // strings or lazy sections point into the mapping; release it in
+    // toml_free().
+    mem->srcmap = addr;
+    mem->srcmaplen = len;
+  } else {
+    munmap(addr, len);
+  }
+  return 0;
+}
+#endif
+
+toml_result_t toml_parse_file_ex(const char *fname) {
+  return toml_parse_path_ex(fname, &toml_option);
+}
+
+toml_result_t toml_parse_path_ex(const char *fname,
+                                 const toml_option_t *opt) {
+  toml_result_t result = {0};
+#ifdef HAVE_MMAP
+  // Parse straight from the page cache instead of copying the file.
+  if (0 == parse_file_mmap(fname, opt, &result)) {
+    return result;
+  }
+#endif
+  FILE *fp = fopen(fname, "r");
+  if (!fp) {
     snprintf(result.errmsg, sizeof(result.errmsg), "fopen: %s", fname);
     return result;
   }
-  result = toml_parse_file(fp);
+  result = toml_parse_fp_ex(fp, opt);
   fclose(fp);
   return result;
 }
@@ -682,6 +2193,10 @@ toml_result_t toml_parse_file_ex(const char *fname) {
  *  Parse a toml document.
  */
 toml_result_t toml_parse_file(FILE *fp) {
+  return toml_parse_fp_ex(fp, &toml_option);
+}
+
+toml_result_t toml_parse_fp_ex(FILE *fp, const toml_option_t *opt) {
   toml_result_t result = {0};
   char *buf = 0;
   int top, max; // index into buf[]
@@ -700,15 +2215,15 @@ toml_result_t toml_parse_file(FILE *fp) {
         } else {
           snprintf(result.errmsg, sizeof(result.errmsg),
                    "file is bigger than %d bytes", INT_MAX - 1);
-          FREE(buf);
+          FREE(opt, buf);
           return result;
         }
       }
       // add an extra byte for terminating NUL
-      char *tmp = REALLOC(buf, tmpmax + 1);
+      char *tmp = REALLOC(opt, buf, tmpmax + 1);
       if (!tmp) {
         snprintf(result.errmsg, sizeof(result.errmsg), "out of memory");
-        FREE(buf);
+        FREE(opt, buf);
         return result;
       }
       buf = tmp;
@@ -720,123 +2235,2332 @@ toml_result_t toml_parse_file(FILE *fp) {
     if (ferror(fp)) {
       snprintf(result.errmsg, sizeof(result.errmsg), "%s",
                errno ? strerror(errno) : "Error reading file");
-      FREE(buf);
+      FREE(opt, buf);
       return result;
     }
   }
-  buf[top] = 0; // NUL terminator
+  buf[top] = 0; // NUL terminator
+
+  result = toml_parse_ex(buf, top, opt);
+  mem_t *mem = (mem_t *)result.__internal;
+  if (mem && (mem->borrow || mem->lazy)) {
+    // strings or lazy sections point into buf; release it in toml_free().
+    mem->srcbuf = buf;
+  } else {
+    FREE(opt, buf);
+  }
+  return result;
+}
+
+/**
+ *  Parse a toml document.
+ */
+toml_result_t toml_parse(const char *src, int len) {
+  // Check that src is NUL terminated.
+  if (src[len]) {
+    toml_result_t result = {0};
+    snprintf(result.errmsg, sizeof(result.errmsg),
+             "src[] must be NUL terminated");
+    return result;
+  }
+  return toml_parse_n(src, len);
+}
+
+// Parse the next step of a document: a blank line, an expression, or
+// the newline that must follow an expression. *need_endl tracks the
+// latter between calls. Set *fin at the end of the input. Return 0 on
+// success, -1 otherwise.
+static int parse_step(parser_t *pp, bool *need_endl, bool *fin) {
+  token_t tok;
+  DO(scan_key(&pp->scanner, &tok));
+  if (tok.toktyp == TOK_FIN) {
+    *fin = true;
+    return 0;
+  }
+  if (*need_endl) {
+    // each expression must be followed by newline
+    if (tok.toktyp != TOK_ENDL) {
+      return RETERROR(pp->ebuf, tok.lineno, "ENDL expected");
+    }
+    *need_endl = false;
+    return 0;
+  }
+  switch (tok.toktyp) {
+  case TOK_ENDL: // skip blank lines
+    return 0;
+  case TOK_LBRACK:
+    DO(parse_std_table_expr(pp, tok));
+    break;
+  case TOK_LLBRACK:
+    DO(parse_array_table_expr(pp, tok));
+    break;
+  default:
+    // non-blank line: parse an expression
+    DO(parse_keyvalue_expr(pp, tok));
+    break;
+  }
+  *need_endl = true;
+  return 0;
+}
+
+// Parse all expressions of the document into pp->toptab. Return 0 on
+// success, -1 otherwise.
+static int parse_toml(parser_t *pp) {
+  bool need_endl = false;
+  bool fin = false;
+  while (!fin) {
+    DO(parse_step(pp, &need_endl, &fin));
+  }
+  return 0;
+}
+
+/*
+ *  Lazy parsing. A quick skim of the source finds the table headers,
+ *  i.e., the lines that start with '[' outside of strings, comments and
+ *  multi-line arrays. The root table before the first header is parsed
+ *  right away, and so is every header, on a skeleton of empty tables,
+ *  so that malformed or conflicting headers are reported up front.
+ *
+ *  The sections are then grouped into units. The unit of a header is the
+ *  shallowest table on its key that some header defines: for [a.b.c]
+ *  and [a.b], it is a.b. Headers only name absolute keys, so no section
+ *  outside a unit touches the tables inside it. Each unit gets a lazy_t
+ *  that records the byte ranges of its sections, and a placeholder in
+ *  the tree flagged FLAG_LAZY. lazy_load() parses the sections on first
+ *  use; the placeholder itself is left alone. A unit that the root table
+ *  already reaches into is parsed right away instead.
+ */
+typedef struct lazysec_t lazysec_t;
+struct lazysec_t {
+  int off, len; // section is src[off, off + len)
+  int lineno;   // line number of src[off]
+  bool split;   // starts a new element of an array of tables
+};
+
+struct lazy_t {
+  lazy_t *next;
+  mem_t *mem;
+  const char *src;
+  bool check_utf8;
+  int depth;      // #keys down to the table of the unit
+  lazysec_t *sec; // sections in document order
+  int nsec, maxsec;
+  int state;          // 0: not parsed yet; 1: parsed; -1: failed
+  toml_datum_t value; // valid if state is 1
+  char errmsg[200];   // valid if state is -1
+};
+
+// A placeholder keeps its lazy_t where a table keeps value[]; it has no
+// entries, so nothing else looks there.
+static inline lazy_t *lazy_of(toml_datum_t datum) {
+  return (datum.flag & FLAG_LAZY) ? (lazy_t *)(void *)datum.u.tab.value
+                                  : NULL;
+}
+
+// Release all lazy records of mem.
+static void lazy_destroy(mem_t *mem) {
+  while (mem->lazy) {
+    lazy_t *lz = mem->lazy;
+    mem->lazy = lz->next;
+    datum_free(mem, &lz->value);
+    FREE(&mem->opt, lz->sec);
+    FREE(&mem->opt, lz);
+  }
+}
+
+// Parse sections sec[0..nsec) of unit lz into *ret, allocating from
+// mem. Return 0 on success, -1 otherwise.
+static int unit_parse(lazy_t *lz, const lazysec_t *sec, int nsec, mem_t *mem,
+                      ebuf_t ebuf, toml_datum_t *ret) {
+  parser_t parser = {0};
+  parser_t *pp = &parser;
+  pp->toptab = mkdatum(TOML_TABLE);
+  pp->curtab = &pp->toptab;
+  pp->mem = mem;
+  pp->ebuf = ebuf;
+  pp->opt = &mem->opt;
+  for (int i = 0; i < nsec; i++) {
+    scan_init(&pp->scanner, lz->src + sec[i].off, sec[i].len, ebuf.ptr,
+              ebuf.len, lz->check_utf8);
+    pp->scanner.lineno = sec[i].lineno;
+    if (parse_toml(pp)) {
+      datum_free(mem, &pp->toptab);
+      return -1;
+    }
+  }
+  // Each table above the unit holds only the next one; take the unit
+  // out of the tree.
+  toml_datum_t *p = &pp->toptab;
+  for (int i = 0; i < lz->depth; i++) {
+    assert(p->type == TOML_TABLE && p->u.tab.size == 1);
+    p = &p->u.tab.value[0];
+  }
+  *ret = *p;
+  *p = DATUM_ZERO;
+  datum_free(mem, &pp->toptab);
+  return 0;
+}
+
+// Parse the sections of lz into lz->value, once. Return 0 on success,
+// -1 otherwise.
+static int lazy_parse(lazy_t *lz) {
+  if (lz->state == 0) {
+    ebuf_t ebuf = {lz->errmsg, sizeof(lz->errmsg)};
+    bool ok = (0 == unit_parse(lz, lz->sec, lz->nsec, lz->mem, ebuf,
+                               &lz->value));
+    lz->state = ok ? 1 : -1;
+  }
+  return lz->state > 0 ? 0 : -1;
+}
+
+// If *datum is a placeholder, replace it with the parsed unit. Return 0
+// on success, -1 otherwise.
+static int lazy_load(toml_datum_t *datum, const char **reason) {
+  lazy_t *lz = lazy_of(*datum);
+  if (lz) {
+    if (lazy_parse(lz)) {
+      *reason = lz->errmsg;
+      return -1;
+    }
+    uint32_t shared = datum->flag & FLAG_SHARED;
+    *datum = lz->value;
+    datum->flag |= shared;
+  }
+  return 0;
+}
+
+const char *toml_lazy_error(const toml_result_t *result) {
+  mem_t *mem = (mem_t *)result->__internal;
+  const char *ret = NULL;
+  // The list is newest first; report the error of the first unit.
+  for (lazy_t *lz = mem ? mem->lazy : NULL; lz; lz = lz->next) {
+    if (lz->state < 0) {
+      ret = lz->errmsg;
+    }
+  }
+  return ret;
+}
+
+// A table header, found by skim_headers().
+typedef struct hdr_t hdr_t;
+struct hdr_t {
+  int off;    // offset of its '['
+  int lineno; // its line number
+  int key;    // its key is key[key, key + nkey) of parse_lazy()
+  int nkey;
+  uint32_t hash; // of its key
+};
+
+// Skip the string that starts at p. Return the char after it, or NULL
+// if it is not terminated. Newlines in it are added to *lineno.
+static const char *skim_string(const char *p, const char *endp,
+                               int *lineno) {
+  char q = *p;
+  if (!(endp - p >= 3 && p[1] == q && p[2] == q)) {
+    for (p++; p < endp && *p != q && *p != '\n'; p++) {
+      if (*p == '\\' && q == '"' && p + 1 < endp && p[1] != '\n') {
+        p++;
+      }
+    }
+    return (p < endp && *p == q) ? p + 1 : NULL;
+  }
+  for (p += 3; p < endp; p++) {
+    if (*p == '\n') {
+      (*lineno)++;
+    } else if (*p == '\\' && q == '"' && p + 1 < endp) {
+      if (*++p == '\n') {
+        (*lineno)++;
+      }
+    } else if (*p == q && endp - p >= 3 && p[1] == q && p[2] == q) {
+      // Up to two more quotes are part of the string.
+      p += 3;
+      for (int i = 0; i < 2 && p < endp && *p == q; i++) {
+        p++;
+      }
+      return p;
+    }
+  }
+  return NULL;
+}
+
+// Find the table headers in src[0..len). Return their count and set
+// *ret to them, allocated with opt, or -1 if the skim cannot make sense
+// of src[].
+static int skim_headers(const toml_option_t *opt, const char *src, int len,
+                        hdr_t **ret) {
+  // chars that the skim must look at
+  static const bool special[256] = {
+      ['"'] = 1, ['\''] = 1, ['#'] = 1, ['['] = 1,
+      [']'] = 1, ['{'] = 1,  ['}'] = 1, ['\n'] = 1,
+  };
+  const char *p = src;
+  const char *endp = src + len;
+  hdr_t *hdr = NULL;
+  int nhdr = 0, maxhdr = 0;
+  int lineno = 1;
+  int depth = 0; // open brackets and braces of values
+
+  while (p < endp) {
+    // At the start of a line.
+    p = scan_blank(p, endp);
+    bool inhdr = (depth == 0 && p < endp && *p == '[');
+    if (inhdr) {
+      if (nhdr == maxhdr) {
+        int newmax = grow_capacity(maxhdr, nhdr + 1);
+        hdr_t *tmp = REALLOC(opt, hdr, newmax * sizeof(*hdr));
+        if (!tmp) {
+          goto bail;
+        }
+        hdr = tmp;
+        maxhdr = newmax;
+      }
+      hdr[nhdr++] = (hdr_t){.off = p - src, .lineno = lineno};
+    }
+    // Skim the rest of the line. Brackets of a header are not counted.
+    while (p < endp && *p != '\n') {
+      if (!special[(unsigned char)*p]) {
+        p++;
+        continue;
+      }
+      switch (*p) {
+      case '"':
+      case '\'':
+        p = skim_string(p, endp, &lineno);
+        if (!p) {
+          goto bail;
+        }
+        continue;
+      case '#':
+        p = memchr(p, '\n', endp - p);
+        p = p ? p : endp;
+        continue;
+      case '[':
+      case '{':
+        depth += !inhdr;
+        break;
+      case ']':
+      case '}':
+        depth -= !inhdr;
+        if (depth < 0) {
+          goto bail;
+        }
+        break;
+      }
+      p++;
+    }
+    if (p < endp) {
+      p++;
+      lineno++;
+    }
+  }
+  if (depth) {
+    goto bail;
+  }
+  *ret = hdr;
+  return nhdr;
+
+bail:
+  FREE(opt, hdr);
+  return -1;
+}
+
+// Hash a key path one keypart at a time, starting from h = 0.
+static inline uint32_t path_hash(uint32_t h, span_t keypart) {
+  return (h ^ hash_key(keypart.ptr, keypart.len)) * 0x9e3779b1u;
+}
+
+/*
+ *  The set of header keys, for finding the unit of a header. slot[] is
+ *  an open-addressing hash table of 1 + the index of the first header
+ *  with a key, or 0 if empty.
+ */
+typedef struct hdrset_t hdrset_t;
+struct hdrset_t {
+  const hdr_t *hdr;
+  const span_t *key; // of parse_lazy()
+  int32_t *slot;
+  uint32_t mask;
+};
+
+// Find the first header whose key is key[0..nkey) with hash h. Add hdr[i]
+// if there is none and i >= 0. Return its index, or -1 if not found.
+static int hdrset_find(hdrset_t *set, const span_t *key, int nkey,
+                       uint32_t h, int i) {
+  uint32_t k = h & set->mask;
+  for (; set->slot[k]; k = (k + 1) & set->mask) {
+    const hdr_t *p = &set->hdr[set->slot[k] - 1];
+    if (p->hash != h || p->nkey != nkey) {
+      continue;
+    }
+    const span_t *pkey = set->key + p->key;
+    int d = 0;
+    while (d < nkey && pkey[d].len == key[d].len &&
+           0 == memcmp(pkey[d].ptr, key[d].ptr, key[d].len)) {
+      d++;
+    }
+    if (d == nkey) {
+      return set->slot[k] - 1;
+    }
+  }
+  if (i >= 0) {
+    set->slot[k] = i + 1;
+  }
+  return i;
+}
+
+// Parse the header at the scanner of pp, and check that a newline or the
+// end follows it. Set *ret to its key. Return 0 on success, -1
+// otherwise.
+static int parse_header_key(parser_t *pp, keypart_t *ret) {
+  token_t tok;
+  DO(scan_key(&pp->scanner, &tok));
+  bool array = (tok.toktyp == TOK_LLBRACK);
+  DO(scan_key(&pp->scanner, &tok));
+  DO(parse_key(pp, tok, ret));
+  DO(scan_key(&pp->scanner, &tok));
+  if (tok.toktyp != (array ? TOK_RRBRACK : TOK_RBRACK)) {
+    return RETERROR(pp->ebuf, tok.lineno,
+                    array ? "missing ']]'" : "missing right-bracket");
+  }
+  DO(scan_key(&pp->scanner, &tok));
+  if (tok.toktyp != TOK_ENDL && tok.toktyp != TOK_FIN) {
+    return RETERROR(pp->ebuf, tok.lineno, "ENDL expected");
+  }
+  return 0;
+}
+
+// Find the unit at key[0..depth) in pp->toptab, adding the tables above
+// it and a placeholder for it if it is new. Set *ret to its lazy_t, or
+// to NULL if its sections must be parsed now because the root table
+// reaches into it. Return 0 on success, -1 if out of memory.
+static int lazy_find(parser_t *pp, const char *src, const span_t *key,
+                     int depth, bool array, lazy_t **ret) {
+  *ret = NULL;
+  const char *reason;
+  toml_datum_t *tab = &pp->toptab;
+  for (int i = 0; i < depth - 1; i++) {
+    int j = tab_find(tab, key[i]);
+    if (j < 0) {
+      toml_datum_t newtab = mkdatum(TOML_TABLE);
+      newtab.flag |= FLAG_STDEXPR;
+      DO(tab_add(pp->mem, tab, key[i], newtab, &reason));
+      j = tab->u.tab.size - 1;
+    }
+    tab = &tab->u.tab.value[j];
+    if (tab->type != TOML_TABLE || (tab->flag & FLAG_INLINED)) {
+      return 0;
+    }
+  }
+  int j = tab_find(tab, key[depth - 1]);
+  if (j >= 0) {
+    *ret = lazy_of(tab->u.tab.value[j]);
+    return 0;
+  }
+
+  lazy_t *lz = MALLOC(pp->opt, sizeof(*lz));
+  if (!lz) {
+    return -1;
+  }
+  memset(lz, 0, sizeof(*lz));
+  lz->mem = pp->mem;
+  lz->src = src;
+  lz->check_utf8 = pp->opt->check_utf8;
+  lz->depth = depth;
+  lz->next = pp->mem->lazy;
+  pp->mem->lazy = lz;
+
+  toml_datum_t placeholder = mkdatum(array ? TOML_ARRAY : TOML_TABLE);
+  placeholder.flag |= FLAG_LAZY;
+  placeholder.u.tab.value = (toml_datum_t *)(void *)lz;
+  DO(tab_add(pp->mem, tab, key[depth - 1], placeholder, &reason));
+  *ret = lz;
+  return 0;
+}
+
+// Add section src[off, off + len) to lz. Return 0 on success, -1
+// otherwise.
+static int lazy_add_section(lazy_t *lz, int off, int len, int lineno,
+                            bool split) {
+  if (lz->nsec == lz->maxsec) {
+    int newmax = grow_capacity(lz->maxsec, lz->nsec + 1);
+    lazysec_t *tmp = REALLOC(&lz->mem->opt, lz->sec, newmax * sizeof(*tmp));
+    if (!tmp) {
+      return -1;
+    }
+    lz->sec = tmp;
+    lz->maxsec = newmax;
+  }
+  lz->sec[lz->nsec++] = (lazysec_t){off, len, lineno, split};
+  return 0;
+}
+
+// Parse src[0..len) into pp->toptab, leaving units for lazy_load().
+// The scanner of pp is set up for all of src[]. If check is set, the
+// headers are checked against each other up front; otherwise only their
+// syntax is, and the rest is left to the parse of each unit. Return 0 on
+// success, -1 otherwise.
+static int parse_lazy(parser_t *pp, const char *src, int len, bool check) {
+  hdr_t *hdr;
+  int nhdr = skim_headers(pp->opt, src, len, &hdr);
+  if (nhdr <= 0) {
+    // Nothing to defer, or a malformed document: parse it all now.
+    return parse_toml(pp);
+  }
+
+  int ret = -1;
+  span_t *key = NULL; // keys of all headers
+  int nkey = 0, maxkey = 0;
+  hdrset_t set = {0};
+  lazy_t **unit = NULL; // unit[i] is the unit defined by hdr[i], if any
+  // eager[i] is set if the root table reaches into the unit of hdr[i],
+  // whose sections are then parsed now.
+  bool *eager = NULL;
+  parser_t skeleton = {0};
+  skeleton.toptab = mkdatum(TOML_TABLE);
+  skeleton.mem = pp->mem;
+  skeleton.ebuf = pp->ebuf;
+  skeleton.opt = pp->opt;
+
+  // The root table.
+  scan_init(&pp->scanner, src, hdr[0].off, pp->ebuf.ptr, pp->ebuf.len,
+            pp->opt->check_utf8);
+  if (parse_toml(pp)) {
+    goto bail;
+  }
+
+  // Parse the key of each header, followed by a newline or the end.
+  for (int i = 0; i < nhdr; i++) {
+    int end = (i + 1 < nhdr ? hdr[i + 1].off : len);
+    keypart_t keypart;
+    if (check) {
+      scan_init(&skeleton.scanner, src + hdr[i].off, end - hdr[i].off,
+                pp->ebuf.ptr, pp->ebuf.len, pp->opt->check_utf8);
+      skeleton.scanner.lineno = hdr[i].lineno;
+      bool need_endl = false;
+      bool fin = false;
+      if (parse_step(&skeleton, &need_endl, &fin) ||
+          parse_step(&skeleton, &need_endl, &fin)) {
+        goto bail;
+      }
+      keypart = skeleton.hdrkey;
+    } else {
+      scan_init(&pp->scanner, src + hdr[i].off, end - hdr[i].off,
+                pp->ebuf.ptr, pp->ebuf.len, pp->opt->check_utf8);
+      pp->scanner.lineno = hdr[i].lineno;
+      if (parse_header_key(pp, &keypart)) {
+        goto bail;
+      }
+    }
+    int n = keypart.nspan;
+    if (nkey + n > maxkey) {
+      int newmax = grow_capacity(maxkey, nkey + n);
+      span_t *tmp = REALLOC(pp->opt, key, newmax * sizeof(*tmp));
+      if (!tmp) {
+        RETERROR(pp->ebuf, 0, "out of memory");
+        goto bail;
+      }
+      key = tmp;
+      maxkey = newmax;
+    }
+    memcpy(key + nkey, keypart.span, n * sizeof(*key));
+    hdr[i].key = nkey;
+    hdr[i].nkey = n;
+    hdr[i].hash = 0;
+    for (int j = 0; j < n; j++) {
+      hdr[i].hash = path_hash(hdr[i].hash, keypart.span[j]);
+    }
+    nkey += n;
+  }
+
+  // Index the headers by key.
+  int nslot = 1;
+  while (nslot < nhdr * 2) {
+    nslot *= 2;
+  }
+  set.hdr = hdr;
+  set.key = key;
+  set.mask = nslot - 1;
+  set.slot = MALLOC(pp->opt, sizeof(*set.slot) * nslot);
+  unit = MALLOC(pp->opt, sizeof(*unit) * nhdr);
+  eager = MALLOC(pp->opt, sizeof(*eager) * nhdr);
+  if (!set.slot || !unit || !eager) {
+    RETERROR(pp->ebuf, 0, "out of memory");
+    goto bail;
+  }
+  memset(set.slot, 0, sizeof(*set.slot) * nslot);
+  memset(unit, 0, sizeof(*unit) * nhdr);
+  memset(eager, 0, sizeof(*eager) * nhdr);
+  for (int i = 0; i < nhdr; i++) {
+    hdrset_find(&set, key + hdr[i].key, hdr[i].nkey, hdr[i].hash, i);
+  }
+
+  // Put each section in its unit: that of the shortest prefix of its key
+  // that a header defines.
+  for (int i = 0; i < nhdr; i++) {
+    int end = (i + 1 < nhdr ? hdr[i + 1].off : len);
+    const span_t *k = key + hdr[i].key;
+    uint32_t h = 0;
+    int depth = 0;
+    int j = -1;
+    while (j < 0) {
+      h = path_hash(h, k[depth]);
+      j = hdrset_find(&set, k, ++depth, h, -1);
+    }
+    // hdr[j] defines the unit. It is an array of tables if hdr[j] is
+    // [[key]].
+    bool array = (src[hdr[j].off + 1] == '[');
+    if (!unit[j] && !eager[j]) {
+      if (lazy_find(pp, src, k, depth, array, &unit[j])) {
+        RETERROR(pp->ebuf, 0, "out of memory");
+        goto bail;
+      }
+      eager[j] = !unit[j];
+    }
+    if (eager[j]) {
+      scan_init(&pp->scanner, src + hdr[i].off, end - hdr[i].off,
+                pp->ebuf.ptr, pp->ebuf.len, pp->opt->check_utf8);
+      pp->scanner.lineno = hdr[i].lineno;
+      if (parse_toml(pp)) {
+        goto bail;
+      }
+    } else if (lazy_add_section(unit[j], hdr[i].off, end - hdr[i].off,
+                                hdr[i].lineno,
+                                array && hdr[i].nkey == depth)) {
+      RETERROR(pp->ebuf, 0, "out of memory");
+      goto bail;
+    }
+  }
+  ret = 0;
+
+bail:
+  datum_free(pp->mem, &skeleton.toptab);
+  FREE(pp->opt, set.slot);
+  FREE(pp->opt, eager);
+  FREE(pp->opt, unit);
+  FREE(pp->opt, key);
+  FREE(pp->opt, hdr);
+  return ret;
+}
+
+/**
+ *  Parse a toml document of exactly len bytes. Never reads src[len].
+ */
+toml_result_t toml_parse_n(const char *src, int len) {
+  return toml_parse_ex(src, len, &toml_option);
+}
+
+/**
+ *  Parse a toml document of exactly len bytes with the options opt.
+ */
+toml_result_t toml_parse_ex(const char *src, int len,
+                            const toml_option_t *opt) {
+  toml_result_t result = {0};
+  parser_t parser = {0};
+  parser_t *pp = &parser;
+
+  // Initialize parser
+  pp->toptab = mkdatum(TOML_TABLE);
+  pp->curtab = &pp->toptab;
+  pp->ebuf.ptr = result.errmsg;
+  pp->ebuf.len = sizeof(result.errmsg);
+  pp->opt = opt;
+
+  // Alloc memory. Add some extra bytes to the pool for NUL term and safety.
+  pp->mem = mem_create(opt, len + 10, len);
+  if (!pp->mem) {
+    snprintf(result.errmsg, sizeof(result.errmsg), "out of memory");
+    goto bail;
+  }
+  if (opt->borrow_src) {
+    pp->mem->borrow = src;
+  }
+
+  // Initialize scanner.
+  scan_init(&pp->scanner, src, len, pp->ebuf.ptr, pp->ebuf.len,
+            opt->check_utf8);
+
+  if (opt->lazy ? parse_lazy(pp, src, len, true) : parse_toml(pp)) {
+    goto bail;
+  }
+
+  // return result
+  result.ok = true;
+  result.toptab = pp->toptab;
+  result.__internal = (void *)pp->mem;
+  return result;
+
+bail:
+  // return error
+  mem_destroy(pp->mem, &pp->toptab);
+  result.ok = false;
+  assert(result.errmsg[0]); // make sure there is an errmsg
+  return result;
+}
+
+/*
+ *  Parser context. Its memory holds the results of all the parses made
+ *  with it. toml_context_reset() releases them but keeps the memory, as
+ *  a single pool block and a single arena chunk big enough for what was
+ *  used, so that parsing the same load again allocates nothing.
+ */
+struct toml_context_t {
+  mem_t *mem;
+};
+
+toml_context_t *toml_context_new(void) {
+  return toml_context_new_ex(&toml_option);
+}
+
+toml_context_t *toml_context_new_ex(const toml_option_t *opt) {
+  toml_context_t *ctx = MALLOC(opt, sizeof(*ctx));
+  if (!ctx) {
+    return NULL;
+  }
+  ctx->mem = mem_create(opt, 0, 0);
+  if (ctx->mem && !ctx->mem->arena) {
+    // Tables and arrays always come from the arena, to be reused.
+    ctx->mem->arena = arena_create(&ctx->mem->opt, 0);
+    if (!ctx->mem->arena) {
+      mem_destroy(ctx->mem, &(toml_datum_t){0});
+      ctx->mem = NULL;
+    }
+  }
+  if (!ctx->mem) {
+    FREE(opt, ctx);
+    return NULL;
+  }
+  ctx->mem->kept = true;
+  return ctx;
+}
+
+void toml_context_reset(toml_context_t *ctx) {
+  if (ctx) {
+    ctx->mem->pool = pool_reset(ctx->mem->pool, 0);
+    arena_reset(ctx->mem->arena);
+    ctx->mem->keys = mkdatum(TOML_TABLE);
+  }
+}
+
+void toml_context_free(toml_context_t *ctx) {
+  if (ctx) {
+    toml_option_t opt = ctx->mem->opt;
+    ctx->mem->kept = false;
+    mem_destroy(ctx->mem, &(toml_datum_t){0});
+    FREE(&opt, ctx);
+  }
+}
+
+/**
+ *  Parse a toml document of exactly len bytes into the memory of ctx.
+ */
+toml_result_t toml_parse_with(toml_context_t *ctx, const char *src, int len) {
+  toml_result_t result = {0};
+  parser_t parser = {0};
+  parser_t *pp = &parser;
+
+  if (!ctx) {
+    snprintf(result.errmsg, sizeof(result.errmsg), "out of memory");
+    return result;
+  }
+
+  // Initialize parser
+  pp->toptab = mkdatum(TOML_TABLE);
+  pp->curtab = &pp->toptab;
+  pp->ebuf.ptr = result.errmsg;
+  pp->ebuf.len = sizeof(result.errmsg);
+
+  // If this is the first parse since the reset, size the pool for the
+  // document as toml_parse_n() does.
+  pp->mem = ctx->mem;
+  pp->opt = &ctx->mem->opt;
+  if (pool_used(pp->mem->pool) == 0) {
+    pp->mem->pool = pool_reset(pp->mem->pool, len + 10);
+  }
+  pp->mem->borrow = (pp->opt->borrow_src ? src : NULL);
+
+  // Initialize scanner.
+  scan_init(&pp->scanner, src, len, pp->ebuf.ptr, pp->ebuf.len,
+            pp->opt->check_utf8);
+
+  if (parse_toml(pp)) {
+    // What the parse allocated stays in ctx until the next reset.
+    result.ok = false;
+    assert(result.errmsg[0]); // make sure there is an errmsg
+    return result;
+  }
+
+  // return result
+  result.ok = true;
+  result.toptab = pp->toptab;
+  result.__internal = (void *)pp->mem;
+  return result;
+}
+
+/*
+ *  Parallel parsing. The document is split as for lazy parsing: the
+ *  root table and the headers are parsed on the calling thread, and the
+ *  units are then parsed by the workers, each into a memory of its own.
+ *  An array of tables is cut into pieces at its own [[key]] headers so
+ *  that a big one is spread over the workers too; the pieces are joined
+ *  again in order. Last, each placeholder in the tree is replaced by its
+ *  unit.
+ */
+#define TASK_MIN (64 << 10) // bytes of source per task, at least
+
+typedef struct piece_t piece_t;
+struct piece_t {
+  lazy_t *lz;
+  int sec, nsec;      // the sections are lz->sec[sec, sec + nsec)
+  toml_datum_t value; // the parsed sections
+};
+
+typedef struct workset_t workset_t;
+struct workset_t {
+  piece_t *piece; // in document order of units
+  int npiece;
+  int *task; // task i is piece[task[i], task[i + 1])
+  int ntask;
+  int next; // next task to take
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t mutex;
+#endif
+};
+
+typedef struct worker_t worker_t;
+struct worker_t {
+  workset_t *ws;
+  mem_t *mem;
+  int errline; // line of errmsg[], or INT_MAX if no error
+  char errmsg[200];
+#ifdef HAVE_PTHREAD
+  pthread_t thread;
+#endif
+};
+
+// Take the next task of ws. Return its index, or -1 if none is left.
+static int workset_take(workset_t *ws) {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&ws->mutex);
+#endif
+  int ret = (ws->next < ws->ntask ? ws->next++ : -1);
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&ws->mutex);
+#endif
+  return ret;
+}
+
+// Parse tasks until there are none left. Keep the error on the lowest
+// line, which is the one a serial parse reports.
+static void *worker_run(void *arg) {
+  worker_t *w = (worker_t *)arg;
+  workset_t *ws = w->ws;
+  char errmsg[sizeof(w->errmsg)];
+  ebuf_t ebuf = {errmsg, sizeof(errmsg)};
+  for (int t; (t = workset_take(ws)) >= 0;) {
+    for (int i = ws->task[t]; i < ws->task[t + 1]; i++) {
+      piece_t *pc = &ws->piece[i];
+      errmsg[0] = 0;
+      if (unit_parse(pc->lz, pc->lz->sec + pc->sec, pc->nsec, w->mem, ebuf,
+                     &pc->value)) {
+        int line = 0;
+        sscanf(errmsg, "(line %d)", &line);
+        if (line < w->errline) {
+          w->errline = line;
+          memcpy(w->errmsg, errmsg, sizeof(errmsg));
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+// Cut the units of mem into pieces of about target bytes, and group the
+// pieces into tasks of about target bytes. Return 0 on success, -1 if
+// out of memory.
+static int workset_init(workset_t *ws, mem_t *mem, int target) {
+  // Units are listed newest first; count them and their sections.
+  int nunit = 0, nsec = 0;
+  for (lazy_t *lz = mem->lazy; lz; lz = lz->next) {
+    nunit++;
+    nsec += lz->nsec;
+  }
+  lazy_t **unit = MALLOC(&mem->opt, sizeof(*unit) * (nunit + 1));
+  ws->piece = MALLOC(&mem->opt, sizeof(*ws->piece) * (nsec + 1));
+  ws->task = MALLOC(&mem->opt, sizeof(*ws->task) * (nsec + 1));
+  if (!unit || !ws->piece || !ws->task) {
+    FREE(&mem->opt, unit);
+    return -1;
+  }
+  int n = nunit;
+  for (lazy_t *lz = mem->lazy; lz; lz = lz->next) {
+    unit[--n] = lz;
+  }
+
+  // Close a task once it has target bytes, and after the last piece.
+  int bytes = 0; // in the current task
+  for (int i = 0; i < nunit; i++) {
+    lazy_t *lz = unit[i];
+    int start = 0;
+    int len = 0; // of the current piece
+    for (int j = 0; j <= lz->nsec; j++) {
+      if (j == lz->nsec || (lz->sec[j].split && len >= target)) {
+        ws->piece[ws->npiece++] = (piece_t){lz, start, j - start, {0}};
+        bytes += len;
+        if (bytes >= target) {
+          ws->task[++ws->ntask] = ws->npiece;
+          bytes = 0;
+        }
+        start = j;
+        len = 0;
+      }
+      len += (j < lz->nsec ? lz->sec[j].len : 0);
+    }
+  }
+  if (bytes) {
+    ws->task[++ws->ntask] = ws->npiece;
+  }
+  ws->task[0] = 0;
+  FREE(&mem->opt, unit);
+  return 0;
+}
+
+// Join the pieces of each unit into lz->value. Return 0 on success, -1
+// if out of memory.
+static int workset_join(workset_t *ws, mem_t *mem) {
+  const char *reason;
+  for (int i = 0; i < ws->npiece; i++) {
+    piece_t *pc = &ws->piece[i];
+    lazy_t *lz = pc->lz;
+    if (lz->state == 0) {
+      lz->value = pc->value;
+      lz->state = 1;
+      pc->value = DATUM_ZERO;
+      continue;
+    }
+    // A later piece of an array of tables: append its elements.
+    toml_datum_t *arr = &lz->value;
+    int n = arr->u.arr.size;
+    int m = pc->value.u.arr.size;
+    DO(arr_reserve(mem, arr, n + m, &reason));
+    memcpy(arr->u.arr.elem + n, pc->value.u.arr.elem, sizeof(toml_datum_t) * m);
+    arr->u.arr.size = n + m;
+    mem_free(mem, arr_meta(&pc->value));
+    pc->value = DATUM_ZERO;
+  }
+  return 0;
+}
+
+// Replace the placeholders under tab by their units.
+static void unit_splice(toml_datum_t *tab) {
+  for (int i = 0; i < tab->u.tab.size; i++) {
+    toml_datum_t *value = &tab->u.tab.value[i];
+    lazy_t *lz = lazy_of(*value);
+    if (lz) {
+      *value = lz->value;
+      lz->value = DATUM_ZERO;
+    } else if (value->type == TOML_TABLE && !(value->flag & FLAG_INLINED)) {
+      unit_splice(value);
+    }
+  }
+}
+
+// Replace each key under d by its interned copy in mem. Return 0 on
+// success, -1 otherwise.
+static int datum_intern(mem_t *mem, toml_datum_t *d, const char **reason) {
+  if (d->type == TOML_TABLE) {
+    for (int i = 0; i < d->u.tab.size; i++) {
+      span_t key = {d->u.tab.key[i], d->u.tab.len[i]};
+      DO(mem_intern(mem, &key, false, reason));
+      d->u.tab.key[i] = (char *)key.ptr;
+      DO(datum_intern(mem, &d->u.tab.value[i], reason));
+    }
+  } else if (d->type == TOML_ARRAY) {
+    for (int i = 0; i < d->u.arr.size; i++) {
+      DO(datum_intern(mem, &d->u.arr.elem[i], reason));
+    }
+  }
+  return 0;
+}
+
+// Parse the units that parse_lazy() left in pp->toptab with nthreads
+// threads, and put them in the tree. Return 0 on success, -1 otherwise.
+static int parse_units(parser_t *pp, int len, int nthreads) {
+  int ret = -1;
+  workset_t ws = {0};
+  worker_t *worker = NULL;
+  int nworker = 0;
+
+  int target = len / nthreads / 16;
+  target = (target < TASK_MIN ? TASK_MIN : target);
+  if (workset_init(&ws, pp->mem, target)) {
+    RETERROR(pp->ebuf, 0, "out of memory");
+    goto bail;
+  }
+  nthreads = (nthreads < ws.ntask ? nthreads : ws.ntask);
+  if (nthreads == 0) {
+    ret = 0; // nothing was left
+    goto bail;
+  }
+
+  // Each worker allocates from its own memory, chained to pp->mem.
+  worker = MALLOC(pp->opt, sizeof(*worker) * (nthreads + 1));
+  if (!worker) {
+    RETERROR(pp->ebuf, 0, "out of memory");
+    goto bail;
+  }
+  for (; nworker < nthreads; nworker++) {
+    worker_t *w = &worker[nworker];
+    memset(w, 0, sizeof(*w));
+    w->ws = &ws;
+    w->errline = INT_MAX;
+    w->mem = mem_create(pp->opt, len / nthreads + 10, len / nthreads);
+    if (!w->mem) {
+      RETERROR(pp->ebuf, 0, "out of memory");
+      goto bail;
+    }
+    w->mem->borrow = pp->mem->borrow;
+    w->mem->next = pp->mem->next;
+    pp->mem->next = w->mem;
+  }
+
+  // Worker 0 is this thread. If a thread cannot be started, the others
+  // do its share.
+#ifdef HAVE_PTHREAD
+  pthread_mutex_init(&ws.mutex, NULL);
+  int nstarted = 1;
+  for (; nstarted < nworker; nstarted++) {
+    if (pthread_create(&worker[nstarted].thread, NULL, worker_run,
+                       &worker[nstarted])) {
+      break;
+    }
+  }
+  worker_run(&worker[0]);
+  for (int i = 1; i < nstarted; i++) {
+    pthread_join(worker[i].thread, NULL);
+  }
+  pthread_mutex_destroy(&ws.mutex);
+#else
+  worker_run(&worker[0]);
+#endif
+
+  // Report the error on the lowest line.
+  worker_t *first = &worker[0];
+  for (int i = 1; i < nworker; i++) {
+    first = (worker[i].errline < first->errline ? &worker[i] : first);
+  }
+  if (first->errline != INT_MAX) {
+    snprintf(pp->ebuf.ptr, pp->ebuf.len, "%s", first->errmsg);
+    goto bail;
+  }
+
+  if (workset_join(&ws, pp->mem)) {
+    RETERROR(pp->ebuf, 0, "out of memory");
+    goto bail;
+  }
+  unit_splice(&pp->toptab);
+  lazy_destroy(pp->mem);
+  // The units were parsed into the memory of their workers, with keys
+  // interned there.
+  const char *reason;
+  if (datum_intern(pp->mem, &pp->toptab, &reason)) {
+    RETERROR(pp->ebuf, 0, "%s", reason);
+    goto bail;
+  }
+  ret = 0;
+
+bail:
+  for (int i = 0; i < ws.npiece; i++) {
+    datum_free(pp->mem, &ws.piece[i].value);
+  }
+  FREE(pp->opt, ws.piece);
+  FREE(pp->opt, ws.task);
+  FREE(pp->opt, worker);
+  return ret;
+}
+
+/**
+ *  Parse a toml document of exactly len bytes with nthreads threads.
+ */
+toml_result_t toml_parse_parallel(const char *src, int len, int nthreads) {
+  return toml_parse_parallel_ex(src, len, nthreads, &toml_option);
+}
+
+toml_result_t toml_parse_parallel_ex(const char *src, int len, int nthreads,
+                                     const toml_option_t *opt) {
+  toml_result_t result = {0};
+  parser_t parser = {0};
+  parser_t *pp = &parser;
+
+#ifdef HAVE_PTHREAD
+  if (nthreads <= 0) {
+    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+#else
+  nthreads = 1;
+#endif
+  nthreads = (nthreads < 1 ? 1 : nthreads);
+
+  // Initialize parser
+  pp->toptab = mkdatum(TOML_TABLE);
+  pp->curtab = &pp->toptab;
+  pp->ebuf.ptr = result.errmsg;
+  pp->ebuf.len = sizeof(result.errmsg);
+  pp->opt = opt;
+
+  // The workers have memory of their own; this one holds the root
+  // table and the headers.
+  pp->mem = mem_create(pp->opt, len / nthreads + 10, len / nthreads);
+  if (!pp->mem) {
+    snprintf(result.errmsg, sizeof(result.errmsg), "out of memory");
+    goto bail;
+  }
+  if (pp->opt->borrow_src) {
+    pp->mem->borrow = src;
+  }
+
+  // Initialize scanner.
+  scan_init(&pp->scanner, src, len, pp->ebuf.ptr, pp->ebuf.len,
+            pp->opt->check_utf8);
+
+  // One thread gains nothing from splitting the document.
+  if (nthreads == 1 ? parse_toml(pp)
+                    : parse_lazy(pp, src, len, false) ||
+                          parse_units(pp, len, nthreads)) {
+    goto bail;
+  }
+
+  // return result
+  result.ok = true;
+  result.toptab = pp->toptab;
+  result.__internal = (void *)pp->mem;
+  return result;
+
+bail:
+  // return error
+  mem_destroy(pp->mem, &pp->toptab);
+  result.ok = false;
+  assert(result.errmsg[0]); // make sure there is an errmsg
+  return result;
+}
+
+/**
+ *  Parse a toml document of exactly len bytes into events for handler.
+ */
+toml_result_t toml_sax_parse(const char *src, int len,
+                             const toml_sax_handler_t *handler, void *ctx) {
+  return toml_sax_parse_ex(src, len, handler, ctx, &toml_option);
+}
+
+toml_result_t toml_sax_parse_ex(const char *src, int len,
+                                const toml_sax_handler_t *handler, void *ctx,
+                                const toml_option_t *opt) {
+  toml_result_t result = {0};
+  parser_t parser = {0};
+  parser_t *pp = &parser;
+
+  // Initialize parser
+  pp->toptab = mkdatum(TOML_TABLE);
+  pp->curtab = &pp->toptab;
+  pp->ebuf.ptr = result.errmsg;
+  pp->ebuf.len = sizeof(result.errmsg);
+  pp->opt = opt;
+  pp->sax = handler;
+  pp->saxctx = ctx;
+
+  // Strings and keys without escape chars point into src[], so the pool
+  // only holds unescaped copies. Its pages are faulted in as used.
+  pp->mem = mem_create(pp->opt, len + 10, len);
+  if (!pp->mem) {
+    snprintf(result.errmsg, sizeof(result.errmsg), "out of memory");
+    return result;
+  }
+  pp->mem->borrow = src;
+
+  // Initialize scanner.
+  scan_init(&pp->scanner, src, len, pp->ebuf.ptr, pp->ebuf.len,
+            pp->opt->check_utf8);
+
+  result.ok = (0 == parse_toml(pp));
+  assert(result.ok || result.errmsg[0]); // make sure there is an errmsg
+  result.toptab = mkdatum(TOML_TABLE);
+  mem_destroy(pp->mem, &pp->toptab);
+  return result;
+}
+
+/*
+ *  Push parser. Input is buffered until it holds complete lines. Each
+ *  feed then parses the expressions those lines hold into the tree and
+ *  drops their text, so the buffer only keeps what is not parsed yet.
+ *  An expression cut off at the last complete line (a multi-line array
+ *  or string) is undone and retried once the buffer has doubled.
+ */
+#define PUSH_POOL_MIN 4096
+struct toml_parser_t {
+  parser_t parser;
+  toml_result_t result; // errmsg[] for the parser
+  char *buf;            // unparsed input is buf[0..len)
+  int len, cap;
+  int lineno;     // line number of buf[0]
+  int retry_at;   // do not parse again until len reaches this
+  bool need_endl; // an expression was parsed, but not its newline
+  bool failed;    // result.errmsg[] has the error
+  toml_option_t opt;
+};
+
+/**
+ *  Create a push parser.
+ */
+toml_parser_t *toml_parser_new(void) {
+  return toml_parser_new_ex(&toml_option);
+}
+
+toml_parser_t *toml_parser_new_ex(const toml_option_t *opt) {
+  toml_parser_t *tp = MALLOC(opt, sizeof(*tp));
+  if (!tp) {
+    return NULL;
+  }
+  memset(tp, 0, sizeof(*tp));
+  tp->opt = *opt;
+  parser_t *pp = &tp->parser;
+  pp->opt = &tp->opt;
+  pp->toptab = mkdatum(TOML_TABLE);
+  pp->curtab = &pp->toptab;
+  pp->ebuf.ptr = tp->result.errmsg;
+  pp->ebuf.len = sizeof(tp->result.errmsg);
+  // The pool grows as needed. Nothing is borrowed from buf[], which
+  // is reused.
+  pp->mem = mem_create(pp->opt, PUSH_POOL_MIN, PUSH_POOL_MIN);
+  if (!pp->mem) {
+    FREE(pp->opt, tp);
+    return NULL;
+  }
+  tp->lineno = 1;
+  return tp;
+}
+
+// Parse the complete lines in buf[], or all of it if final, and drop
+// the text of what was parsed. Return 0 on success, even if the last
+// expression has to wait for more input; -1 on error.
+static int push_parse(toml_parser_t *tp, bool final) {
+  parser_t *pp = &tp->parser;
+  scanner_t *sp = &pp->scanner;
+  int n = tp->len;
+  if (!final) {
+    while (n > 0 && tp->buf[n - 1] != '\n') {
+      n--;
+    }
+  }
+  scan_init(sp, tp->buf, n, pp->ebuf.ptr, pp->ebuf.len,
+            pp->opt->check_utf8);
+  sp->lineno = tp->lineno;
+
+  // done is the end of the text that is in the tree.
+  const char *done = sp->cur;
+  int doneline = sp->lineno;
+  bool cutoff = false;
+  for (bool fin = false; !fin;) {
+    pool_mark_t mark = pool_mark(pp->mem->pool);
+    int nkey = pp->mem->keys.u.tab.size;
+    if (parse_step(pp, &tp->need_endl, &fin)) {
+      // Lines are complete, so an error before the end of them is real.
+      if (final || sp->cur < sp->endp) {
+        tp->failed = true;
+        return -1;
+      }
+      // Ran out of lines. The tree is only changed once an expression
+      // is fully scanned, so only the strings, and the keys interned
+      // with them, need undoing.
+      pool_rewind(pp->mem->pool, mark);
+      mem_unintern(pp->mem, nkey);
+      pp->ebuf.ptr[0] = 0;
+      cutoff = true;
+      break;
+    }
+    done = sp->cur;
+    doneline = sp->lineno;
+  }
+
+  int ndone = done - tp->buf;
+  if (ndone > 0) { // buf is NULL if nothing was fed
+    memmove(tp->buf, done, tp->len - ndone);
+  }
+  tp->len -= ndone;
+  tp->lineno = doneline;
+  tp->retry_at = cutoff ? 2 * tp->len : 0;
+  return 0;
+}
+
+/**
+ *  Append a chunk of input and parse what it completes.
+ */
+int toml_parser_feed(toml_parser_t *tp, const char *chunk, int len) {
+  if (!tp || tp->failed) {
+    return -1;
+  }
+  if (len > INT_MAX - tp->len) {
+    snprintf(tp->result.errmsg, sizeof(tp->result.errmsg),
+             "document too large");
+    tp->failed = true;
+    return -1;
+  }
+  if (tp->len + len > tp->cap) {
+    int cap = grow_capacity(tp->cap, tp->len + len);
+    char *buf = REALLOC(&tp->opt, tp->buf, cap);
+    if (!buf) {
+      snprintf(tp->result.errmsg, sizeof(tp->result.errmsg), "out of memory");
+      tp->failed = true;
+      return -1;
+    }
+    tp->buf = buf;
+    tp->cap = cap;
+  }
+  memcpy(tp->buf + tp->len, chunk, len);
+  tp->len += len;
+  if (tp->len < tp->retry_at) {
+    return 0;
+  }
+  return push_parse(tp, false);
+}
+
+/**
+ *  Parse the rest of the input and release the parser.
+ */
+toml_result_t toml_parser_finish(toml_parser_t *tp) {
+  toml_result_t result = {0};
+  if (!tp) {
+    snprintf(result.errmsg, sizeof(result.errmsg), "out of memory");
+    return result;
+  }
+  parser_t *pp = &tp->parser;
+  if (!tp->failed) {
+    push_parse(tp, true);
+  }
+  if (tp->failed) {
+    mem_destroy(pp->mem, &pp->toptab);
+    memcpy(result.errmsg, tp->result.errmsg, sizeof(result.errmsg));
+    assert(result.errmsg[0]); // make sure there is an errmsg
+  } else {
+    result.ok = true;
+    result.toptab = pp->toptab;
+    result.__internal = (void *)pp->mem;
+  }
+  toml_option_t opt = tp->opt;
+  FREE(&opt, tp->buf);
+  FREE(&opt, tp);
+  return result;
+}
+
+/*
+ *  Emitter. Output is gathered in a buffer and handed to the writer
+ *  each time the buffer fills up.
+ *
+ *  Keys keep their order. A table body lists its key/values first and
+ *  its sub-tables and arrays of tables last, as [a.b] and [[a.b]]
+ *  sections. A sub-table that comes before a key/value is written with
+ *  dotted keys instead, and an array of tables as an inline array, so
+ *  that the order is the same when the output is parsed again.
+ */
+typedef struct dumper_t dumper_t;
+struct dumper_t {
+  toml_writer_t writer;
+  void *ctx;
+  bool failed; // the writer stopped, or a lazy section failed to load
+  bool blank;  // output so far is empty
+  int len;     // #bytes in buf[]
+  char buf[4096];
+};
+
+// A key path, innermost last.
+typedef struct dumppath_t dumppath_t;
+struct dumppath_t {
+  const dumppath_t *up;
+  const char *key;
+  int len;
+};
+
+static void dump_flush(dumper_t *dp) {
+  if (dp->len && !dp->failed) {
+    dp->failed = (0 != dp->writer(dp->ctx, dp->buf, dp->len));
+  }
+  dp->len = 0;
+}
+
+static void dump_put(dumper_t *dp, const char *s, int n) {
+  if (dp->len + n > (int)sizeof(dp->buf)) {
+    dump_flush(dp);
+    if (n > (int)sizeof(dp->buf)) {
+      if (!dp->failed) {
+        dp->failed = (0 != dp->writer(dp->ctx, s, n));
+      }
+      return;
+    }
+  }
+  memcpy(dp->buf + dp->len, s, n);
+  dp->len += n;
+  dp->blank = false;
+}
+
+static inline void dump_char(dumper_t *dp, char ch) {
+  if (dp->len == (int)sizeof(dp->buf)) {
+    dump_flush(dp);
+  }
+  dp->buf[dp->len++] = ch;
+  dp->blank = false;
+}
+
+// Write s[0..len) as a basic string, which is also a JSON string.
+static void dump_string(dumper_t *dp, const char *s, int len) {
+  static const char hex[] = "0123456789ABCDEF";
+  dump_char(dp, '"');
+  const char *p = s;
+  const char *endp = s + len;
+  while (p < endp) {
+    // Copy the run of chars that need no escape in one go.
+    const char *q = scan_plain(p, endp, '"', '\\');
+    dump_put(dp, p, q - p);
+    if (q == endp) {
+      break;
+    }
+    char esc[6] = {'\\', 0};
+    int n = 2;
+    switch (*q) {
+    case '"':
+    case '\\':
+      esc[1] = *q;
+      break;
+    case '\b':
+      esc[1] = 'b';
+      break;
+    case '\t':
+      esc[1] = 't';
+      break;
+    case '\n':
+      esc[1] = 'n';
+      break;
+    case '\f':
+      esc[1] = 'f';
+      break;
+    case '\r':
+      esc[1] = 'r';
+      break;
+    default:
+      memcpy(esc + 1, "u00", 3);
+      esc[4] = hex[(unsigned char)*q >> 4];
+      esc[5] = hex[*q & 15];
+      n = 6;
+      break;
+    }
+    dump_put(dp, esc, n);
+    p = q + 1;
+  }
+  dump_char(dp, '"');
+}
+
+// Write a key, bare if it can be.
+static void dump_key(dumper_t *dp, const char *key, int len) {
+  bool bare = (len > 0);
+  for (int i = 0; bare && i < len; i++) {
+    int ch = (unsigned char)key[i];
+    bare = (isalnum(ch) || ch == '_' || ch == '-') && ch < 0x80;
+  }
+  if (bare) {
+    dump_put(dp, key, len);
+  } else {
+    dump_string(dp, key, len);
+  }
+}
+
+// Write the keys of path after stop, separated by dots.
+static void dump_path(dumper_t *dp, const dumppath_t *path,
+                      const dumppath_t *stop) {
+  if (path->up != stop) {
+    dump_path(dp, path->up, stop);
+    dump_char(dp, '.');
+  }
+  dump_key(dp, path->key, path->len);
+}
+
+// Format x into buf[] and return its length.
+static int format_int(int64_t x, char buf[24]) {
+  static const char digits2[] = "00010203040506070809"
+                                "10111213141516171819"
+                                "20212223242526272829"
+                                "30313233343536373839"
+                                "40414243444546474849"
+                                "50515253545556575859"
+                                "60616263646566676869"
+                                "70717273747576777879"
+                                "80818283848586878889"
+                                "90919293949596979899";
+  char tmp[24];
+  char *p = tmp + sizeof(tmp);
+  uint64_t u = (x < 0 ? -(uint64_t)x : (uint64_t)x);
+  // Two digits at a time.
+  while (u >= 100) {
+    int d = (u % 100) * 2;
+    u /= 100;
+    *--p = digits2[d + 1];
+    *--p = digits2[d];
+  }
+  if (u >= 10) {
+    *--p = digits2[u * 2 + 1];
+    *--p = digits2[u * 2];
+  } else {
+    *--p = '0' + u;
+  }
+  if (x < 0) {
+    *--p = '-';
+  }
+  int n = tmp + sizeof(tmp) - p;
+  memcpy(buf, p, n);
+  return n;
+}
+
+// Format x into buf[] as the shortest decimal that reads back as x,
+// and return its length.
+static int format_float(double x, char buf[32]) {
+  int n = 0;
+  if (signbit(x)) {
+    buf[n++] = '-';
+  }
+  if (isnan(x) || isinf(x) || x == 0) {
+    memcpy(buf + n, isnan(x) ? "nan" : isinf(x) ? "inf" : "0.0", 3);
+    return n + 3;
+  }
+  // The shortest digits that read back, laid out as by "%.*g" with a
+  // precision of at least 15, but independent of the locale.
+  char dig[17];
+  int e10;
+  int nd = shortest_digits(fabs(x), dig, &e10);
+  int prec = (nd > 15 ? nd : 15);
+  if (e10 < -4 || e10 >= prec) {
+    buf[n++] = dig[0];
+    if (nd > 1) {
+      buf[n++] = '.';
+      memcpy(buf + n, dig + 1, nd - 1);
+      n += nd - 1;
+    }
+    buf[n++] = 'e';
+    buf[n++] = (e10 < 0 ? '-' : '+');
+    e10 = abs(e10);
+    if (e10 >= 100) {
+      buf[n++] = (char)('0' + e10 / 100);
+    }
+    buf[n++] = (char)('0' + e10 / 10 % 10);
+    buf[n++] = (char)('0' + e10 % 10);
+  } else if (e10 < 0) {
+    memcpy(buf + n, "0.0000", 1 - e10);
+    n += 1 - e10;
+    memcpy(buf + n, dig, nd);
+    n += nd;
+  } else {
+    // nd <= 17 and e10 < prec, so the integer part has at most 17 digits.
+    int nint = e10 + 1;
+    for (int i = 0; i < nint; i++) {
+      buf[n++] = (i < nd ? dig[i] : '0');
+    }
+    buf[n++] = '.';
+    if (nd > nint) {
+      memcpy(buf + n, dig + nint, nd - nint);
+      n += nd - nint;
+    } else {
+      buf[n++] = '0';
+    }
+  }
+  return n;
+}
+
+// Format a date, time, or datetime into buf[] and return its length.
+static int format_ts(const toml_datum_t *d, char buf[64]) {
+  int n = 0;
+  int type = d->type;
+  if (type != TOML_TIME) {
+    n += snprintf(buf + n, 64 - n, "%04d-%02d-%02d", d->u.ts.year,
+                  d->u.ts.month, d->u.ts.day);
+  }
+  if (type != TOML_DATE) {
+    if (type != TOML_TIME) {
+      buf[n++] = 'T';
+    }
+    n += snprintf(buf + n, 64 - n, "%02d:%02d:%02d", d->u.ts.hour,
+                  d->u.ts.minute, d->u.ts.second);
+    if (d->u.ts.usec > 0) {
+      n += snprintf(buf + n, 64 - n, ".%06d", (int)d->u.ts.usec);
+      while (buf[n - 1] == '0') {
+        n--;
+      }
+    }
+  }
+  if (type == TOML_DATETIMETZ) {
+    int tz = d->u.ts.tz;
+    if (tz == 0) {
+      buf[n++] = 'Z';
+    } else {
+      int abstz = (tz < 0 ? -tz : tz);
+      n += snprintf(buf + n, 64 - n, "%c%02d:%02d", tz < 0 ? '-' : '+',
+                    abstz / 60, abstz % 60);
+    }
+  }
+  return n;
+}
+
+// Load *d if it is a lazy section. Return 0 on success, -1 otherwise.
+static int dump_load(dumper_t *dp, toml_datum_t *d) {
+  const char *reason;
+  if (lazy_load(d, &reason)) {
+    dp->failed = true;
+    return -1;
+  }
+  return 0;
+}
+
+// Write d in inline form.
+static void dump_value(dumper_t *dp, toml_datum_t d) {
+  char buf[32];
+  if (dump_load(dp, &d)) {
+    return;
+  }
+  switch (d.type) {
+  case TOML_STRING:
+    dump_string(dp, d.u.str.ptr, d.u.str.len);
+    break;
+  case TOML_INT64:
+    dump_put(dp, buf, format_int(d.u.int64, buf));
+    break;
+  case TOML_FP64:
+    dump_put(dp, buf, format_float(d.u.fp64, buf));
+    break;
+  case TOML_BOOLEAN:
+    dump_put(dp, d.u.boolean ? "true" : "false", d.u.boolean ? 4 : 5);
+    break;
+  case TOML_DATE:
+  case TOML_TIME:
+  case TOML_DATETIME:
+  case TOML_DATETIMETZ: {
+    char tsbuf[64];
+    dump_put(dp, tsbuf, format_ts(&d, tsbuf));
+    break;
+  }
+  case TOML_ARRAY:
+    dump_char(dp, '[');
+    for (int i = 0; i < d.u.arr.size; i++) {
+      if (i) {
+        dump_put(dp, ", ", 2);
+      }
+      dump_value(dp, d.u.arr.elem[i]);
+    }
+    dump_char(dp, ']');
+    break;
+  case TOML_TABLE:
+    dump_char(dp, '{');
+    for (int i = 0; i < d.u.tab.size; i++) {
+      dump_put(dp, i ? ", " : " ", i ? 2 : 1);
+      dump_key(dp, d.u.tab.key[i], d.u.tab.len[i]);
+      dump_put(dp, " = ", 3);
+      dump_value(dp, d.u.tab.value[i]);
+    }
+    dump_put(dp, d.u.tab.size ? " }" : "}", d.u.tab.size ? 2 : 1);
+    break;
+  default:
+    dp->failed = true;
+    break;
+  }
+}
+
+// Return true if d goes in a section of its own: a table that is not
+// inline, or an array of such tables.
+static bool dump_is_section(toml_datum_t d) {
+  if (d.type == TOML_TABLE) {
+    return !(d.flag & FLAG_INLINED);
+  }
+  if (d.type != TOML_ARRAY || d.u.arr.size == 0) {
+    return false;
+  }
+  for (int i = 0; i < d.u.arr.size; i++) {
+    toml_datum_t e = d.u.arr.elem[i];
+    if (e.type != TOML_TABLE || (e.flag & FLAG_INLINED)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Write the key/values of table tab, which is at path, as dotted keys
+// relative to the section at stop.
+static void dump_dotted(dumper_t *dp, const dumppath_t *path,
+                        const dumppath_t *stop, toml_datum_t tab) {
+  for (int i = 0; i < tab.u.tab.size && !dp->failed; i++) {
+    dumppath_t sub = {path, tab.u.tab.key[i], tab.u.tab.len[i]};
+    toml_datum_t v = tab.u.tab.value[i];
+    if (dump_load(dp, &v)) {
+      return;
+    }
+    if (v.type == TOML_TABLE && !(v.flag & FLAG_INLINED) && v.u.tab.size) {
+      dump_dotted(dp, &sub, stop, v);
+    } else {
+      dump_path(dp, &sub, stop);
+      dump_put(dp, " = ", 3);
+      dump_value(dp, v);
+      dump_char(dp, '\n');
+    }
+  }
+}
+
+// Write the body of table tab, which is at path, or NULL for the root.
+static void dump_table(dumper_t *dp, const dumppath_t *path,
+                       toml_datum_t tab) {
+  int n = tab.u.tab.size;
+  // Find the last key/value. Sections come after it.
+  int last = -1;
+  for (int i = 0; i < n; i++) {
+    toml_datum_t v = tab.u.tab.value[i];
+    if (dump_load(dp, &v)) {
+      return;
+    }
+    if (!dump_is_section(v)) {
+      last = i;
+    }
+  }
+
+  for (int i = 0; i < n && !dp->failed; i++) {
+    dumppath_t sub = {path, tab.u.tab.key[i], tab.u.tab.len[i]};
+    toml_datum_t v = tab.u.tab.value[i];
+    dump_load(dp, &v);
+    if (i <= last) {
+      if (v.type == TOML_TABLE && dump_is_section(v) && v.u.tab.size) {
+        dump_dotted(dp, &sub, path, v);
+      } else {
+        dump_key(dp, sub.key, sub.len);
+        dump_put(dp, " = ", 3);
+        dump_value(dp, v);
+        dump_char(dp, '\n');
+      }
+    } else if (v.type == TOML_TABLE) {
+      // A table of sections only needs no header of its own.
+      bool header = (v.u.tab.size == 0);
+      for (int j = 0; j < v.u.tab.size && !header; j++) {
+        toml_datum_t w = v.u.tab.value[j];
+        if (dump_load(dp, &w)) {
+          return;
+        }
+        header = !dump_is_section(w);
+      }
+      if (header) {
+        dump_put(dp, dp->blank ? "[" : "\n[", dp->blank ? 1 : 2);
+        dump_path(dp, &sub, NULL);
+        dump_put(dp, "]\n", 2);
+      }
+      dump_table(dp, &sub, v);
+    } else {
+      for (int j = 0; j < v.u.arr.size && !dp->failed; j++) {
+        dump_put(dp, dp->blank ? "[[" : "\n[[", dp->blank ? 2 : 3);
+        dump_path(dp, &sub, NULL);
+        dump_put(dp, "]]\n", 3);
+        dump_table(dp, &sub, v.u.arr.elem[j]);
+      }
+    }
+  }
+}
+
+static void dump_init(dumper_t *dp, toml_writer_t writer, void *ctx) {
+  dp->writer = writer;
+  dp->ctx = ctx;
+  dp->failed = false;
+  dp->blank = true;
+  dp->len = 0;
+}
+
+int toml_dump(toml_datum_t table, toml_writer_t writer, void *ctx) {
+  const char *reason;
+  if (lazy_load(&table, &reason) || table.type != TOML_TABLE) {
+    return -1;
+  }
+  dumper_t dumper;
+  dumper_t *dp = &dumper;
+  dump_init(dp, writer, ctx);
+  dump_table(dp, NULL, table);
+  dump_flush(dp);
+  return dp->failed ? -1 : 0;
+}
+
+// The output of toml_dump_to_buffer().
+typedef struct dumpbuf_t dumpbuf_t;
+struct dumpbuf_t {
+  char *buf;
+  int bufsz;
+  int len; // of the whole output, which may not fit
+};
+
+static int dumpbuf_write(void *ctx, const char *s, int n) {
+  dumpbuf_t *db = (dumpbuf_t *)ctx;
+  if (n > INT_MAX - db->len) {
+    return -1;
+  }
+  int room = db->bufsz - 1 - db->len;
+  if (room > 0) {
+    memcpy(db->buf + db->len, s, n < room ? n : room);
+  }
+  db->len += n;
+  return 0;
+}
+
+int toml_dump_to_buffer(toml_datum_t table, char *buf, int bufsz) {
+  dumpbuf_t db = {buf, bufsz, 0};
+  if (toml_dump(table, dumpbuf_write, &db)) {
+    return -1;
+  }
+  if (bufsz > 0) {
+    buf[db.len < bufsz ? db.len : bufsz - 1] = 0;
+  }
+  return db.len;
+}
+
+/*
+ *  JSON export. It shares the output buffer and the value formats of the
+ *  emitter. In TOML_JSON_TYPED mode, tables are indented two spaces per
+ *  level, one key per line, and arrays are kept on one line.
+ */
+static void json_indent(dumper_t *dp, int depth) {
+  static const char spaces[] = "                                ";
+  for (int n = depth * 2; n > 0; n -= sizeof(spaces) - 1) {
+    int k = (n < (int)sizeof(spaces) - 1 ? n : (int)sizeof(spaces) - 1);
+    dump_put(dp, spaces, k);
+  }
+}
+
+// Write d as JSON; depth is the nesting level of d.
+static void json_value(dumper_t *dp, toml_datum_t d, toml_json_mode_t mode,
+                       int depth) {
+  bool typed = (mode == TOML_JSON_TYPED);
+  if (dump_load(dp, &d)) {
+    return;
+  }
+  if (d.type == TOML_TABLE) {
+    if (d.u.tab.size == 0) {
+      dump_put(dp, "{}", 2);
+      return;
+    }
+    dump_char(dp, '{');
+    for (int i = 0; i < d.u.tab.size && !dp->failed; i++) {
+      if (i) {
+        dump_char(dp, ',');
+      }
+      if (typed) {
+        dump_char(dp, '\n');
+        json_indent(dp, depth + 1);
+      }
+      dump_string(dp, d.u.tab.key[i], d.u.tab.len[i]);
+      dump_put(dp, ": ", typed ? 2 : 1);
+      json_value(dp, d.u.tab.value[i], mode, depth + 1);
+    }
+    if (typed) {
+      dump_char(dp, '\n');
+      json_indent(dp, depth);
+    }
+    dump_char(dp, '}');
+    return;
+  }
+  if (d.type == TOML_ARRAY) {
+    dump_char(dp, '[');
+    for (int i = 0; i < d.u.arr.size && !dp->failed; i++) {
+      if (i) {
+        dump_put(dp, ", ", typed ? 2 : 1);
+      }
+      json_value(dp, d.u.arr.elem[i], mode, depth);
+    }
+    dump_char(dp, ']');
+    return;
+  }
+
+  // A scalar. Typed mode wraps it as {"type": ..., "value": "..."}.
+  // Compact mode writes dates, times, inf and nan as strings.
+  const char *name;
+  char buf[64];
+  int n = 0;
+  bool quote = typed;
+  switch (d.type) {
+  case TOML_STRING:
+    name = "string";
+    break;
+  case TOML_INT64:
+    name = "integer";
+    n = format_int(d.u.int64, buf);
+    break;
+  case TOML_FP64:
+    name = "float";
+    n = format_float(d.u.fp64, buf);
+    quote = quote || !isfinite(d.u.fp64);
+    break;
+  case TOML_BOOLEAN:
+    name = "bool";
+    n = d.u.boolean ? 4 : 5;
+    memcpy(buf, d.u.boolean ? "true" : "false", n);
+    break;
+  case TOML_DATE:
+    name = "date-local";
+    break;
+  case TOML_TIME:
+    name = "time-local";
+    break;
+  case TOML_DATETIME:
+    name = "datetime-local";
+    break;
+  case TOML_DATETIMETZ:
+    name = "datetime";
+    break;
+  default:
+    dp->failed = true;
+    return;
+  }
+  if (d.type >= TOML_DATE && d.type <= TOML_DATETIMETZ) {
+    n = format_ts(&d, buf);
+    quote = true;
+  }
+  if (typed) {
+    static const char s1[] = "{\"type\": \"";
+    static const char s2[] = "\", \"value\": ";
+    dump_put(dp, s1, sizeof(s1) - 1);
+    dump_put(dp, name, strlen(name));
+    dump_put(dp, s2, sizeof(s2) - 1);
+  }
+  if (d.type == TOML_STRING) {
+    dump_string(dp, d.u.str.ptr, d.u.str.len);
+  } else {
+    if (quote) {
+      dump_char(dp, '"');
+    }
+    dump_put(dp, buf, n);
+    if (quote) {
+      dump_char(dp, '"');
+    }
+  }
+  if (typed) {
+    dump_char(dp, '}');
+  }
+}
+
+int toml_to_json(toml_datum_t datum, toml_writer_t writer, void *ctx,
+                 toml_json_mode_t mode) {
+  dumper_t dumper;
+  dumper_t *dp = &dumper;
+  dump_init(dp, writer, ctx);
+  json_value(dp, datum, mode, 0);
+  dump_flush(dp);
+  return dp->failed ? -1 : 0;
+}
+
+/*
+ *  Binary images. An image is a copy of a tree laid out in one block: a
+ *  header, the root table, the table of interned keys (see mem_t), then
+ *  everything they point to, each key string once, with each
+ *  key[] and elem[] preceded by its tabmeta_t or arrmeta_t as in a
+ *  parsed tree. Its pointers are those it has when loaded at hdr.base. A
+ *  load tries to map the image there; if it lands elsewhere, the
+ *  difference is added to each pointer once. The tree is then read in
+ *  place.
+ *
+ *  The layout is that of toml_datum_t on the machine that wrote the
+ *  image, which the header records so that a mismatch is caught.
+ */
+#define IMG_MAGIC "TOMLC17D"
+#define IMG_ORDER 0x01020304u
+#if UINTPTR_MAX > 0xffffffffu
+#define IMG_BASE ((uintptr_t)0x5e0000000000) // where a load is tried first
+#else
+#define IMG_BASE ((uintptr_t)0) // always relocate
+#endif
+
+typedef struct imghdr_t imghdr_t;
+struct imghdr_t {
+  char magic[8];
+  uint32_t order;   // IMG_ORDER, in the byte order of the writer
+  uint16_t ptrsz;   // sizeof(void *)
+  uint16_t datumsz; // sizeof(toml_datum_t)
+  uint64_t size;    // of the whole image
+  uint64_t base;    // the address the pointers are for
+};
+
+// The root table follows the header, and the interned keys the root.
+#define IMG_ROOT align8(sizeof(imghdr_t))
+#define IMG_KEYS (IMG_ROOT + sizeof(toml_datum_t))
+
+// An image being written.
+typedef struct img_t img_t;
+struct img_t {
+  char *buf;
+  size_t len, cap;
+  const toml_option_t *opt;
+  const char *reason; // why a lazy section failed to load
+  mem_t *mem;         // for keys
+  toml_datum_t keys;  // each key written, with its offset as value
+};
+
+// The address of buf[off] once the image is loaded at IMG_BASE.
+#define IMG_PTR(off) ((void *)(IMG_BASE + (off)))
+
+// Allocate n zeroed bytes, 8-byte aligned, at the end of img. Return
+// their offset, or 0 if out of memory.
+static size_t img_alloc(img_t *img, size_t n) {
+  size_t off = align8(img->len);
+  if (off + n > img->cap) {
+    size_t cap = img->cap * 2;
+    while (cap < off + n) {
+      cap *= 2;
+    }
+    char *tmp = REALLOC(img->opt, img->buf, cap);
+    if (!tmp) {
+      return 0;
+    }
+    img->buf = tmp;
+    img->cap = cap;
+  }
+  memset(img->buf + img->len, 0, off + n - img->len);
+  img->len = off + n;
+  return off;
+}
+
+// Copy s[0..len) and a NUL into img. Return its offset, or 0 if out of
+// memory.
+static size_t img_put_string(img_t *img, const char *s, int len) {
+  size_t off = img_alloc(img, len + 1);
+  if (off) {
+    memcpy(img->buf + off, s, len);
+  }
+  return off;
+}
+
+// Copy key[0..len) into img unless it is there already. Return its
+// offset, or 0 if out of memory.
+static size_t img_put_key(img_t *img, const char *key, int len) {
+  toml_datum_t *pv = tab_emplace(img->mem, &img->keys, (span_t){key, len},
+                                 &img->reason);
+  if (pv && !pv->type) {
+    size_t off = img_put_string(img, key, len);
+    *pv = mkdatum(TOML_INT64);
+    pv->u.int64 = off;
+  }
+  return pv ? pv->u.int64 : 0;
+}
+
+// Copy src, and what it points to, into img at offset at. Return 0 on
+// success, -1 otherwise.
+static int img_put(img_t *img, size_t at, toml_datum_t src) {
+  DO(lazy_load(&src, &img->reason));
+  toml_datum_t d = src;
+  d.flag &= ~FLAG_SHARED; // the image owns all of its tree
+  const size_t sz = sizeof(toml_datum_t);
+  int n;
+  switch (src.type) {
+  case TOML_STRING: {
+    size_t off = img_put_string(img, src.u.str.ptr, src.u.str.len);
+    if (!off) {
+      goto oom;
+    }
+    d.u.str.ptr = IMG_PTR(off);
+    break;
+  }
+  case TOML_ARRAY:
+    n = src.u.arr.size;
+    d.u.arr.elem = NULL;
+    if (n) {
+      size_t off = img_alloc(img, sizeof(arrmeta_t) + n * sz);
+      if (!off) {
+        goto oom;
+      }
+      ((arrmeta_t *)(img->buf + off))->cap = n;
+      off += sizeof(arrmeta_t);
+      d.u.arr.elem = IMG_PTR(off);
+      for (int i = 0; i < n; i++) {
+        DO(img_put(img, off + i * sz, src.u.arr.elem[i]));
+      }
+    }
+    break;
+  case TOML_TABLE:
+    n = src.u.tab.size;
+    d.u.tab.key = NULL;
+    d.u.tab.len = NULL;
+    d.u.tab.value = NULL;
+    if (n) {
+      tabmeta_t *smeta = tab_meta(&src);
+      int nslot = smeta->nslot;
+      int ndisp = smeta->disp ? FROZEN_NBUCKET(nslot) : 0;
+      size_t keyoff = img_alloc(img, sizeof(tabmeta_t) + n * sizeof(char *));
+      size_t lenoff = img_alloc(img, n * sizeof(int));
+      size_t valoff = img_alloc(img, n * sz);
+      size_t slotoff = img_alloc(img, nslot * sizeof(tabslot_t));
+      size_t dispoff = img_alloc(img, ndisp * sizeof(uint32_t));
+      if (!keyoff || !lenoff || !valoff || !slotoff || !dispoff) {
+        goto oom;
+      }
+      keyoff += sizeof(tabmeta_t);
+      tabmeta_t *meta = (tabmeta_t *)(img->buf + keyoff) - 1;
+      meta->cap = n;
+      meta->nslot = nslot;
+      if (nslot) {
+        meta->slot = IMG_PTR(slotoff);
+        memcpy(img->buf + slotoff, smeta->slot, nslot * sizeof(tabslot_t));
+      }
+      if (ndisp) {
+        meta->disp = IMG_PTR(dispoff);
+        memcpy(img->buf + dispoff, smeta->disp, ndisp * sizeof(uint32_t));
+      }
+      memcpy(img->buf + lenoff, src.u.tab.len, n * sizeof(int));
+      for (int i = 0; i < n; i++) {
+        size_t off = img_put_key(img, src.u.tab.key[i], src.u.tab.len[i]);
+        if (!off) {
+          goto oom;
+        }
+        ((void **)(img->buf + keyoff))[i] = IMG_PTR(off);
+      }
+      d.u.tab.key = IMG_PTR(keyoff);
+      d.u.tab.len = IMG_PTR(lenoff);
+      d.u.tab.value = IMG_PTR(valoff);
+      for (int i = 0; i < n; i++) {
+        DO(img_put(img, valoff + i * sz, src.u.tab.value[i]));
+      }
+    }
+    break;
+  default:
+    break;
+  }
+  memcpy(img->buf + at, &d, sz);
+  return 0;
 
-  result = toml_parse(buf, top);
-  FREE(buf);
-  return result;
+oom:
+  img->reason = "out of memory";
+  return -1;
 }
 
-/**
- *  Parse a toml document.
- */
-toml_result_t toml_parse(const char *src, int len) {
-  toml_result_t result = {0};
-  parser_t parser = {0};
-  parser_t *pp = &parser;
+int toml_save_binary(const toml_result_t *result, const char *path) {
+  mem_t *mem = (mem_t *)result->__internal;
+  return toml_save_binary_ex(result, path, mem ? &mem->opt : &toml_option);
+}
 
-  // Check that src is NUL terminated.
-  if (src[len]) {
-    snprintf(result.errmsg, sizeof(result.errmsg),
-             "src[] must be NUL terminated");
+int toml_save_binary_ex(const toml_result_t *result, const char *path,
+                        const toml_option_t *opt) {
+  if (!result->ok) {
+    return -1;
+  }
+  img_t img = {0};
+  img.opt = opt;
+  img.cap = 4096;
+  img.buf = MALLOC(img.opt, img.cap);
+  if (!img.buf) {
+    return -1;
+  }
+  img.len = IMG_ROOT;
+  int ret = -1;
+  char *tmppath = NULL;
+  img.mem = mem_create(img.opt, 0, 0);
+  img.keys = mkdatum(TOML_TABLE);
+  if (!img.mem || !img_alloc(&img, 2 * sizeof(toml_datum_t)) ||
+      img_put(&img, IMG_ROOT, result->toptab)) {
     goto bail;
   }
-
-  // If user insists, check that src[] is a valid utf8 string.
-  if (toml_option.check_utf8) {
-    int line = 1; // keeps track of line number
-    for (int i = 0; i < len;) {
-      uint32_t ch;
-      int n = utf8_to_ucs(src + i, len - i, &ch);
-      if (n < 0) {
-        snprintf(result.errmsg, sizeof(result.errmsg),
-                 "invalid UTF8 char on line %d", line);
-        goto bail;
-      }
-      if (0xD800 <= ch && ch <= 0xDFFF) {
-        // explicitly prohibit surrogates (non-scalar unicode code point)
-        snprintf(result.errmsg, sizeof(result.errmsg),
-                 "invalid UTF8 char \\u%04x on line %d", ch, line);
-        goto bail;
-      }
-      line += (ch == '\n' ? 1 : 0);
-      i += n;
-    }
+  // The keys written are those interned in the image. Their values are
+  // offsets, but unused once loaded.
+  if (img_put(&img, IMG_KEYS, img.keys)) {
+    goto bail;
   }
 
-  // Initialize parser
-  pp->toptab = mkdatum(TOML_TABLE);
-  pp->curtab = &pp->toptab;
-  pp->ebuf.ptr = result.errmsg;
-  pp->ebuf.len = sizeof(result.errmsg);
-
-  // Alloc memory pool
-  pp->pool =
-      pool_create(len + 10); // add some extra bytes for NUL term and safety
-  if (!pp->pool) {
-    snprintf(result.errmsg, sizeof(result.errmsg), "out of memory");
+  imghdr_t hdr = {0};
+  memcpy(hdr.magic, IMG_MAGIC, sizeof(hdr.magic));
+  hdr.order = IMG_ORDER;
+  hdr.ptrsz = sizeof(void *);
+  hdr.datumsz = sizeof(toml_datum_t);
+  hdr.size = img.len;
+  hdr.base = IMG_BASE;
+  memcpy(img.buf, &hdr, sizeof(hdr));
+
+  // Write a new file and rename it over path, so that an image of path
+  // that is loaded (and mapped) keeps its old contents.
+  size_t n = strlen(path);
+  tmppath = MALLOC(img.opt, n + 5);
+  if (!tmppath) {
     goto bail;
   }
+  memcpy(tmppath, path, n);
+  memcpy(tmppath + n, ".tmp", 5);
+  FILE *fp = fopen(tmppath, "wb");
+  if (fp) {
+    bool ok = (img.len == fwrite(img.buf, 1, img.len, fp));
+    ok = (0 == fclose(fp) && ok);
+    if (ok && rename(tmppath, path)) {
+      // Some systems do not rename over an existing file.
+      remove(path);
+      ok = (0 == rename(tmppath, path));
+    }
+    if (!ok) {
+      remove(tmppath);
+    }
+    ret = (ok ? 0 : -1);
+  }
 
-  // Initialize scanner.
-  scan_init(&pp->scanner, src, len, pp->ebuf.ptr, pp->ebuf.len);
+bail:
+  mem_destroy(img.mem, &img.keys);
+  FREE(img.opt, tmppath);
+  FREE(img.opt, img.buf);
+  return ret;
+}
 
-  // Keep parsing until FIN
-  for (;;) {
-    token_t tok;
-    if (scan_key(&pp->scanner, &tok)) {
-      goto bail;
+// Add delta to each pointer of the tree at d, of an image that was not
+// loaded where it was meant to be.
+static void img_relocate(toml_datum_t *d, uintptr_t delta) {
+#define IMG_FIX(p) ((p) = (void *)((p) ? (uintptr_t)(p) + delta : 0))
+  switch (d->type) {
+  case TOML_STRING:
+    IMG_FIX(d->u.str.ptr);
+    break;
+  case TOML_ARRAY:
+    IMG_FIX(d->u.arr.elem);
+    for (int i = 0; i < d->u.arr.size; i++) {
+      img_relocate(&d->u.arr.elem[i], delta);
     }
-    // break on FIN
-    if (tok.toktyp == TOK_FIN) {
-      break;
+    break;
+  case TOML_TABLE:
+    IMG_FIX(d->u.tab.key);
+    IMG_FIX(d->u.tab.len);
+    IMG_FIX(d->u.tab.value);
+    if (d->u.tab.key) {
+      IMG_FIX(tab_meta(d)->slot);
+      IMG_FIX(tab_meta(d)->disp);
     }
-    switch (tok.toktyp) {
-    case TOK_ENDL: // skip blank lines
-      continue;
-    case TOK_LBRACK:
-      if (parse_std_table_expr(pp, tok)) {
-        goto bail;
-      }
-      break;
-    case TOK_LLBRACK:
-      if (parse_array_table_expr(pp, tok)) {
-        goto bail;
-      }
-      break;
-    default:
-      // non-blank line: parse an expression
-      if (parse_keyvalue_expr(pp, tok)) {
-        goto bail;
-      }
-      break;
+    for (int i = 0; i < d->u.tab.size; i++) {
+      IMG_FIX(d->u.tab.key[i]);
+      img_relocate(&d->u.tab.value[i], delta);
     }
-    // each expression must be followed by newline
-    if (scan_key(&pp->scanner, &tok)) {
-      goto bail;
+    break;
+  default:
+    break;
+  }
+#undef IMG_FIX
+}
+
+#ifdef HAVE_MMAP
+// Map the file at path, preferably at IMG_BASE, into mem. Return it and
+// set *ret_len to its size, or return NULL if the caller should fall
+// back to reading the file with stdio.
+static char *img_map(const char *path, mem_t *mem, size_t *ret_len) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+      st.st_size < (off_t)IMG_ROOT) {
+    close(fd);
+    return NULL;
+  }
+  size_t len = st.st_size;
+  // Private and writable, so that a relocation only copies the pages it
+  // touches.
+  void *addr = mmap((void *)IMG_BASE, len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return NULL;
+  }
+  mem->srcmap = addr;
+  mem->srcmaplen = len;
+  *ret_len = len;
+  return (char *)addr;
+}
+#endif
+
+// Read the file at path into mem. Return it and set *ret_len to its
+// size, or return NULL and set errmsg[] on error.
+static char *img_read(const char *path, mem_t *mem, size_t *ret_len,
+                      char *errmsg, int errmsgsz) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    snprintf(errmsg, errmsgsz, "fopen: %s", path);
+    return NULL;
+  }
+  char *buf = NULL;
+  long len = -1;
+  errno = 0;
+  if (0 == fseek(fp, 0, SEEK_END) && (len = ftell(fp)) >= 0 &&
+      0 == fseek(fp, 0, SEEK_SET)) {
+    // Allocate at least a header, which is checked next.
+    buf = MALLOC(&mem->opt, len > (long)IMG_ROOT ? (size_t)len : IMG_ROOT);
+    if (!buf) {
+      snprintf(errmsg, errmsgsz, "out of memory");
+    } else if ((size_t)len != fread(buf, 1, len, fp)) {
+      FREE(&mem->opt, buf);
+      buf = NULL;
     }
-    if (tok.toktyp == TOK_FIN || tok.toktyp == TOK_ENDL) {
-      continue;
+  }
+  if (!buf && !errmsg[0]) {
+    snprintf(errmsg, errmsgsz, "%s",
+             errno ? strerror(errno) : "Error reading file");
+  }
+  fclose(fp);
+  mem->srcbuf = buf;
+  *ret_len = len;
+  return buf;
+}
+
+toml_result_t toml_load_binary(const char *path) {
+  return toml_load_binary_ex(path, &toml_option);
+}
+
+toml_result_t toml_load_binary_ex(const char *path, const toml_option_t *opt) {
+  toml_result_t result = {0};
+  mem_t *mem = mem_create(opt, 0, 0);
+  if (!mem) {
+    snprintf(result.errmsg, sizeof(result.errmsg), "out of memory");
+    return result;
+  }
+  // The tree is in the image; there is nothing to free but the image.
+  mem->image = true;
+
+  char *img = NULL;
+  size_t len = 0;
+#ifdef HAVE_MMAP
+  img = img_map(path, mem, &len);
+#endif
+  if (!img) {
+    img = img_read(path, mem, &len, result.errmsg, sizeof(result.errmsg));
+    if (!img) {
+      goto bail;
     }
-    RETERROR(pp->ebuf, tok.lineno, "ENDL expected");
+  }
+
+  imghdr_t hdr = {0};
+  memcpy(&hdr, img, len < sizeof(hdr) ? len : sizeof(hdr));
+  if (len < IMG_KEYS + sizeof(toml_datum_t) ||
+      memcmp(hdr.magic, IMG_MAGIC, sizeof(hdr.magic))) {
+    snprintf(result.errmsg, sizeof(result.errmsg), "not a tomlc17 image: %s",
+             path);
+    goto bail;
+  }
+  if (hdr.order != IMG_ORDER || hdr.ptrsz != sizeof(void *) ||
+      hdr.datumsz != sizeof(toml_datum_t)) {
+    snprintf(result.errmsg, sizeof(result.errmsg),
+             "image was written on another platform: %s", path);
+    goto bail;
+  }
+  if (hdr.size != len) {
+    snprintf(result.errmsg, sizeof(result.errmsg), "truncated image: %s",
+             path);
     goto bail;
   }
 
-  // return result
+  toml_datum_t *root = (toml_datum_t *)(img + IMG_ROOT);
+  toml_datum_t *keys = (toml_datum_t *)(img + IMG_KEYS);
+  uintptr_t delta = (uintptr_t)img - (uintptr_t)hdr.base;
+  if (delta) {
+    img_relocate(root, delta);
+    img_relocate(keys, delta);
+  }
+  mem->keys = *keys;
   result.ok = true;
-  result.toptab = pp->toptab;
-  result.__internal = (void *)pp->pool;
+  result.toptab = *root;
+  result.__internal = (void *)mem;
   return result;
 
 bail:
-  // return error
-  datum_free(&pp->toptab);
-  pool_destroy(pp->pool);
-  result.ok = false;
+  mem_destroy(mem, &result.toptab);
   assert(result.errmsg[0]); // make sure there is an errmsg
   return result;
 }
@@ -929,6 +4653,67 @@ static int token_to_boolean(parser_t *pp, token_t tok, toml_datum_t *ret) {
   return 0;
 }
 
+// Report the first nkey parts of kp to the SAX callback fn, if set.
+static int sax_keys(parser_t *pp, int lineno,
+                    int (*fn)(void *, int, const char *const *, const int *),
+                    const keypart_t *kp, int nkey) {
+  if (!fn) {
+    return 0;
+  }
+  const char *key[KEYPARTMAX];
+  int len[KEYPARTMAX];
+  for (int i = 0; i < nkey; i++) {
+    key[i] = kp->span[i].ptr;
+    len[i] = kp->span[i].len;
+  }
+  if (fn(pp->saxctx, nkey, key, len)) {
+    return RETERROR(pp->ebuf, lineno, "stopped by handler");
+  }
+  return 0;
+}
+
+// Report a begin or end event to the SAX callback fn, if set.
+static int sax_mark(parser_t *pp, int lineno, int (*fn)(void *)) {
+  if (fn && fn(pp->saxctx)) {
+    return RETERROR(pp->ebuf, lineno, "stopped by handler");
+  }
+  return 0;
+}
+
+// Normalize a key token as parse_norm() does, into its interned copy.
+// Return 0 on success, -1 otherwise.
+static int parse_key_norm(parser_t *pp, token_t tok, span_t *ret_span) {
+  mem_t *mem = pp->mem;
+  if (pp->sax) {
+    // No tree, so nothing to share the key with.
+    return parse_norm(pp, tok, ret_span);
+  }
+  // Most keys have no escape chars, and are interned as spelled.
+  bool escaped =
+      tok.toktyp == TOK_STRING && memchr(tok.str.ptr, '\\', tok.str.len);
+  int i = -1;
+  if (!escaped) {
+    i = tab_find(&mem->keys, (span_t){tok.str.ptr, tok.str.len});
+  }
+  if (i < 0) {
+    pool_mark_t mark = pool_mark(mem->pool);
+    DO(parse_norm(pp, tok, ret_span));
+    i = escaped ? tab_find(&mem->keys, *ret_span) : -1;
+    if (i < 0) {
+      const char *reason;
+      if (!tab_emplace(mem, &mem->keys, *ret_span, &reason)) {
+        return RETERROR(pp->ebuf, tok.lineno, "%s", reason);
+      }
+      return 0;
+    }
+    // An escaped spelling of a known key.
+    pool_rewind(mem->pool, mark);
+  }
+  ret_span->ptr = mem->keys.u.tab.key[i];
+  ret_span->len = mem->keys.u.tab.len[i];
+  return 0;
+}
+
 // Parse a multipart key. Return 0 on success, -1 otherwise.
 static int parse_key(parser_t *pp, token_t tok, keypart_t *ret_keypart) {
   ret_keypart->nspan = 0;
@@ -944,7 +4729,7 @@ static int parse_key(parser_t *pp, token_t tok, keypart_t *ret_keypart) {
   span_t *kpspan = ret_keypart->span;
 
   // Normalize the first keypart
-  if (parse_norm(pp, tok, &kpspan[n])) {
+  if (parse_key_norm(pp, tok, &kpspan[n])) {
     return RETERROR(pp->ebuf, tok.lineno,
                     "unable to normalize string; probably a unicode issue");
   }
@@ -976,7 +4761,7 @@ static int parse_key(parser_t *pp, token_t tok, keypart_t *ret_keypart) {
     }
 
     // Normalize the n-th key.
-    DO(parse_norm(pp, tok, &kpspan[n]));
+    DO(parse_key_norm(pp, tok, &kpspan[n]));
     n++;
   }
 
@@ -1001,7 +4786,7 @@ static toml_datum_t *descend_keypart(parser_t *pp, int lineno,
     if (j < 0) {
       toml_datum_t newtab = mkdatum(TOML_TABLE);
       newtab.flag |= stdtabexpr ? FLAG_STDEXPR : 0;
-      if (tab_add(tab, keypart->span[i], newtab, &reason)) {
+      if (tab_add(pp->mem, tab, keypart->span[i], newtab, &reason)) {
         RETERROR(pp->ebuf, lineno, "%s", reason);
         return NULL;
       }
@@ -1022,8 +4807,8 @@ static toml_datum_t *descend_keypart(parser_t *pp, int lineno,
     if (value->type == TOML_ARRAY) {
       // If empty: error.
       if (value->u.arr.size <= 0) {
-        RETERROR(pp->ebuf, lineno, "array %s has no elements",
-                 keypart->span[i].ptr);
+        RETERROR(pp->ebuf, lineno, "array %.*s has no elements",
+                 keypart->span[i].len, keypart->span[i].ptr);
         return NULL;
       }
 
@@ -1032,8 +4817,8 @@ static toml_datum_t *descend_keypart(parser_t *pp, int lineno,
 
       // It must be a table!
       if (value->type != TOML_TABLE) {
-        RETERROR(pp->ebuf, lineno, "array %s must be array of tables",
-                 keypart->span[i].ptr);
+        RETERROR(pp->ebuf, lineno, "array %.*s must be array of tables",
+                 keypart->span[i].len, keypart->span[i].ptr);
         return NULL;
       }
       tab = value; // descend
@@ -1041,8 +4826,8 @@ static toml_datum_t *descend_keypart(parser_t *pp, int lineno,
     }
 
     // key not found
-    RETERROR(pp->ebuf, lineno, "cannot locate table at key %s",
-             keypart->span[i].ptr);
+    RETERROR(pp->ebuf, lineno, "cannot locate table at key %.*s",
+             keypart->span[i].len, keypart->span[i].ptr);
     return NULL;
   }
 
@@ -1075,6 +4860,9 @@ static int parse_inline_array(parser_t *pp, token_t tok,
   assert(tok.toktyp == TOK_LBRACK);
   *ret_datum = mkdatum(TOML_ARRAY);
   int need_comma = 0;
+  if (pp->sax) {
+    DO(sax_mark(pp, tok.lineno, pp->sax->array_begin));
+  }
 
   // loop until RBRACK
   for (;;) {
@@ -1106,11 +4894,19 @@ static int parse_inline_array(parser_t *pp, token_t tok,
 
     // This is a valid value!
 
-    // Add the value to the array.
+    // Add the value to the array. In SAX mode, the checks only ever look
+    // at the last element, so keep just that one.
     const char *reason;
-    toml_datum_t *pelem = arr_emplace(ret_datum, &reason);
-    if (!pelem) {
-      return RETERROR(pp->ebuf, tok.lineno, "while parsing array: %s", reason);
+    toml_datum_t *pelem;
+    if (pp->sax && ret_datum->u.arr.size > 0) {
+      pelem = &ret_datum->u.arr.elem[0];
+      datum_free(pp->mem, pelem);
+    } else {
+      pelem = arr_emplace(pp->mem, ret_datum, &reason);
+      if (!pelem) {
+        return RETERROR(pp->ebuf, tok.lineno, "while parsing array: %s",
+                        reason);
+      }
     }
 
     // Parse the value and save into array.
@@ -1119,6 +4915,9 @@ static int parse_inline_array(parser_t *pp, token_t tok,
     // Need comma before the next value.
     need_comma = 1;
   }
+  if (pp->sax) {
+    DO(sax_mark(pp, tok.lineno, pp->sax->array_end));
+  }
 
   // Set the INLINE flag for all things in this array.
   set_flag_recursive(ret_datum, FLAG_INLINED);
@@ -1132,6 +4931,9 @@ static int parse_inline_table(parser_t *pp, token_t tok,
   *ret_datum = mkdatum(TOML_TABLE);
   bool need_comma = 0;
   bool was_comma = 0;
+  if (pp->sax) {
+    DO(sax_mark(pp, tok.lineno, pp->sax->table_begin));
+  }
 
   // loop until RBRACE
   for (;;) {
@@ -1196,6 +4998,9 @@ static int parse_inline_table(parser_t *pp, token_t tok,
         return RETERROR(pp->ebuf, tok.lineno, "missing '='");
       }
     }
+    if (pp->sax) {
+      DO(sax_keys(pp, keylineno, pp->sax->key, &keypart, keypart.nspan + 1));
+    }
 
     // obtain the value
     toml_datum_t value;
@@ -1204,11 +5009,15 @@ static int parse_inline_table(parser_t *pp, token_t tok,
 
     // Add the value to tab.
     const char *reason;
-    if (tab_add(tab, lastkeypart, value, &reason)) {
+    if (tab_add(pp->mem, tab, lastkeypart, value, &reason)) {
+      datum_free(pp->mem, &value);
       return RETERROR(pp->ebuf, tok.lineno, "%s", reason);
     }
     need_comma = 1, was_comma = 0;
   }
+  if (pp->sax) {
+    DO(sax_mark(pp, tok.lineno, pp->sax->table_end));
+  }
 
   set_flag_recursive(ret_datum, FLAG_INLINED);
   return 0;
@@ -1222,29 +5031,47 @@ static int parse_val(parser_t *pp, token_t tok, toml_datum_t *ret) {
   case TOK_MLSTRING:
   case TOK_LITSTRING:
   case TOK_MLLITSTRING:
-    return token_to_string(pp, tok, ret);
+    DO(token_to_string(pp, tok, ret));
+    break;
   case TOK_TIME:
-    return token_to_time(pp, tok, ret);
+    DO(token_to_time(pp, tok, ret));
+    break;
   case TOK_DATE:
-    return token_to_date(pp, tok, ret);
+    DO(token_to_date(pp, tok, ret));
+    break;
   case TOK_DATETIME:
-    return token_to_datetime(pp, tok, ret);
+    DO(token_to_datetime(pp, tok, ret));
+    break;
   case TOK_DATETIMETZ:
-    return token_to_datetimetz(pp, tok, ret);
+    DO(token_to_datetimetz(pp, tok, ret));
+    break;
   case TOK_INTEGER:
-    return token_to_int64(pp, tok, ret);
+    DO(token_to_int64(pp, tok, ret));
+    break;
   case TOK_FLOAT:
-    return token_to_fp64(pp, tok, ret);
+    DO(token_to_fp64(pp, tok, ret));
+    break;
   case TOK_BOOL:
-    return token_to_boolean(pp, tok, ret);
+    DO(token_to_boolean(pp, tok, ret));
+    break;
   case TOK_LBRACK: // inline-array
-    return parse_inline_array(pp, tok, ret);
   case TOK_LBRACE: // inline-table
-    return parse_inline_table(pp, tok, ret);
+    // On error, release whatever was built so far.
+    if (tok.toktyp == TOK_LBRACK ? parse_inline_array(pp, tok, ret)
+                                 : parse_inline_table(pp, tok, ret)) {
+      datum_free(pp->mem, ret);
+      return -1;
+    }
+    return 0;
   default:
-    break;
+    return RETERROR(pp->ebuf, tok.lineno, "missing value");
+  }
+
+  // Report a scalar to the SAX handler.
+  if (pp->sax && pp->sax->value && pp->sax->value(pp->saxctx, *ret)) {
+    return RETERROR(pp->ebuf, tok.lineno, "stopped by handler");
   }
-  return RETERROR(pp->ebuf, tok.lineno, "missing value");
+  return 0;
 }
 
 // Parse a standard table expression, and set the curtab of the parser
@@ -1289,7 +5116,7 @@ static int parse_std_table_expr(parser_t *pp, token_t tok) {
     const char *reason;
     toml_datum_t newtab = mkdatum(TOML_TABLE);
     newtab.flag |= FLAG_STDEXPR;
-    if (tab_add(tab, lastkeypart, newtab, &reason)) {
+    if (tab_add(pp->mem, tab, lastkeypart, newtab, &reason)) {
       return RETERROR(pp->ebuf, keylineno, "%s", reason);
     }
     // this is the new tab
@@ -1325,6 +5152,11 @@ static int parse_std_table_expr(parser_t *pp, token_t tok) {
 
   // Set tab as curtab of the parser
   pp->curtab = tab;
+  pp->hdrkey = keypart;
+  pp->hdrkey.nspan++;
+  if (pp->sax) {
+    DO(sax_keys(pp, keylineno, pp->sax->table, &keypart, keypart.nspan + 1));
+  }
   return 0;
 }
 
@@ -1362,7 +5194,7 @@ static int parse_array_table_expr(parser_t *pp, token_t tok) {
       const char *reason;
       toml_datum_t newtab = mkdatum(TOML_TABLE);
       newtab.flag |= FLAG_STDEXPR;
-      if (tab_add(tab, curkey, newtab, &reason)) {
+      if (tab_add(pp->mem, tab, curkey, newtab, &reason)) {
         return RETERROR(pp->ebuf, keylineno, "%s", reason);
       }
       tab = &tab->u.tab.value[tab->u.tab.size - 1];
@@ -1382,16 +5214,17 @@ static int parse_array_table_expr(parser_t *pp, token_t tok) {
     // continue descent.
     if (value->type == TOML_ARRAY) {
       if (value->flag & FLAG_INLINED) {
-        return RETERROR(pp->ebuf, keylineno, "cannot expand array %s",
-                        curkey.ptr);
+        return RETERROR(pp->ebuf, keylineno, "cannot expand array %.*s",
+                        curkey.len, curkey.ptr);
       }
       if (value->u.arr.size <= 0) {
-        return RETERROR(pp->ebuf, keylineno, "array %s has no elements",
-                        curkey.ptr);
+        return RETERROR(pp->ebuf, keylineno, "array %.*s has no elements",
+                        curkey.len, curkey.ptr);
       }
       value = &value->u.arr.elem[value->u.arr.size - 1];
       if (value->type != TOML_TABLE) {
-        return RETERROR(pp->ebuf, keylineno, "array %s must be array of tables",
+        return RETERROR(pp->ebuf, keylineno,
+                        "array %.*s must be array of tables", curkey.len,
                         curkey.ptr);
       }
       tab = value;
@@ -1399,8 +5232,8 @@ static int parse_array_table_expr(parser_t *pp, token_t tok) {
     }
 
     // keypart not found
-    return RETERROR(pp->ebuf, keylineno, "cannot locate table at key %s",
-                    curkey.ptr);
+    return RETERROR(pp->ebuf, keylineno, "cannot locate table at key %.*s",
+                    curkey.len, curkey.ptr);
   }
 
   // For the final keypart, make sure entry at key is an array of tables
@@ -1408,11 +5241,10 @@ static int parse_array_table_expr(parser_t *pp, token_t tok) {
   int idx = tab_find(tab, lastkeypart);
   if (idx == -1) {
     // If not found, add an array of table.
-    if (tab_add(tab, lastkeypart, mkdatum(TOML_ARRAY), &reason)) {
+    if (tab_add(pp->mem, tab, lastkeypart, mkdatum(TOML_ARRAY), &reason)) {
       return RETERROR(pp->ebuf, keylineno, "%s", reason);
     }
-    idx = tab_find(tab, lastkeypart);
-    assert(idx >= 0);
+    idx = tab->u.tab.size - 1;
   }
   // Check that this is an array.
   if (tab->u.tab.value[idx].type != TOML_ARRAY) {
@@ -1423,15 +5255,28 @@ static int parse_array_table_expr(parser_t *pp, token_t tok) {
   if (arr->flag & FLAG_INLINED) {
     return RETERROR(pp->ebuf, keylineno, "cannot extend a static array");
   }
-  toml_datum_t *pelem = arr_emplace(arr, &reason);
-  if (!pelem) {
-    return RETERROR(pp->ebuf, keylineno, "%s", reason);
+  // In SAX mode, earlier elements are never looked at again.
+  toml_datum_t *pelem;
+  if (pp->sax && arr->u.arr.size > 0) {
+    pelem = &arr->u.arr.elem[arr->u.arr.size - 1];
+    datum_free(pp->mem, pelem);
+  } else {
+    pelem = arr_emplace(pp->mem, arr, &reason);
+    if (!pelem) {
+      return RETERROR(pp->ebuf, keylineno, "%s", reason);
+    }
   }
   *pelem = mkdatum(TOML_TABLE);
 
   // Set the last element of this array as curtab of the parser
   pp->curtab = &arr->u.arr.elem[arr->u.arr.size - 1];
+  pp->hdrkey = keypart;
+  pp->hdrkey.nspan++;
   assert(pp->curtab->type == TOML_TABLE);
+  if (pp->sax) {
+    DO(sax_keys(pp, keylineno, pp->sax->array_table, &keypart,
+                keypart.nspan + 1));
+  }
 
   return 0;
 }
@@ -1448,6 +5293,9 @@ static int parse_keyvalue_expr(parser_t *pp, token_t tok) {
   if (tok.toktyp != TOK_EQUAL) {
     return RETERROR(pp->ebuf, tok.lineno, "expect '='");
   }
+  if (pp->sax) {
+    DO(sax_keys(pp, keylineno, pp->sax->key, &keypart, keypart.nspan));
+  }
 
   // Obtain the value
   toml_datum_t val;
@@ -1461,13 +5309,15 @@ static int parse_keyvalue_expr(parser_t *pp, token_t tok) {
     int j = tab_find(tab, keypart.span[i]);
     if (j < 0) {
       if (i > 0 && (tab->flag & FLAG_EXPLICIT)) {
-        return RETERROR(
+        RETERROR(
             pp->ebuf, keylineno,
             "cannot extend a previously defined table using dotted expression");
+        goto bail;
       }
       toml_datum_t newtab = mkdatum(TOML_TABLE);
-      if (tab_add(tab, keypart.span[i], newtab, &reason)) {
-        return RETERROR(pp->ebuf, keylineno, "%s", reason);
+      if (tab_add(pp->mem, tab, keypart.span[i], newtab, &reason)) {
+        RETERROR(pp->ebuf, keylineno, "%s", reason);
+        goto bail;
       }
       tab = &tab->u.tab.value[tab->u.tab.size - 1];
       continue;
@@ -1478,39 +5328,58 @@ static int parse_keyvalue_expr(parser_t *pp, token_t tok) {
       continue;
     }
     if (value->type == TOML_ARRAY) {
-      return RETERROR(pp->ebuf, keylineno,
-                      "encountered previously declared array '%s'",
-                      keypart.span[i].ptr);
+      RETERROR(pp->ebuf, keylineno,
+               "encountered previously declared array '%.*s'",
+               keypart.span[i].len, keypart.span[i].ptr);
+      goto bail;
     }
-    return RETERROR(pp->ebuf, keylineno, "cannot locate table at '%s'",
-                    keypart.span[i].ptr);
+    RETERROR(pp->ebuf, keylineno, "cannot locate table at '%.*s'",
+             keypart.span[i].len, keypart.span[i].ptr);
+    goto bail;
   }
 
   // Check for disallowed situations.
   if (tab->flag & FLAG_INLINED) {
-    return RETERROR(pp->ebuf, keylineno, "inline table cannot be extended");
+    RETERROR(pp->ebuf, keylineno, "inline table cannot be extended");
+    goto bail;
   }
   if (keypart.nspan > 1 && (tab->flag & FLAG_EXPLICIT)) {
-    return RETERROR(
+    RETERROR(
         pp->ebuf, keylineno,
         "cannot extend a previously defined table using dotted expression");
+    goto bail;
   }
 
   // Add a new key/value for tab.
-  if (tab_add(tab, keypart.span[keypart.nspan - 1], val, &reason)) {
-    return RETERROR(pp->ebuf, keylineno, "%s", reason);
+  if (tab_add(pp->mem, tab, keypart.span[keypart.nspan - 1], val, &reason)) {
+    RETERROR(pp->ebuf, keylineno, "%s", reason);
+    goto bail;
   }
-
   return 0;
+
+bail:
+  datum_free(pp->mem, &val);
+  return -1;
 }
 
 // Normalize a LIT/STRING/MLSTRING/LITSTRING/MLLITSTRING
 // -> unescape all escaped chars
 // The returned string is allocated out of pp->sbuf[]
 static int parse_norm(parser_t *pp, token_t tok, span_t *ret_span) {
+  // In borrow mode, point escape-free strings into the source text.
+  if (pp->mem->borrow) {
+    bool escaped = (tok.toktyp == TOK_STRING || tok.toktyp == TOK_MLSTRING) &&
+                   memchr(tok.str.ptr, '\\', tok.str.len);
+    if (!escaped) {
+      ret_span->ptr = tok.str.ptr;
+      ret_span->len = tok.str.len;
+      return 0;
+    }
+  }
+
   // Allocate a buffer to store the normalized string. Add one
   // extra-byte for terminating NUL.
-  char *p = pool_alloc(pp->pool, tok.str.len + 1);
+  char *p = pool_alloc(pp->mem->pool, tok.str.len + 1);
   if (!p) {
     return RETERROR(pp->ebuf, tok.lineno, "out of memory");
   }
@@ -1626,6 +5495,317 @@ static int parse_norm(parser_t *pp, token_t tok, span_t *ret_span) {
 
 // -------------- scanner functions
 
+#ifdef HAVE_SSE2
+// Index of the lowest set bit of a non-zero x.
+static inline int lowbit(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(x);
+#else
+  int n = 0;
+  for (; !(x & 1); x >>= 1, n++)
+    ;
+  return n;
+#endif
+}
+#endif
+
+// Return the first char in [p, endp) that is c1, c2, a control char
+// (< 0x20) or DEL, or endp if there is none. Everything skipped over is
+// a plain char in a string or comment body; the caller handles the stop
+// char one at a time, which keeps \r\n and lineno handling in scan_get().
+static const char *scan_plain(const char *p, const char *endp, char c1,
+                              char c2) {
+#ifdef HAVE_AVX2
+  {
+    const __m256i v1 = _mm256_set1_epi8(c1);
+    const __m256i v2 = _mm256_set1_epi8(c2);
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    const __m256i ctl = _mm256_set1_epi8(0x1f);
+    for (; endp - p >= 32; p += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)p);
+      __m256i m = _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, v1), _mm256_cmpeq_epi8(v, v2)),
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, del),
+                          _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v)));
+      uint32_t bits = _mm256_movemask_epi8(m);
+      if (bits) {
+        return p + lowbit(bits);
+      }
+    }
+  }
+#endif
+#ifdef HAVE_SSE2
+  {
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i ctl = _mm_set1_epi8(0x1f);
+    for (; endp - p >= 16; p += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)p);
+      __m128i m = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2)),
+          _mm_or_si128(_mm_cmpeq_epi8(v, del),
+                       _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v)));
+      uint32_t bits = _mm_movemask_epi8(m);
+      if (bits) {
+        return p + lowbit(bits);
+      }
+    }
+  }
+#endif
+  for (; p < endp; p++) {
+    int ch = (unsigned char)*p;
+    if (ch == c1 || ch == c2 || ch < 0x20 || ch == 0x7f) {
+      break;
+    }
+  }
+  return p;
+}
+
+// Return the first char in [p, endp) that is not a space or tab, or
+// endp if there is none.
+static const char *scan_blank(const char *p, const char *endp) {
+  // Most runs are a single space; do not pay for a vector load.
+  if (p < endp && *p != ' ' && *p != '\t') {
+    return p;
+  }
+#ifdef HAVE_SSE2
+  const __m128i sp = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  for (; endp - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tab));
+    uint32_t bits = ~_mm_movemask_epi8(m) & 0xffff;
+    if (bits) {
+      return p + lowbit(bits);
+    }
+  }
+#endif
+  for (; p < endp && (*p == ' ' || *p == '\t'); p++)
+    ;
+  return p;
+}
+
+// Return the length of the valid UTF-8 sequence at p, or 0 if it is not
+// valid. Overlong forms, surrogates and code points above U+10FFFF are
+// not valid.
+static int utf8_seqlen(const unsigned char *p, const unsigned char *endp) {
+  int c = p[0];
+  int n, lo = 0x80, hi = 0xbf; // range of the second byte
+  if (c < 0x80) {
+    return 1;
+  } else if (c < 0xc2) {
+    return 0;
+  } else if (c < 0xe0) {
+    n = 2;
+  } else if (c < 0xf0) {
+    n = 3;
+    lo = (c == 0xe0 ? 0xa0 : lo);
+    hi = (c == 0xed ? 0x9f : hi);
+  } else if (c < 0xf5) {
+    n = 4;
+    lo = (c == 0xf0 ? 0x90 : lo);
+    hi = (c == 0xf4 ? 0x8f : hi);
+  } else {
+    return 0;
+  }
+  if (endp - p < n || p[1] < lo || p[1] > hi) {
+    return 0;
+  }
+  for (int i = 2; i < n; i++) {
+    if ((p[i] & 0xc0) != 0x80) {
+      return 0;
+    }
+  }
+  return n;
+}
+
+#ifdef HAVE_SSSE3
+/*
+ *  Lookup-table UTF-8 validation (Keiser and Lemire, "Validating UTF-8
+ *  In Less Than One Instruction Per Byte"). Each byte is classified by
+ *  the high and low nibbles of the byte before it and its own high
+ *  nibble. The three lookups AND to non-zero exactly where the pair of
+ *  bytes cannot occur in valid UTF-8. The only error a pair cannot see,
+ *  a missing 3rd or 4th byte, is checked against the bytes 2 and 3
+ *  back.
+ */
+#define U8_TOO_SHORT (1 << 0)
+#define U8_TOO_LONG (1 << 1)
+#define U8_OVERLONG_3 (1 << 2)
+#define U8_TOO_LARGE (1 << 3)
+#define U8_SURROGATE (1 << 4)
+#define U8_OVERLONG_2 (1 << 5)
+#define U8_TOO_LARGE_1000 (1 << 6)
+#define U8_OVERLONG_4 (1 << 6)
+#define U8_TWO_CONTS (1 << 7)
+#define U8_CARRY (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+#define U8_LARGE (U8_TOO_LARGE | U8_TOO_LARGE_1000)
+#define U8_CONT (U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS)
+
+// Return the error bits of the 16 bytes in v, given the 16 bytes before.
+static inline __m128i utf8_block_error(__m128i v, __m128i prev) {
+  const __m128i byte_1_high = _mm_setr_epi8(
+      // 0___ ____: ASCII
+      U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+      U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+      // 10__ ____: continuation
+      (char)U8_TWO_CONTS, (char)U8_TWO_CONTS, (char)U8_TWO_CONTS,
+      (char)U8_TWO_CONTS,
+      // 1100 ____, 1101 ____: 2-byte lead
+      U8_TOO_SHORT | U8_OVERLONG_2, U8_TOO_SHORT,
+      // 1110 ____: 3-byte lead
+      U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+      // 1111 ____: 4-byte lead
+      U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4);
+  const __m128i byte_1_low = _mm_setr_epi8(
+      // ____ 0000
+      (char)(U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4),
+      // ____ 0001
+      (char)(U8_CARRY | U8_OVERLONG_2),
+      // ____ 001_
+      (char)U8_CARRY, (char)U8_CARRY,
+      // ____ 0100
+      (char)(U8_CARRY | U8_TOO_LARGE),
+      // ____ 0101 .. ____ 1100
+      (char)(U8_CARRY | U8_LARGE), (char)(U8_CARRY | U8_LARGE),
+      (char)(U8_CARRY | U8_LARGE), (char)(U8_CARRY | U8_LARGE),
+      (char)(U8_CARRY | U8_LARGE), (char)(U8_CARRY | U8_LARGE),
+      (char)(U8_CARRY | U8_LARGE), (char)(U8_CARRY | U8_LARGE),
+      // ____ 1101
+      (char)(U8_CARRY | U8_LARGE | U8_SURROGATE),
+      // ____ 111_
+      (char)(U8_CARRY | U8_LARGE), (char)(U8_CARRY | U8_LARGE));
+  const __m128i byte_2_high = _mm_setr_epi8(
+      // 0___ ____: ASCII
+      U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+      U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+      // 1000 ____
+      (char)(U8_CONT | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4),
+      // 1001 ____
+      (char)(U8_CONT | U8_OVERLONG_3 | U8_TOO_LARGE),
+      // 101_ ____
+      (char)(U8_CONT | U8_SURROGATE | U8_TOO_LARGE),
+      (char)(U8_CONT | U8_SURROGATE | U8_TOO_LARGE),
+      // 11__ ____: lead
+      U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+
+  __m128i prev1 = _mm_alignr_epi8(v, prev, 15);
+  __m128i e = _mm_and_si128(
+      _mm_and_si128(
+          _mm_shuffle_epi8(byte_1_high,
+                           _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+          _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, nibble))),
+      _mm_shuffle_epi8(byte_2_high,
+                       _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+
+  // A byte 2 back of 111_ ____ or 3 back of 1111 ____ needs a
+  // continuation here; the lookups flagged two continuations in a row.
+  __m128i prev2 = _mm_alignr_epi8(v, prev, 14);
+  __m128i prev3 = _mm_alignr_epi8(v, prev, 13);
+  __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0x60)),
+                                _mm_subs_epu8(prev3, _mm_set1_epi8(0x70)));
+  must23 = _mm_and_si128(must23, _mm_set1_epi8((char)0x80));
+  return _mm_xor_si128(must23, e);
+}
+
+// Return non-zero bytes where v ends in the middle of a sequence.
+static inline __m128i utf8_block_incomplete(__m128i v) {
+  const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                    -1, -1, -1, (char)(0xf0 - 1),
+                                    (char)(0xe0 - 1), (char)(0xc0 - 1));
+  return _mm_subs_epu8(v, max);
+}
+
+// Check that [p, endp) is valid UTF-8.
+static bool utf8_valid_ssse3(const char *p, const char *endp) {
+  __m128i prev = _mm_setzero_si128();
+  __m128i incomplete = _mm_setzero_si128();
+  __m128i err = _mm_setzero_si128();
+  for (;; p += 16) {
+    __m128i v;
+    if (endp - p >= 16) {
+      v = _mm_loadu_si128((const __m128i *)p);
+    } else if (p < endp) {
+      char buf[16] = {0}; // pad the tail with ASCII
+      memcpy(buf, p, endp - p);
+      v = _mm_loadu_si128((const __m128i *)buf);
+    } else {
+      break;
+    }
+    if (_mm_movemask_epi8(v) == 0) {
+      err = _mm_or_si128(err, incomplete); // all ASCII
+      incomplete = _mm_setzero_si128();
+    } else {
+      err = _mm_or_si128(err, utf8_block_error(v, prev));
+      incomplete = utf8_block_incomplete(v);
+    }
+    prev = v;
+  }
+  err = _mm_or_si128(err, incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(err, _mm_setzero_si128())) == 0xffff;
+}
+#endif
+
+// Return the start of the first invalid UTF-8 sequence in [p, endp), or
+// endp if there is none.
+static const char *utf8_check(const char *p, const char *endp) {
+#ifdef HAVE_SSSE3
+  if (utf8_valid_ssse3(p, endp)) {
+    return endp;
+  }
+  // Error path: find the offending sequence below.
+#elif defined(HAVE_SSE2)
+  // Skip ASCII 16 bytes at a time; decode the rest one sequence at a time.
+  while (endp - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    if (_mm_movemask_epi8(v) == 0) {
+      p += 16;
+      continue;
+    }
+    for (const char *stop = p + 16; p < stop;) {
+      int n = utf8_seqlen((const unsigned char *)p,
+                          (const unsigned char *)endp);
+      if (n == 0) {
+        return p;
+      }
+      p += n;
+    }
+  }
+#endif
+  while (p < endp) {
+    int n = utf8_seqlen((const unsigned char *)p, (const unsigned char *)endp);
+    if (n == 0) {
+      return p;
+    }
+    p += n;
+  }
+  return p;
+}
+
+// Advance over plain chars up to the next c1, c2, control char or DEL,
+// as scan_plain() does. With check_utf8, validate the chars skipped
+// while they are still in cache. They never include a newline, so the
+// error is on the current line.
+static int scan_skip_plain(scanner_t *sp, char c1, char c2) {
+  const char *p = scan_plain(sp->cur, sp->endp, c1, c2);
+  if (sp->check_utf8) {
+    const char *bad = utf8_check(sp->cur, p);
+    if (bad != p) {
+      uint32_t ch;
+      if (utf8_to_ucs(bad, sp->endp - bad, &ch) > 0 && 0xD800 <= ch &&
+          ch <= 0xDFFF) {
+        return RETERROR(sp->ebuf, sp->lineno, "invalid UTF8 char \\u%04x",
+                        ch);
+      }
+      return RETERROR(sp->ebuf, sp->lineno, "invalid UTF8 char");
+    }
+  }
+  sp->cur = p;
+  return 0;
+}
+
 // Get the next char
 static int scan_get(scanner_t *sp) {
   int ret = TOK_FIN;
@@ -1703,15 +5883,15 @@ static inline bool is_hex_char(int ch) {
 
 // Initialize a scanner
 static void scan_init(scanner_t *sp, const char *src, int len, char *errbuf,
-                      int errbufsz) {
+                      int errbufsz, bool check_utf8) {
   memset(sp, 0, sizeof(*sp));
   sp->src = src;
   sp->endp = src + len;
-  assert(*sp->endp == '\0');
   sp->cur = src;
   sp->lineno = 1;
   sp->ebuf.ptr = errbuf;
   sp->ebuf.len = errbufsz;
+  sp->check_utf8 = check_utf8;
 }
 
 static int scan_multiline_string(scanner_t *sp, token_t *tok) {
@@ -1726,6 +5906,7 @@ static int scan_multiline_string(scanner_t *sp, token_t *tok) {
   *tok = mktoken(sp, TOK_MLSTRING);
   // scan until terminating """
   while (1) {
+    DO(scan_skip_plain(sp, '"', '\\'));
     if (S_MATCH3('"')) {
       if (S_MATCH4('"')) {
         // special case... """abcd """" -> (abcd ")
@@ -1806,7 +5987,11 @@ static int scan_string(scanner_t *sp, token_t *tok) {
 
   // scan until closing "
   *tok = mktoken(sp, TOK_STRING);
-  while (!S_MATCH('"')) {
+  for (;;) {
+    DO(scan_skip_plain(sp, '"', '\\'));
+    if (S_MATCH('"')) {
+      break;
+    }
     int ch = S_GET();
     if (ch == TOK_FIN) {
       return RETERROR(sp->ebuf, sp->lineno, "unterminated string");
@@ -1855,6 +6040,7 @@ static int scan_multiline_litstring(scanner_t *sp, token_t *tok) {
   // scan until terminating '''
   *tok = mktoken(sp, TOK_MLLITSTRING);
   while (1) {
+    DO(scan_skip_plain(sp, '\'', '\''));
     if (S_MATCH3('\'')) {
       if (S_MATCH4('\'')) {
         // special case... '''abcd '''' -> (abcd ')
@@ -1894,7 +6080,11 @@ static int scan_litstring(scanner_t *sp, token_t *tok) {
 
   // scan until closing '
   *tok = mktoken(sp, TOK_LITSTRING);
-  while (!S_MATCH('\'')) {
+  for (;;) {
+    DO(scan_skip_plain(sp, '\'', '\''));
+    if (S_MATCH('\'')) {
+      break;
+    }
     int ch = S_GET();
     if (ch == TOK_FIN) {
       return RETERROR(sp->ebuf, sp->lineno, "unterminated string");
@@ -2185,17 +6375,53 @@ done:
   return 0;
 }
 
-static int process_numstr(char *buffer, int base, const char **reason) {
-  // squeeze out _
-  char *q = strchr(buffer, '_');
-  if (q) {
-    for (int i = q - buffer; buffer[i]; i++) {
-      if (buffer[i] != '_') {
-        *q++ = buffer[i];
-        continue;
-      }
-      int left = (i == 0) ? 0 : buffer[i - 1];
-      int right = buffer[i + 1];
+// Load 8 bytes at p as a little-endian word.
+static inline uint64_t load_le64(const char *p) {
+  uint64_t x;
+  memcpy(&x, p, sizeof(x));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  x = __builtin_bswap64(x);
+#endif
+  return x;
+}
+
+// Check if all 8 bytes of x are ASCII digits.
+static inline bool swar_is_8digits(uint64_t x) {
+  return ((x & 0xF0F0F0F0F0F0F0F0) |
+          (((x + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+// Return the value of the 8 ASCII digits in x, first digit in the
+// lowest byte: pairs, then quads, then the whole.
+static inline uint32_t swar_parse_8digits(uint64_t x) {
+  const uint64_t mask = 0x000000FF000000FF;
+  const uint64_t mul1 = 100 + (1000000ULL << 32);
+  const uint64_t mul2 = 1 + (10000ULL << 32);
+  x -= 0x3030303030303030;
+  x = (x * 10) + (x >> 8);
+  return (uint32_t)((((x & mask) * mul1) + (((x >> 16) & mask) * mul2)) >>
+                    32);
+}
+
+// Return the value of ch as a digit in base, or -1 if it is not one.
+static inline int digit_value(int ch, int base) {
+  int v = -1;
+  if ('0' <= ch && ch <= '9') {
+    v = ch - '0';
+  } else if ('a' <= (ch | 0x20) && (ch | 0x20) <= 'f') {
+    v = (ch | 0x20) - 'a' + 10;
+  }
+  return v < base ? v : -1;
+}
+
+// Check the number in s[0..n) for misplaced underscores, decimal points
+// and leading zeros. Return 0 if it is fine, or -1 with *reason set.
+static int check_numstr(const char *s, int n, int base, const char **reason) {
+  for (int i = 0; i < n; i++) {
+    if (s[i] == '_') {
+      int left = (i == 0) ? 0 : s[i - 1];
+      int right = (i + 1 < n) ? s[i + 1] : 0;
       if (!isdigit(left) && !(base == 16 && is_hex_char(left))) {
         *reason = "underscore only allowed between digits";
         return -1;
@@ -2205,166 +6431,171 @@ static int process_numstr(char *buffer, int base, const char **reason) {
         return -1;
       }
     }
-    *q = 0;
   }
 
-  // decimal points must be surrounded by digits. Also, convert to lowercase.
-  for (int i = 0; buffer[i]; i++) {
-    if (buffer[i] == '.') {
-      if (i == 0 || !isdigit(buffer[i - 1]) || !isdigit(buffer[i + 1])) {
+  // Underscores sit between digits, so the neighbors of a decimal point
+  // are the same as after squeezing them out.
+  for (int i = 0; i < n; i++) {
+    if (s[i] == '.') {
+      if (i == 0 || !isdigit(s[i - 1]) || i + 1 == n || !isdigit(s[i + 1])) {
         *reason = "decimal point must be surrounded by digits";
         return -1;
       }
-    } else if ('A' <= buffer[i] && buffer[i] <= 'Z') {
-      buffer[i] = tolower(buffer[i]);
     }
   }
 
   if (base == 10) {
-    // check for leading 0:  '+01' is an error!
-    q = buffer;
-    q += (*q == '+' || *q == '-') ? 1 : 0;
-    if (q[0] == '0' && isdigit(q[1])) {
+    // check for leading 0:  '+01' and '0_1' are errors!
+    int i = (n > 0 && (s[0] == '+' || s[0] == '-')) ? 1 : 0;
+    if (i + 1 < n && s[i] == '0' && (isdigit(s[i + 1]) || s[i + 1] == '_')) {
       *reason = "leading 0 in numbers";
       return -1;
     }
-
-    // 1e+01 is also an error
-    if (0 != (q = strchr(buffer, 'e'))) {
-      q += (*q == '+' || *q == '-') ? 1 : 0;
-      if (q[0] == '0' && isdigit(q[1])) {
-        *reason = "leading 0 in numbers";
-        return -1;
-      }
-    }
   }
-
   return 0;
 }
 
 static int scan_float(scanner_t *sp, token_t *tok) {
-  char buffer[50]; // need to accomodate "9_007_199_254_740_991.0"
-  int len = sp->endp - sp->cur;
-  if (len >= (int)sizeof(buffer)) {
-    len = sizeof(buffer) - 1;
+  int lineno = sp->lineno;
+  const char *p = sp->cur;
+  const char *q = p + ((p < sp->endp && (*p == '+' || *p == '-')) ? 1 : 0);
+  double fp64;
+  if (sp->endp - q >= 3 &&
+      (0 == memcmp(q, "nan", 3) || 0 == memcmp(q, "inf", 3))) {
+    fp64 = (*q == 'n' ? NAN : INFINITY);
+    fp64 = (*p == '-' ? -fp64 : fp64);
+    q += 3;
+  } else {
+    // Parse straight from the source; there is no length limit.
+    while (q < sp->endp && *q && strchr("_0123456789eE.+-", *q)) {
+      q++;
+    }
+    const char *reason;
+    if (check_numstr(p, q - p, 10, &reason)) {
+      return RETERROR(sp->ebuf, lineno, reason);
+    }
+    if (parse_decimal(p, q, &fp64)) {
+      return RETERROR(sp->ebuf, lineno, "error parsing float");
+    }
   }
-  memcpy(buffer, sp->cur, len);
-  buffer[len] = 0; // NUL
 
+  *tok = mktoken(sp, TOK_FLOAT);
+  tok->u.fp64 = fp64;
+  tok->str.len = q - p;
+  sp->cur = q;
+  return 0;
+}
+
+// Scan a 0x, 0o or 0b integer; shift is log2(base).
+static int scan_radix(scanner_t *sp, token_t *tok, int base, int shift) {
   int lineno = sp->lineno;
-  char *p = buffer;
-  p += (*p == '+' || *p == '-') ? 1 : 0;
-  if (0 == memcmp(p, "nan", 3) || (0 == memcmp(p, "inf", 3))) {
-    p += 3;
-  } else {
-    p += strspn(p, "_0123456789eE.+-");
+  const char *start = sp->cur + 2;
+  const char *endp = sp->endp;
+  const char *p = start;
+  uint64_t val = 0;
+  bool overflow = false;
+  bool bad = false;
+  for (; p < endp; p++) {
+    int d = digit_value(*p, base);
+    if (d >= 0) {
+      overflow |= (val >> (63 - shift)) != 0;
+      val = (val << shift) | d;
+    } else if (*p == '_') {
+      bad |= (p == start || digit_value(p[-1], base) < 0 || p + 1 == endp ||
+              digit_value(p[1], base) < 0);
+    } else {
+      break;
+    }
   }
-  len = p - buffer;
-  buffer[len] = 0;
 
   const char *reason;
-  if (process_numstr(buffer, 10, &reason)) {
+  if (bad && check_numstr(start, p - start, base, &reason)) {
     return RETERROR(sp->ebuf, lineno, reason);
   }
-
-  errno = 0;
-  char *q;
-  double fp64 = strtod(buffer, &q);
-  if (errno || *q || q == buffer) {
-    return RETERROR(sp->ebuf, lineno, "error parsing float");
+  if (p == start || overflow) {
+    return RETERROR(sp->ebuf, lineno, "error parsing integer");
   }
 
-  *tok = mktoken(sp, TOK_FLOAT);
-  tok->u.fp64 = fp64;
-  tok->str.len = len;
-  sp->cur += len;
+  *tok = mktoken(sp, TOK_INTEGER);
+  tok->u.int64 = (int64_t)val;
+  tok->str.len = p - sp->cur;
+  sp->cur = p;
   return 0;
 }
 
 static int scan_number(scanner_t *sp, token_t *tok) {
-  const char *reason;
-  char buffer[50]; // need to accomodate "9_007_199_254_740_991.0"
-  int len = sp->endp - sp->cur;
-  if (len >= (int)sizeof(buffer)) {
-    len = sizeof(buffer) - 1;
-  }
-  memcpy(buffer, sp->cur, len);
-  buffer[len] = 0; // NUL
-
-  char *p = buffer;
-  char *q = buffer + len;
   int lineno = sp->lineno;
-  // process %0x, %0o or %0b integers
-  if (p[0] == '0') {
-    const char *span = 0;
-    int base = 0;
+  const char *p = sp->cur;
+  const char *endp = sp->endp;
+  if (endp - p >= 2 && p[0] == '0') {
     switch (p[1]) {
     case 'x':
-      base = 16;
-      span = "_0123456789abcdefABCDEF";
-      break;
+      return scan_radix(sp, tok, 16, 4);
     case 'o':
-      base = 8;
-      span = "_01234567";
-      break;
+      return scan_radix(sp, tok, 8, 3);
     case 'b':
-      base = 2;
-      span = "_01";
-      break;
-    }
-    if (base) {
-      p += 2;
-      p += strspn(p, span);
-      len = p - buffer;
-      buffer[len] = 0;
-
-      if (process_numstr(buffer + 2, base, &reason)) {
-        return RETERROR(sp->ebuf, lineno, reason);
-      }
-
-      // use strtoll to obtain the value
-      *tok = mktoken(sp, TOK_INTEGER);
-      errno = 0;
-      tok->u.int64 = strtoll(buffer + 2, &q, base);
-      if (errno || *q || q == buffer + 2) {
-        return RETERROR(sp->ebuf, lineno, "error parsing integer");
-      }
-      tok->str.len = len;
-      sp->cur += len;
-      return 0;
+      return scan_radix(sp, tok, 2, 1);
     }
   }
 
-  // handle inf/nan
-  if (*p == '+' || *p == '-') {
-    p++;
+  bool neg = false;
+  if (p < endp && (*p == '+' || *p == '-')) {
+    neg = (*p++ == '-');
   }
-  if (*p == 'i' || *p == 'n') {
-    return scan_float(sp, tok);
+  if (p < endp && (*p == 'i' || *p == 'n')) {
+    return scan_float(sp, tok); // inf or nan
   }
 
-  // regular int or float
-  p = buffer;
-  p += strspn(p, "0123456789_+-.eE");
-  len = p - buffer;
-  buffer[len] = 0;
-
-  if (process_numstr(buffer, 10, &reason)) {
-    return RETERROR(sp->ebuf, lineno, reason);
+  // Decode the digits in one pass, 8 at a time where possible. Any 19
+  // digits fit in w; with more it may wrap, but that is an overflow
+  // anyway.
+  const char *start = p;
+  uint64_t w = 0;
+  int ndigit = 0;
+  bool bad = false;
+  for (;;) {
+    for (uint64_t x; endp - p >= 8 && swar_is_8digits(x = load_le64(p));) {
+      w = w * 100000000 + swar_parse_8digits(x);
+      ndigit += 8;
+      p += 8;
+    }
+    for (; p < endp && isdigit(*p); p++) {
+      w = w * 10 + (*p - '0');
+      ndigit++;
+    }
+    if (p < endp && *p == '_') {
+      bad |= (p == start || !isdigit(p[-1]) || p + 1 == endp ||
+              !isdigit(p[1]));
+      p++;
+      continue;
+    }
+    break;
   }
 
-  *tok = mktoken(sp, TOK_INTEGER);
-  errno = 0;
-  tok->u.int64 = strtoll(buffer, &q, 10);
-  if (errno || *q || q == buffer) {
-    if (*q && strchr(".eE", *q)) {
-      return scan_float(sp, tok); // try to fit a float
+  // A number that goes on past the digits is a float or an error.
+  const char *q = p;
+  for (; q < endp && *q && strchr("0123456789_+-.eE", *q); q++) {
+    if (*q == '.' || *q == 'e' || *q == 'E') {
+      return scan_float(sp, tok);
+    }
+  }
+  if (q != p || bad || ndigit == 0 || (*start == '0' && ndigit > 1)) {
+    const char *reason;
+    if (check_numstr(sp->cur, q - sp->cur, 10, &reason)) {
+      return RETERROR(sp->ebuf, lineno, reason);
     }
     return RETERROR(sp->ebuf, lineno, "error parsing integer");
   }
+  if (ndigit > 19 || w > (uint64_t)INT64_MAX + neg) {
+    return RETERROR(sp->ebuf, lineno, "error parsing integer");
+  }
 
-  tok->str.len = len;
-  sp->cur += len;
+  *tok = mktoken(sp, TOK_INTEGER);
+  tok->u.int64 = (w > (uint64_t)INT64_MAX) ? INT64_MIN
+                 : neg                      ? -(int64_t)w
+                                            : (int64_t)w;
+  tok->str.len = p - sp->cur;
+  sp->cur = p;
   return 0;
 }
 
@@ -2422,7 +6653,7 @@ static bool test_number(const char *p, const char *endp) {
   if (&p[0] < endp && *p && strchr("0123456789+-._", *p)) {
     return true;
   }
-  if (&p[3] < endp) {
+  if (&p[3] <= endp) {
     if (0 == memcmp(p, "nan", 3) || 0 == memcmp(p, "inf", 3)) {
       return true;
     }
@@ -2482,6 +6713,7 @@ static void scan_restore(scanner_t *sp, scanner_state_t mark) {
 // Return the next token
 static int scan_next(scanner_t *sp, bool keymode, token_t *tok) {
 again:
+  sp->cur = scan_blank(sp->cur, sp->endp);
   *tok = mktoken(sp, TOK_FIN);
   if (sp->errmsg) {
     return -1;
@@ -2504,7 +6736,11 @@ again:
 
   case '#':
     // comment: skip until newline
-    while (!S_MATCH('\n')) {
+    for (;;) {
+      DO(scan_skip_plain(sp, 0x7f, 0x7f));
+      if (S_MATCH('\n')) {
+        break;
+      }
       ch = S_GET();
       if (ch == TOK_FIN)
         break;
@@ -2801,3 +7037,1287 @@ static int ucs_to_utf8(uint32_t code, char buf[4]) {
 
   return -1;
 }
+
+// -------------- float conversion
+
+/*
+ *  Decimal to double conversion, correctly rounded and independent of
+ *  the locale. Three tiers, fastest first:
+ *
+ *   1. Clinger's fast path: the mantissa and 10^|e| are both exact
+ *      doubles, so one IEEE multiply or divide rounds correctly.
+ *   2. Eisel-Lemire: multiply the normalized mantissa by a 128-bit
+ *      approximation of 5^e and take the top 54 bits. Bails out in the
+ *      rare case where the truncated product cannot decide the rounding.
+ *   3. An exact decimal with arbitrary shifts (as in Go's strconv),
+ *      for what Eisel-Lemire gives up on and for subnormals.
+ */
+
+// pow5_128[q + 342] holds the top 128 bits of 5^q, normalized so that the
+// most significant bit is set and rounded down, for q in [-342, 308].
+// Generated by:
+//
+//   for q in range(-342, 309):
+//     if q >= 0:
+//       v = 5**q; b = v.bit_length()
+//       m = v >> (b - 128) if b > 128 else v << (128 - b)
+//     else:
+//       d = 5**-q; m = (1 << (d.bit_length() + 127)) // d
+//     print('{0x%016x, 0x%016x},' % (m >> 64, m & (2**64 - 1)))
+//
+#define POW5_MIN -342
+#define POW5_MAX 308
+static const uint64_t pow5_128[][2] = {
+    {0xeef453d6923bd65a, 0x113faa2906a13b3f},
+    {0x9558b4661b6565f8, 0x4ac7ca59a424c507},
+    {0xbaaee17fa23ebf76, 0x5d79bcf00d2df649},
+    {0xe95a99df8ace6f53, 0xf4d82c2c107973dc},
+    {0x91d8a02bb6c10594, 0x79071b9b8a4be869},
+    {0xb64ec836a47146f9, 0x9748e2826cdee284},
+    {0xe3e27a444d8d98b7, 0xfd1b1b2308169b25},
+    {0x8e6d8c6ab0787f72, 0xfe30f0f5e50e20f7},
+    {0xb208ef855c969f4f, 0xbdbd2d335e51a935},
+    {0xde8b2b66b3bc4723, 0xad2c788035e61382},
+    {0x8b16fb203055ac76, 0x4c3bcb5021afcc31},
+    {0xaddcb9e83c6b1793, 0xdf4abe242a1bbf3d},
+    {0xd953e8624b85dd78, 0xd71d6dad34a2af0d},
+    {0x87d4713d6f33aa6b, 0x8672648c40e5ad68},
+    {0xa9c98d8ccb009506, 0x680efdaf511f18c2},
+    {0xd43bf0effdc0ba48, 0x0212bd1b2566def2},
+    {0x84a57695fe98746d, 0x014bb630f7604b57},
+    {0xa5ced43b7e3e9188, 0x419ea3bd35385e2d},
+    {0xcf42894a5dce35ea, 0x52064cac828675b9},
+    {0x818995ce7aa0e1b2, 0x7343efebd1940993},
+    {0xa1ebfb4219491a1f, 0x1014ebe6c5f90bf8},
+    {0xca66fa129f9b60a6, 0xd41a26e077774ef6},
+    {0xfd00b897478238d0, 0x8920b098955522b4},
+    {0x9e20735e8cb16382, 0x55b46e5f5d5535b0},
+    {0xc5a890362fddbc62, 0xeb2189f734aa831d},
+    {0xf712b443bbd52b7b, 0xa5e9ec7501d523e4},
+    {0x9a6bb0aa55653b2d, 0x47b233c92125366e},
+    {0xc1069cd4eabe89f8, 0x999ec0bb696e840a},
+    {0xf148440a256e2c76, 0xc00670ea43ca250d},
+    {0x96cd2a865764dbca, 0x380406926a5e5728},
+    {0xbc807527ed3e12bc, 0xc605083704f5ecf2},
+    {0xeba09271e88d976b, 0xf7864a44c633682e},
+    {0x93445b8731587ea3, 0x7ab3ee6afbe0211d},
+    {0xb8157268fdae9e4c, 0x5960ea05bad82964},
+    {0xe61acf033d1a45df, 0x6fb92487298e33bd},
+    {0x8fd0c16206306bab, 0xa5d3b6d479f8e056},
+    {0xb3c4f1ba87bc8696, 0x8f48a4899877186c},
+    {0xe0b62e2929aba83c, 0x331acdabfe94de87},
+    {0x8c71dcd9ba0b4925, 0x9ff0c08b7f1d0b14},
+    {0xaf8e5410288e1b6f, 0x07ecf0ae5ee44dd9},
+    {0xdb71e91432b1a24a, 0xc9e82cd9f69d6150},
+    {0x892731ac9faf056e, 0xbe311c083a225cd2},
+    {0xab70fe17c79ac6ca, 0x6dbd630a48aaf406},
+    {0xd64d3d9db981787d, 0x092cbbccdad5b108},
+    {0x85f0468293f0eb4e, 0x25bbf56008c58ea5},
+    {0xa76c582338ed2621, 0xaf2af2b80af6f24e},
+    {0xd1476e2c07286faa, 0x1af5af660db4aee1},
+    {0x82cca4db847945ca, 0x50d98d9fc890ed4d},
+    {0xa37fce126597973c, 0xe50ff107bab528a0},
+    {0xcc5fc196fefd7d0c, 0x1e53ed49a96272c8},
+    {0xff77b1fcbebcdc4f, 0x25e8e89c13bb0f7a},
+    {0x9faacf3df73609b1, 0x77b191618c54e9ac},
+    {0xc795830d75038c1d, 0xd59df5b9ef6a2417},
+    {0xf97ae3d0d2446f25, 0x4b0573286b44ad1d},
+    {0x9becce62836ac577, 0x4ee367f9430aec32},
+    {0xc2e801fb244576d5, 0x229c41f793cda73f},
+    {0xf3a20279ed56d48a, 0x6b43527578c1110f},
+    {0x9845418c345644d6, 0x830a13896b78aaa9},
+    {0xbe5691ef416bd60c, 0x23cc986bc656d553},
+    {0xedec366b11c6cb8f, 0x2cbfbe86b7ec8aa8},
+    {0x94b3a202eb1c3f39, 0x7bf7d71432f3d6a9},
+    {0xb9e08a83a5e34f07, 0xdaf5ccd93fb0cc53},
+    {0xe858ad248f5c22c9, 0xd1b3400f8f9cff68},
+    {0x91376c36d99995be, 0x23100809b9c21fa1},
+    {0xb58547448ffffb2d, 0xabd40a0c2832a78a},
+    {0xe2e69915b3fff9f9, 0x16c90c8f323f516c},
+    {0x8dd01fad907ffc3b, 0xae3da7d97f6792e3},
+    {0xb1442798f49ffb4a, 0x99cd11cfdf41779c},
+    {0xdd95317f31c7fa1d, 0x40405643d711d583},
+    {0x8a7d3eef7f1cfc52, 0x482835ea666b2572},
+    {0xad1c8eab5ee43b66, 0xda3243650005eecf},
+    {0xd863b256369d4a40, 0x90bed43e40076a82},
+    {0x873e4f75e2224e68, 0x5a7744a6e804a291},
+    {0xa90de3535aaae202, 0x711515d0a205cb36},
+    {0xd3515c2831559a83, 0x0d5a5b44ca873e03},
+    {0x8412d9991ed58091, 0xe858790afe9486c2},
+    {0xa5178fff668ae0b6, 0x626e974dbe39a872},
+    {0xce5d73ff402d98e3, 0xfb0a3d212dc8128f},
+    {0x80fa687f881c7f8e, 0x7ce66634bc9d0b99},
+    {0xa139029f6a239f72, 0x1c1fffc1ebc44e80},
+    {0xc987434744ac874e, 0xa327ffb266b56220},
+    {0xfbe9141915d7a922, 0x4bf1ff9f0062baa8},
+    {0x9d71ac8fada6c9b5, 0x6f773fc3603db4a9},
+    {0xc4ce17b399107c22, 0xcb550fb4384d21d3},
+    {0xf6019da07f549b2b, 0x7e2a53a146606a48},
+    {0x99c102844f94e0fb, 0x2eda7444cbfc426d},
+    {0xc0314325637a1939, 0xfa911155fefb5308},
+    {0xf03d93eebc589f88, 0x793555ab7eba27ca},
+    {0x96267c7535b763b5, 0x4bc1558b2f3458de},
+    {0xbbb01b9283253ca2, 0x9eb1aaedfb016f16},
+    {0xea9c227723ee8bcb, 0x465e15a979c1cadc},
+    {0x92a1958a7675175f, 0x0bfacd89ec191ec9},
+    {0xb749faed14125d36, 0xcef980ec671f667b},
+    {0xe51c79a85916f484, 0x82b7e12780e7401a},
+    {0x8f31cc0937ae58d2, 0xd1b2ecb8b0908810},
+    {0xb2fe3f0b8599ef07, 0x861fa7e6dcb4aa15},
+    {0xdfbdcece67006ac9, 0x67a791e093e1d49a},
+    {0x8bd6a141006042bd, 0xe0c8bb2c5c6d24e0},
+    {0xaecc49914078536d, 0x58fae9f773886e18},
+    {0xda7f5bf590966848, 0xaf39a475506a899e},
+    {0x888f99797a5e012d, 0x6d8406c952429603},
+    {0xaab37fd7d8f58178, 0xc8e5087ba6d33b83},
+    {0xd5605fcdcf32e1d6, 0xfb1e4a9a90880a64},
+    {0x855c3be0a17fcd26, 0x5cf2eea09a55067f},
+    {0xa6b34ad8c9dfc06f, 0xf42faa48c0ea481e},
+    {0xd0601d8efc57b08b, 0xf13b94daf124da26},
+    {0x823c12795db6ce57, 0x76c53d08d6b70858},
+    {0xa2cb1717b52481ed, 0x54768c4b0c64ca6e},
+    {0xcb7ddcdda26da268, 0xa9942f5dcf7dfd09},
+    {0xfe5d54150b090b02, 0xd3f93b35435d7c4c},
+    {0x9efa548d26e5a6e1, 0xc47bc5014a1a6daf},
+    {0xc6b8e9b0709f109a, 0x359ab6419ca1091b},
+    {0xf867241c8cc6d4c0, 0xc30163d203c94b62},
+    {0x9b407691d7fc44f8, 0x79e0de63425dcf1d},
+    {0xc21094364dfb5636, 0x985915fc12f542e4},
+    {0xf294b943e17a2bc4, 0x3e6f5b7b17b2939d},
+    {0x979cf3ca6cec5b5a, 0xa705992ceecf9c42},
+    {0xbd8430bd08277231, 0x50c6ff782a838353},
+    {0xece53cec4a314ebd, 0xa4f8bf5635246428},
+    {0x940f4613ae5ed136, 0x871b7795e136be99},
+    {0xb913179899f68584, 0x28e2557b59846e3f},
+    {0xe757dd7ec07426e5, 0x331aeada2fe589cf},
+    {0x9096ea6f3848984f, 0x3ff0d2c85def7621},
+    {0xb4bca50b065abe63, 0x0fed077a756b53a9},
+    {0xe1ebce4dc7f16dfb, 0xd3e8495912c62894},
+    {0x8d3360f09cf6e4bd, 0x64712dd7abbbd95c},
+    {0xb080392cc4349dec, 0xbd8d794d96aacfb3},
+    {0xdca04777f541c567, 0xecf0d7a0fc5583a0},
+    {0x89e42caaf9491b60, 0xf41686c49db57244},
+    {0xac5d37d5b79b6239, 0x311c2875c522ced5},
+    {0xd77485cb25823ac7, 0x7d633293366b828b},
+    {0x86a8d39ef77164bc, 0xae5dff9c02033197},
+    {0xa8530886b54dbdeb, 0xd9f57f830283fdfc},
+    {0xd267caa862a12d66, 0xd072df63c324fd7b},
+    {0x8380dea93da4bc60, 0x4247cb9e59f71e6d},
+    {0xa46116538d0deb78, 0x52d9be85f074e608},
+    {0xcd795be870516656, 0x67902e276c921f8b},
+    {0x806bd9714632dff6, 0x00ba1cd8a3db53b6},
+    {0xa086cfcd97bf97f3, 0x80e8a40eccd228a4},
+    {0xc8a883c0fdaf7df0, 0x6122cd128006b2cd},
+    {0xfad2a4b13d1b5d6c, 0x796b805720085f81},
+    {0x9cc3a6eec6311a63, 0xcbe3303674053bb0},
+    {0xc3f490aa77bd60fc, 0xbedbfc4411068a9c},
+    {0xf4f1b4d515acb93b, 0xee92fb5515482d44},
+    {0x991711052d8bf3c5, 0x751bdd152d4d1c4a},
+    {0xbf5cd54678eef0b6, 0xd262d45a78a0635d},
+    {0xef340a98172aace4, 0x86fb897116c87c34},
+    {0x9580869f0e7aac0e, 0xd45d35e6ae3d4da0},
+    {0xbae0a846d2195712, 0x8974836059cca109},
+    {0xe998d258869facd7, 0x2bd1a438703fc94b},
+    {0x91ff83775423cc06, 0x7b6306a34627ddcf},
+    {0xb67f6455292cbf08, 0x1a3bc84c17b1d542},
+    {0xe41f3d6a7377eeca, 0x20caba5f1d9e4a93},
+    {0x8e938662882af53e, 0x547eb47b7282ee9c},
+    {0xb23867fb2a35b28d, 0xe99e619a4f23aa43},
+    {0xdec681f9f4c31f31, 0x6405fa00e2ec94d4},
+    {0x8b3c113c38f9f37e, 0xde83bc408dd3dd04},
+    {0xae0b158b4738705e, 0x9624ab50b148d445},
+    {0xd98ddaee19068c76, 0x3badd624dd9b0957},
+    {0x87f8a8d4cfa417c9, 0xe54ca5d70a80e5d6},
+    {0xa9f6d30a038d1dbc, 0x5e9fcf4ccd211f4c},
+    {0xd47487cc8470652b, 0x7647c3200069671f},
+    {0x84c8d4dfd2c63f3b, 0x29ecd9f40041e073},
+    {0xa5fb0a17c777cf09, 0xf468107100525890},
+    {0xcf79cc9db955c2cc, 0x7182148d4066eeb4},
+    {0x81ac1fe293d599bf, 0xc6f14cd848405530},
+    {0xa21727db38cb002f, 0xb8ada00e5a506a7c},
+    {0xca9cf1d206fdc03b, 0xa6d90811f0e4851c},
+    {0xfd442e4688bd304a, 0x908f4a166d1da663},
+    {0x9e4a9cec15763e2e, 0x9a598e4e043287fe},
+    {0xc5dd44271ad3cdba, 0x40eff1e1853f29fd},
+    {0xf7549530e188c128, 0xd12bee59e68ef47c},
+    {0x9a94dd3e8cf578b9, 0x82bb74f8301958ce},
+    {0xc13a148e3032d6e7, 0xe36a52363c1faf01},
+    {0xf18899b1bc3f8ca1, 0xdc44e6c3cb279ac1},
+    {0x96f5600f15a7b7e5, 0x29ab103a5ef8c0b9},
+    {0xbcb2b812db11a5de, 0x7415d448f6b6f0e7},
+    {0xebdf661791d60f56, 0x111b495b3464ad21},
+    {0x936b9fcebb25c995, 0xcab10dd900beec34},
+    {0xb84687c269ef3bfb, 0x3d5d514f40eea742},
+    {0xe65829b3046b0afa, 0x0cb4a5a3112a5112},
+    {0x8ff71a0fe2c2e6dc, 0x47f0e785eaba72ab},
+    {0xb3f4e093db73a093, 0x59ed216765690f56},
+    {0xe0f218b8d25088b8, 0x306869c13ec3532c},
+    {0x8c974f7383725573, 0x1e414218c73a13fb},
+    {0xafbd2350644eeacf, 0xe5d1929ef90898fa},
+    {0xdbac6c247d62a583, 0xdf45f746b74abf39},
+    {0x894bc396ce5da772, 0x6b8bba8c328eb783},
+    {0xab9eb47c81f5114f, 0x066ea92f3f326564},
+    {0xd686619ba27255a2, 0xc80a537b0efefebd},
+    {0x8613fd0145877585, 0xbd06742ce95f5f36},
+    {0xa798fc4196e952e7, 0x2c48113823b73704},
+    {0xd17f3b51fca3a7a0, 0xf75a15862ca504c5},
+    {0x82ef85133de648c4, 0x9a984d73dbe722fb},
+    {0xa3ab66580d5fdaf5, 0xc13e60d0d2e0ebba},
+    {0xcc963fee10b7d1b3, 0x318df905079926a8},
+    {0xffbbcfe994e5c61f, 0xfdf17746497f7052},
+    {0x9fd561f1fd0f9bd3, 0xfeb6ea8bedefa633},
+    {0xc7caba6e7c5382c8, 0xfe64a52ee96b8fc0},
+    {0xf9bd690a1b68637b, 0x3dfdce7aa3c673b0},
+    {0x9c1661a651213e2d, 0x06bea10ca65c084e},
+    {0xc31bfa0fe5698db8, 0x486e494fcff30a62},
+    {0xf3e2f893dec3f126, 0x5a89dba3c3efccfa},
+    {0x986ddb5c6b3a76b7, 0xf89629465a75e01c},
+    {0xbe89523386091465, 0xf6bbb397f1135823},
+    {0xee2ba6c0678b597f, 0x746aa07ded582e2c},
+    {0x94db483840b717ef, 0xa8c2a44eb4571cdc},
+    {0xba121a4650e4ddeb, 0x92f34d62616ce413},
+    {0xe896a0d7e51e1566, 0x77b020baf9c81d17},
+    {0x915e2486ef32cd60, 0x0ace1474dc1d122e},
+    {0xb5b5ada8aaff80b8, 0x0d819992132456ba},
+    {0xe3231912d5bf60e6, 0x10e1fff697ed6c69},
+    {0x8df5efabc5979c8f, 0xca8d3ffa1ef463c1},
+    {0xb1736b96b6fd83b3, 0xbd308ff8a6b17cb2},
+    {0xddd0467c64bce4a0, 0xac7cb3f6d05ddbde},
+    {0x8aa22c0dbef60ee4, 0x6bcdf07a423aa96b},
+    {0xad4ab7112eb3929d, 0x86c16c98d2c953c6},
+    {0xd89d64d57a607744, 0xe871c7bf077ba8b7},
+    {0x87625f056c7c4a8b, 0x11471cd764ad4972},
+    {0xa93af6c6c79b5d2d, 0xd598e40d3dd89bcf},
+    {0xd389b47879823479, 0x4aff1d108d4ec2c3},
+    {0x843610cb4bf160cb, 0xcedf722a585139ba},
+    {0xa54394fe1eedb8fe, 0xc2974eb4ee658828},
+    {0xce947a3da6a9273e, 0x733d226229feea32},
+    {0x811ccc668829b887, 0x0806357d5a3f525f},
+    {0xa163ff802a3426a8, 0xca07c2dcb0cf26f7},
+    {0xc9bcff6034c13052, 0xfc89b393dd02f0b5},
+    {0xfc2c3f3841f17c67, 0xbbac2078d443ace2},
+    {0x9d9ba7832936edc0, 0xd54b944b84aa4c0d},
+    {0xc5029163f384a931, 0x0a9e795e65d4df11},
+    {0xf64335bcf065d37d, 0x4d4617b5ff4a16d5},
+    {0x99ea0196163fa42e, 0x504bced1bf8e4e45},
+    {0xc06481fb9bcf8d39, 0xe45ec2862f71e1d6},
+    {0xf07da27a82c37088, 0x5d767327bb4e5a4c},
+    {0x964e858c91ba2655, 0x3a6a07f8d510f86f},
+    {0xbbe226efb628afea, 0x890489f70a55368b},
+    {0xeadab0aba3b2dbe5, 0x2b45ac74ccea842e},
+    {0x92c8ae6b464fc96f, 0x3b0b8bc90012929d},
+    {0xb77ada0617e3bbcb, 0x09ce6ebb40173744},
+    {0xe55990879ddcaabd, 0xcc420a6a101d0515},
+    {0x8f57fa54c2a9eab6, 0x9fa946824a12232d},
+    {0xb32df8e9f3546564, 0x47939822dc96abf9},
+    {0xdff9772470297ebd, 0x59787e2b93bc56f7},
+    {0x8bfbea76c619ef36, 0x57eb4edb3c55b65a},
+    {0xaefae51477a06b03, 0xede622920b6b23f1},
+    {0xdab99e59958885c4, 0xe95fab368e45eced},
+    {0x88b402f7fd75539b, 0x11dbcb0218ebb414},
+    {0xaae103b5fcd2a881, 0xd652bdc29f26a119},
+    {0xd59944a37c0752a2, 0x4be76d3346f0495f},
+    {0x857fcae62d8493a5, 0x6f70a4400c562ddb},
+    {0xa6dfbd9fb8e5b88e, 0xcb4ccd500f6bb952},
+    {0xd097ad07a71f26b2, 0x7e2000a41346a7a7},
+    {0x825ecc24c873782f, 0x8ed400668c0c28c8},
+    {0xa2f67f2dfa90563b, 0x728900802f0f32fa},
+    {0xcbb41ef979346bca, 0x4f2b40a03ad2ffb9},
+    {0xfea126b7d78186bc, 0xe2f610c84987bfa8},
+    {0x9f24b832e6b0f436, 0x0dd9ca7d2df4d7c9},
+    {0xc6ede63fa05d3143, 0x91503d1c79720dbb},
+    {0xf8a95fcf88747d94, 0x75a44c6397ce912a},
+    {0x9b69dbe1b548ce7c, 0xc986afbe3ee11aba},
+    {0xc24452da229b021b, 0xfbe85badce996168},
+    {0xf2d56790ab41c2a2, 0xfae27299423fb9c3},
+    {0x97c560ba6b0919a5, 0xdccd879fc967d41a},
+    {0xbdb6b8e905cb600f, 0x5400e987bbc1c920},
+    {0xed246723473e3813, 0x290123e9aab23b68},
+    {0x9436c0760c86e30b, 0xf9a0b6720aaf6521},
+    {0xb94470938fa89bce, 0xf808e40e8d5b3e69},
+    {0xe7958cb87392c2c2, 0xb60b1d1230b20e04},
+    {0x90bd77f3483bb9b9, 0xb1c6f22b5e6f48c2},
+    {0xb4ecd5f01a4aa828, 0x1e38aeb6360b1af3},
+    {0xe2280b6c20dd5232, 0x25c6da63c38de1b0},
+    {0x8d590723948a535f, 0x579c487e5a38ad0e},
+    {0xb0af48ec79ace837, 0x2d835a9df0c6d851},
+    {0xdcdb1b2798182244, 0xf8e431456cf88e65},
+    {0x8a08f0f8bf0f156b, 0x1b8e9ecb641b58ff},
+    {0xac8b2d36eed2dac5, 0xe272467e3d222f3f},
+    {0xd7adf884aa879177, 0x5b0ed81dcc6abb0f},
+    {0x86ccbb52ea94baea, 0x98e947129fc2b4e9},
+    {0xa87fea27a539e9a5, 0x3f2398d747b36224},
+    {0xd29fe4b18e88640e, 0x8eec7f0d19a03aad},
+    {0x83a3eeeef9153e89, 0x1953cf68300424ac},
+    {0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7},
+    {0xcdb02555653131b6, 0x3792f412cb06794d},
+    {0x808e17555f3ebf11, 0xe2bbd88bbee40bd0},
+    {0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4},
+    {0xc8de047564d20a8b, 0xf245825a5a445275},
+    {0xfb158592be068d2e, 0xeed6e2f0f0d56712},
+    {0x9ced737bb6c4183d, 0x55464dd69685606b},
+    {0xc428d05aa4751e4c, 0xaa97e14c3c26b886},
+    {0xf53304714d9265df, 0xd53dd99f4b3066a8},
+    {0x993fe2c6d07b7fab, 0xe546a8038efe4029},
+    {0xbf8fdb78849a5f96, 0xde98520472bdd033},
+    {0xef73d256a5c0f77c, 0x963e66858f6d4440},
+    {0x95a8637627989aad, 0xdde7001379a44aa8},
+    {0xbb127c53b17ec159, 0x5560c018580d5d52},
+    {0xe9d71b689dde71af, 0xaab8f01e6e10b4a6},
+    {0x9226712162ab070d, 0xcab3961304ca70e8},
+    {0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22},
+    {0xe45c10c42a2b3b05, 0x8cb89a7db77c506a},
+    {0x8eb98a7a9a5b04e3, 0x77f3608e92adb242},
+    {0xb267ed1940f1c61c, 0x55f038b237591ed3},
+    {0xdf01e85f912e37a3, 0x6b6c46dec52f6688},
+    {0x8b61313bbabce2c6, 0x2323ac4b3b3da015},
+    {0xae397d8aa96c1b77, 0xabec975e0a0d081a},
+    {0xd9c7dced53c72255, 0x96e7bd358c904a21},
+    {0x881cea14545c7575, 0x7e50d64177da2e54},
+    {0xaa242499697392d2, 0xdde50bd1d5d0b9e9},
+    {0xd4ad2dbfc3d07787, 0x955e4ec64b44e864},
+    {0x84ec3c97da624ab4, 0xbd5af13bef0b113e},
+    {0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e},
+    {0xcfb11ead453994ba, 0x67de18eda5814af2},
+    {0x81ceb32c4b43fcf4, 0x80eacf948770ced7},
+    {0xa2425ff75e14fc31, 0xa1258379a94d028d},
+    {0xcad2f7f5359a3b3e, 0x096ee45813a04330},
+    {0xfd87b5f28300ca0d, 0x8bca9d6e188853fc},
+    {0x9e74d1b791e07e48, 0x775ea264cf55347d},
+    {0xc612062576589dda, 0x95364afe032a819d},
+    {0xf79687aed3eec551, 0x3a83ddbd83f52204},
+    {0x9abe14cd44753b52, 0xc4926a9672793542},
+    {0xc16d9a0095928a27, 0x75b7053c0f178293},
+    {0xf1c90080baf72cb1, 0x5324c68b12dd6338},
+    {0x971da05074da7bee, 0xd3f6fc16ebca5e03},
+    {0xbce5086492111aea, 0x88f4bb1ca6bcf584},
+    {0xec1e4a7db69561a5, 0x2b31e9e3d06c32e5},
+    {0x9392ee8e921d5d07, 0x3aff322e62439fcf},
+    {0xb877aa3236a4b449, 0x09befeb9fad487c2},
+    {0xe69594bec44de15b, 0x4c2ebe687989a9b3},
+    {0x901d7cf73ab0acd9, 0x0f9d37014bf60a10},
+    {0xb424dc35095cd80f, 0x538484c19ef38c94},
+    {0xe12e13424bb40e13, 0x2865a5f206b06fb9},
+    {0x8cbccc096f5088cb, 0xf93f87b7442e45d3},
+    {0xafebff0bcb24aafe, 0xf78f69a51539d748},
+    {0xdbe6fecebdedd5be, 0xb573440e5a884d1b},
+    {0x89705f4136b4a597, 0x31680a88f8953030},
+    {0xabcc77118461cefc, 0xfdc20d2b36ba7c3d},
+    {0xd6bf94d5e57a42bc, 0x3d32907604691b4c},
+    {0x8637bd05af6c69b5, 0xa63f9a49c2c1b10f},
+    {0xa7c5ac471b478423, 0x0fcf80dc33721d53},
+    {0xd1b71758e219652b, 0xd3c36113404ea4a8},
+    {0x83126e978d4fdf3b, 0x645a1cac083126e9},
+    {0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a3},
+    {0xcccccccccccccccc, 0xcccccccccccccccc},
+    {0x8000000000000000, 0x0000000000000000},
+    {0xa000000000000000, 0x0000000000000000},
+    {0xc800000000000000, 0x0000000000000000},
+    {0xfa00000000000000, 0x0000000000000000},
+    {0x9c40000000000000, 0x0000000000000000},
+    {0xc350000000000000, 0x0000000000000000},
+    {0xf424000000000000, 0x0000000000000000},
+    {0x9896800000000000, 0x0000000000000000},
+    {0xbebc200000000000, 0x0000000000000000},
+    {0xee6b280000000000, 0x0000000000000000},
+    {0x9502f90000000000, 0x0000000000000000},
+    {0xba43b74000000000, 0x0000000000000000},
+    {0xe8d4a51000000000, 0x0000000000000000},
+    {0x9184e72a00000000, 0x0000000000000000},
+    {0xb5e620f480000000, 0x0000000000000000},
+    {0xe35fa931a0000000, 0x0000000000000000},
+    {0x8e1bc9bf04000000, 0x0000000000000000},
+    {0xb1a2bc2ec5000000, 0x0000000000000000},
+    {0xde0b6b3a76400000, 0x0000000000000000},
+    {0x8ac7230489e80000, 0x0000000000000000},
+    {0xad78ebc5ac620000, 0x0000000000000000},
+    {0xd8d726b7177a8000, 0x0000000000000000},
+    {0x878678326eac9000, 0x0000000000000000},
+    {0xa968163f0a57b400, 0x0000000000000000},
+    {0xd3c21bcecceda100, 0x0000000000000000},
+    {0x84595161401484a0, 0x0000000000000000},
+    {0xa56fa5b99019a5c8, 0x0000000000000000},
+    {0xcecb8f27f4200f3a, 0x0000000000000000},
+    {0x813f3978f8940984, 0x4000000000000000},
+    {0xa18f07d736b90be5, 0x5000000000000000},
+    {0xc9f2c9cd04674ede, 0xa400000000000000},
+    {0xfc6f7c4045812296, 0x4d00000000000000},
+    {0x9dc5ada82b70b59d, 0xf020000000000000},
+    {0xc5371912364ce305, 0x6c28000000000000},
+    {0xf684df56c3e01bc6, 0xc732000000000000},
+    {0x9a130b963a6c115c, 0x3c7f400000000000},
+    {0xc097ce7bc90715b3, 0x4b9f100000000000},
+    {0xf0bdc21abb48db20, 0x1e86d40000000000},
+    {0x96769950b50d88f4, 0x1314448000000000},
+    {0xbc143fa4e250eb31, 0x17d955a000000000},
+    {0xeb194f8e1ae525fd, 0x5dcfab0800000000},
+    {0x92efd1b8d0cf37be, 0x5aa1cae500000000},
+    {0xb7abc627050305ad, 0xf14a3d9e40000000},
+    {0xe596b7b0c643c719, 0x6d9ccd05d0000000},
+    {0x8f7e32ce7bea5c6f, 0xe4820023a2000000},
+    {0xb35dbf821ae4f38b, 0xdda2802c8a800000},
+    {0xe0352f62a19e306e, 0xd50b2037ad200000},
+    {0x8c213d9da502de45, 0x4526f422cc340000},
+    {0xaf298d050e4395d6, 0x9670b12b7f410000},
+    {0xdaf3f04651d47b4c, 0x3c0cdd765f114000},
+    {0x88d8762bf324cd0f, 0xa5880a69fb6ac800},
+    {0xab0e93b6efee0053, 0x8eea0d047a457a00},
+    {0xd5d238a4abe98068, 0x72a4904598d6d880},
+    {0x85a36366eb71f041, 0x47a6da2b7f864750},
+    {0xa70c3c40a64e6c51, 0x999090b65f67d924},
+    {0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d},
+    {0x82818f1281ed449f, 0xbff8f10e7a8921a4},
+    {0xa321f2d7226895c7, 0xaff72d52192b6a0d},
+    {0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490},
+    {0xfee50b7025c36a08, 0x02f236d04753d5b4},
+    {0x9f4f2726179a2245, 0x01d762422c946590},
+    {0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5},
+    {0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2},
+    {0x9b934c3b330c8577, 0x63cc55f49f88eb2f},
+    {0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb},
+    {0xf316271c7fc3908a, 0x8bef464e3945ef7a},
+    {0x97edd871cfda3a56, 0x97758bf0e3cbb5ac},
+    {0xbde94e8e43d0c8ec, 0x3d52eeed1cbea317},
+    {0xed63a231d4c4fb27, 0x4ca7aaa863ee4bdd},
+    {0x945e455f24fb1cf8, 0x8fe8caa93e74ef6a},
+    {0xb975d6b6ee39e436, 0xb3e2fd538e122b44},
+    {0xe7d34c64a9c85d44, 0x60dbbca87196b616},
+    {0x90e40fbeea1d3a4a, 0xbc8955e946fe31cd},
+    {0xb51d13aea4a488dd, 0x6babab6398bdbe41},
+    {0xe264589a4dcdab14, 0xc696963c7eed2dd1},
+    {0x8d7eb76070a08aec, 0xfc1e1de5cf543ca2},
+    {0xb0de65388cc8ada8, 0x3b25a55f43294bcb},
+    {0xdd15fe86affad912, 0x49ef0eb713f39ebe},
+    {0x8a2dbf142dfcc7ab, 0x6e3569326c784337},
+    {0xacb92ed9397bf996, 0x49c2c37f07965404},
+    {0xd7e77a8f87daf7fb, 0xdc33745ec97be906},
+    {0x86f0ac99b4e8dafd, 0x69a028bb3ded71a3},
+    {0xa8acd7c0222311bc, 0xc40832ea0d68ce0c},
+    {0xd2d80db02aabd62b, 0xf50a3fa490c30190},
+    {0x83c7088e1aab65db, 0x792667c6da79e0fa},
+    {0xa4b8cab1a1563f52, 0x577001b891185938},
+    {0xcde6fd5e09abcf26, 0xed4c0226b55e6f86},
+    {0x80b05e5ac60b6178, 0x544f8158315b05b4},
+    {0xa0dc75f1778e39d6, 0x696361ae3db1c721},
+    {0xc913936dd571c84c, 0x03bc3a19cd1e38e9},
+    {0xfb5878494ace3a5f, 0x04ab48a04065c723},
+    {0x9d174b2dcec0e47b, 0x62eb0d64283f9c76},
+    {0xc45d1df942711d9a, 0x3ba5d0bd324f8394},
+    {0xf5746577930d6500, 0xca8f44ec7ee36479},
+    {0x9968bf6abbe85f20, 0x7e998b13cf4e1ecb},
+    {0xbfc2ef456ae276e8, 0x9e3fedd8c321a67e},
+    {0xefb3ab16c59b14a2, 0xc5cfe94ef3ea101e},
+    {0x95d04aee3b80ece5, 0xbba1f1d158724a12},
+    {0xbb445da9ca61281f, 0x2a8a6e45ae8edc97},
+    {0xea1575143cf97226, 0xf52d09d71a3293bd},
+    {0x924d692ca61be758, 0x593c2626705f9c56},
+    {0xb6e0c377cfa2e12e, 0x6f8b2fb00c77836c},
+    {0xe498f455c38b997a, 0x0b6dfb9c0f956447},
+    {0x8edf98b59a373fec, 0x4724bd4189bd5eac},
+    {0xb2977ee300c50fe7, 0x58edec91ec2cb657},
+    {0xdf3d5e9bc0f653e1, 0x2f2967b66737e3ed},
+    {0x8b865b215899f46c, 0xbd79e0d20082ee74},
+    {0xae67f1e9aec07187, 0xecd8590680a3aa11},
+    {0xda01ee641a708de9, 0xe80e6f4820cc9495},
+    {0x884134fe908658b2, 0x3109058d147fdcdd},
+    {0xaa51823e34a7eede, 0xbd4b46f0599fd415},
+    {0xd4e5e2cdc1d1ea96, 0x6c9e18ac7007c91a},
+    {0x850fadc09923329e, 0x03e2cf6bc604ddb0},
+    {0xa6539930bf6bff45, 0x84db8346b786151c},
+    {0xcfe87f7cef46ff16, 0xe612641865679a63},
+    {0x81f14fae158c5f6e, 0x4fcb7e8f3f60c07e},
+    {0xa26da3999aef7749, 0xe3be5e330f38f09d},
+    {0xcb090c8001ab551c, 0x5cadf5bfd3072cc5},
+    {0xfdcb4fa002162a63, 0x73d9732fc7c8f7f6},
+    {0x9e9f11c4014dda7e, 0x2867e7fddcdd9afa},
+    {0xc646d63501a1511d, 0xb281e1fd541501b8},
+    {0xf7d88bc24209a565, 0x1f225a7ca91a4226},
+    {0x9ae757596946075f, 0x3375788de9b06958},
+    {0xc1a12d2fc3978937, 0x0052d6b1641c83ae},
+    {0xf209787bb47d6b84, 0xc0678c5dbd23a49a},
+    {0x9745eb4d50ce6332, 0xf840b7ba963646e0},
+    {0xbd176620a501fbff, 0xb650e5a93bc3d898},
+    {0xec5d3fa8ce427aff, 0xa3e51f138ab4cebe},
+    {0x93ba47c980e98cdf, 0xc66f336c36b10137},
+    {0xb8a8d9bbe123f017, 0xb80b0047445d4184},
+    {0xe6d3102ad96cec1d, 0xa60dc059157491e5},
+    {0x9043ea1ac7e41392, 0x87c89837ad68db2f},
+    {0xb454e4a179dd1877, 0x29babe4598c311fb},
+    {0xe16a1dc9d8545e94, 0xf4296dd6fef3d67a},
+    {0x8ce2529e2734bb1d, 0x1899e4a65f58660c},
+    {0xb01ae745b101e9e4, 0x5ec05dcff72e7f8f},
+    {0xdc21a1171d42645d, 0x76707543f4fa1f73},
+    {0x899504ae72497eba, 0x6a06494a791c53a8},
+    {0xabfa45da0edbde69, 0x0487db9d17636892},
+    {0xd6f8d7509292d603, 0x45a9d2845d3c42b6},
+    {0x865b86925b9bc5c2, 0x0b8a2392ba45a9b2},
+    {0xa7f26836f282b732, 0x8e6cac7768d7141e},
+    {0xd1ef0244af2364ff, 0x3207d795430cd926},
+    {0x8335616aed761f1f, 0x7f44e6bd49e807b8},
+    {0xa402b9c5a8d3a6e7, 0x5f16206c9c6209a6},
+    {0xcd036837130890a1, 0x36dba887c37a8c0f},
+    {0x802221226be55a64, 0xc2494954da2c9789},
+    {0xa02aa96b06deb0fd, 0xf2db9baa10b7bd6c},
+    {0xc83553c5c8965d3d, 0x6f92829494e5acc7},
+    {0xfa42a8b73abbf48c, 0xcb772339ba1f17f9},
+    {0x9c69a97284b578d7, 0xff2a760414536efb},
+    {0xc38413cf25e2d70d, 0xfef5138519684aba},
+    {0xf46518c2ef5b8cd1, 0x7eb258665fc25d69},
+    {0x98bf2f79d5993802, 0xef2f773ffbd97a61},
+    {0xbeeefb584aff8603, 0xaafb550ffacfd8fa},
+    {0xeeaaba2e5dbf6784, 0x95ba2a53f983cf38},
+    {0x952ab45cfa97a0b2, 0xdd945a747bf26183},
+    {0xba756174393d88df, 0x94f971119aeef9e4},
+    {0xe912b9d1478ceb17, 0x7a37cd5601aab85d},
+    {0x91abb422ccb812ee, 0xac62e055c10ab33a},
+    {0xb616a12b7fe617aa, 0x577b986b314d6009},
+    {0xe39c49765fdf9d94, 0xed5a7e85fda0b80b},
+    {0x8e41ade9fbebc27d, 0x14588f13be847307},
+    {0xb1d219647ae6b31c, 0x596eb2d8ae258fc8},
+    {0xde469fbd99a05fe3, 0x6fca5f8ed9aef3bb},
+    {0x8aec23d680043bee, 0x25de7bb9480d5854},
+    {0xada72ccc20054ae9, 0xaf561aa79a10ae6a},
+    {0xd910f7ff28069da4, 0x1b2ba1518094da04},
+    {0x87aa9aff79042286, 0x90fb44d2f05d0842},
+    {0xa99541bf57452b28, 0x353a1607ac744a53},
+    {0xd3fa922f2d1675f2, 0x42889b8997915ce8},
+    {0x847c9b5d7c2e09b7, 0x69956135febada11},
+    {0xa59bc234db398c25, 0x43fab9837e699095},
+    {0xcf02b2c21207ef2e, 0x94f967e45e03f4bb},
+    {0x8161afb94b44f57d, 0x1d1be0eebac278f5},
+    {0xa1ba1ba79e1632dc, 0x6462d92a69731732},
+    {0xca28a291859bbf93, 0x7d7b8f7503cfdcfe},
+    {0xfcb2cb35e702af78, 0x5cda735244c3d43e},
+    {0x9defbf01b061adab, 0x3a0888136afa64a7},
+    {0xc56baec21c7a1916, 0x088aaa1845b8fdd0},
+    {0xf6c69a72a3989f5b, 0x8aad549e57273d45},
+    {0x9a3c2087a63f6399, 0x36ac54e2f678864b},
+    {0xc0cb28a98fcf3c7f, 0x84576a1bb416a7dd},
+    {0xf0fdf2d3f3c30b9f, 0x656d44a2a11c51d5},
+    {0x969eb7c47859e743, 0x9f644ae5a4b1b325},
+    {0xbc4665b596706114, 0x873d5d9f0dde1fee},
+    {0xeb57ff22fc0c7959, 0xa90cb506d155a7ea},
+    {0x9316ff75dd87cbd8, 0x09a7f12442d588f2},
+    {0xb7dcbf5354e9bece, 0x0c11ed6d538aeb2f},
+    {0xe5d3ef282a242e81, 0x8f1668c8a86da5fa},
+    {0x8fa475791a569d10, 0xf96e017d694487bc},
+    {0xb38d92d760ec4455, 0x37c981dcc395a9ac},
+    {0xe070f78d3927556a, 0x85bbe253f47b1417},
+    {0x8c469ab843b89562, 0x93956d7478ccec8e},
+    {0xaf58416654a6babb, 0x387ac8d1970027b2},
+    {0xdb2e51bfe9d0696a, 0x06997b05fcc0319e},
+    {0x88fcf317f22241e2, 0x441fece3bdf81f03},
+    {0xab3c2fddeeaad25a, 0xd527e81cad7626c3},
+    {0xd60b3bd56a5586f1, 0x8a71e223d8d3b074},
+    {0x85c7056562757456, 0xf6872d5667844e49},
+    {0xa738c6bebb12d16c, 0xb428f8ac016561db},
+    {0xd106f86e69d785c7, 0xe13336d701beba52},
+    {0x82a45b450226b39c, 0xecc0024661173473},
+    {0xa34d721642b06084, 0x27f002d7f95d0190},
+    {0xcc20ce9bd35c78a5, 0x31ec038df7b441f4},
+    {0xff290242c83396ce, 0x7e67047175a15271},
+    {0x9f79a169bd203e41, 0x0f0062c6e984d386},
+    {0xc75809c42c684dd1, 0x52c07b78a3e60868},
+    {0xf92e0c3537826145, 0xa7709a56ccdf8a82},
+    {0x9bbcc7a142b17ccb, 0x88a66076400bb691},
+    {0xc2abf989935ddbfe, 0x6acff893d00ea435},
+    {0xf356f7ebf83552fe, 0x0583f6b8c4124d43},
+    {0x98165af37b2153de, 0xc3727a337a8b704a},
+    {0xbe1bf1b059e9a8d6, 0x744f18c0592e4c5c},
+    {0xeda2ee1c7064130c, 0x1162def06f79df73},
+    {0x9485d4d1c63e8be7, 0x8addcb5645ac2ba8},
+    {0xb9a74a0637ce2ee1, 0x6d953e2bd7173692},
+    {0xe8111c87c5c1ba99, 0xc8fa8db6ccdd0437},
+    {0x910ab1d4db9914a0, 0x1d9c9892400a22a2},
+    {0xb54d5e4a127f59c8, 0x2503beb6d00cab4b},
+    {0xe2a0b5dc971f303a, 0x2e44ae64840fd61d},
+    {0x8da471a9de737e24, 0x5ceaecfed289e5d2},
+    {0xb10d8e1456105dad, 0x7425a83e872c5f47},
+    {0xdd50f1996b947518, 0xd12f124e28f77719},
+    {0x8a5296ffe33cc92f, 0x82bd6b70d99aaa6f},
+    {0xace73cbfdc0bfb7b, 0x636cc64d1001550b},
+    {0xd8210befd30efa5a, 0x3c47f7e05401aa4e},
+    {0x8714a775e3e95c78, 0x65acfaec34810a71},
+    {0xa8d9d1535ce3b396, 0x7f1839a741a14d0d},
+    {0xd31045a8341ca07c, 0x1ede48111209a050},
+    {0x83ea2b892091e44d, 0x934aed0aab460432},
+    {0xa4e4b66b68b65d60, 0xf81da84d5617853f},
+    {0xce1de40642e3f4b9, 0x36251260ab9d668e},
+    {0x80d2ae83e9ce78f3, 0xc1d72b7c6b426019},
+    {0xa1075a24e4421730, 0xb24cf65b8612f81f},
+    {0xc94930ae1d529cfc, 0xdee033f26797b627},
+    {0xfb9b7cd9a4a7443c, 0x169840ef017da3b1},
+    {0x9d412e0806e88aa5, 0x8e1f289560ee864e},
+    {0xc491798a08a2ad4e, 0xf1a6f2bab92a27e2},
+    {0xf5b5d7ec8acb58a2, 0xae10af696774b1db},
+    {0x9991a6f3d6bf1765, 0xacca6da1e0a8ef29},
+    {0xbff610b0cc6edd3f, 0x17fd090a58d32af3},
+    {0xeff394dcff8a948e, 0xddfc4b4cef07f5b0},
+    {0x95f83d0a1fb69cd9, 0x4abdaf101564f98e},
+    {0xbb764c4ca7a4440f, 0x9d6d1ad41abe37f1},
+    {0xea53df5fd18d5513, 0x84c86189216dc5ed},
+    {0x92746b9be2f8552c, 0x32fd3cf5b4e49bb4},
+    {0xb7118682dbb66a77, 0x3fbc8c33221dc2a1},
+    {0xe4d5e82392a40515, 0x0fabaf3feaa5334a},
+    {0x8f05b1163ba6832d, 0x29cb4d87f2a7400e},
+    {0xb2c71d5bca9023f8, 0x743e20e9ef511012},
+    {0xdf78e4b2bd342cf6, 0x914da9246b255416},
+    {0x8bab8eefb6409c1a, 0x1ad089b6c2f7548e},
+    {0xae9672aba3d0c320, 0xa184ac2473b529b1},
+    {0xda3c0f568cc4f3e8, 0xc9e5d72d90a2741e},
+    {0x8865899617fb1871, 0x7e2fa67c7a658892},
+    {0xaa7eebfb9df9de8d, 0xddbb901b98feeab7},
+    {0xd51ea6fa85785631, 0x552a74227f3ea565},
+    {0x8533285c936b35de, 0xd53a88958f87275f},
+    {0xa67ff273b8460356, 0x8a892abaf368f137},
+    {0xd01fef10a657842c, 0x2d2b7569b0432d85},
+    {0x8213f56a67f6b29b, 0x9c3b29620e29fc73},
+    {0xa298f2c501f45f42, 0x8349f3ba91b47b8f},
+    {0xcb3f2f7642717713, 0x241c70a936219a73},
+    {0xfe0efb53d30dd4d7, 0xed238cd383aa0110},
+    {0x9ec95d1463e8a506, 0xf4363804324a40aa},
+    {0xc67bb4597ce2ce48, 0xb143c6053edcd0d5},
+    {0xf81aa16fdc1b81da, 0xdd94b7868e94050a},
+    {0x9b10a4e5e9913128, 0xca7cf2b4191c8326},
+    {0xc1d4ce1f63f57d72, 0xfd1c2f611f63a3f0},
+    {0xf24a01a73cf2dccf, 0xbc633b39673c8cec},
+    {0x976e41088617ca01, 0xd5be0503e085d813},
+    {0xbd49d14aa79dbc82, 0x4b2d8644d8a74e18},
+    {0xec9c459d51852ba2, 0xddf8e7d60ed1219e},
+    {0x93e1ab8252f33b45, 0xcabb90e5c942b503},
+    {0xb8da1662e7b00a17, 0x3d6a751f3b936243},
+    {0xe7109bfba19c0c9d, 0x0cc512670a783ad4},
+    {0x906a617d450187e2, 0x27fb2b80668b24c5},
+    {0xb484f9dc9641e9da, 0xb1f9f660802dedf6},
+    {0xe1a63853bbd26451, 0x5e7873f8a0396973},
+    {0x8d07e33455637eb2, 0xdb0b487b6423e1e8},
+    {0xb049dc016abc5e5f, 0x91ce1a9a3d2cda62},
+    {0xdc5c5301c56b75f7, 0x7641a140cc7810fb},
+    {0x89b9b3e11b6329ba, 0xa9e904c87fcb0a9d},
+    {0xac2820d9623bf429, 0x546345fa9fbdcd44},
+    {0xd732290fbacaf133, 0xa97c177947ad4095},
+    {0x867f59a9d4bed6c0, 0x49ed8eabcccc485d},
+    {0xa81f301449ee8c70, 0x5c68f256bfff5a74},
+    {0xd226fc195c6a2f8c, 0x73832eec6fff3111},
+    {0x83585d8fd9c25db7, 0xc831fd53c5ff7eab},
+    {0xa42e74f3d032f525, 0xba3e7ca8b77f5e55},
+    {0xcd3a1230c43fb26f, 0x28ce1bd2e55f35eb},
+    {0x80444b5e7aa7cf85, 0x7980d163cf5b81b3},
+    {0xa0555e361951c366, 0xd7e105bcc332621f},
+    {0xc86ab5c39fa63440, 0x8dd9472bf3fefaa7},
+    {0xfa856334878fc150, 0xb14f98f6f0feb951},
+    {0x9c935e00d4b9d8d2, 0x6ed1bf9a569f33d3},
+    {0xc3b8358109e84f07, 0x0a862f80ec4700c8},
+    {0xf4a642e14c6262c8, 0xcd27bb612758c0fa},
+    {0x98e7e9cccfbd7dbd, 0x8038d51cb897789c},
+    {0xbf21e44003acdd2c, 0xe0470a63e6bd56c3},
+    {0xeeea5d5004981478, 0x1858ccfce06cac74},
+    {0x95527a5202df0ccb, 0x0f37801e0c43ebc8},
+    {0xbaa718e68396cffd, 0xd30560258f54e6ba},
+    {0xe950df20247c83fd, 0x47c6b82ef32a2069},
+    {0x91d28b7416cdd27e, 0x4cdc331d57fa5441},
+    {0xb6472e511c81471d, 0xe0133fe4adf8e952},
+    {0xe3d8f9e563a198e5, 0x58180fddd97723a6},
+    {0x8e679c2f5e44ff8f, 0x570f09eaa7ea7648},
+};
+
+// 128-bit product of a and b. Return the high half; store the low half.
+static inline uint64_t mul128(uint64_t a, uint64_t b, uint64_t *lo) {
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 r = (unsigned __int128)a * b;
+  *lo = (uint64_t)r;
+  return (uint64_t)(r >> 64);
+#else
+  uint64_t a0 = (uint32_t)a, a1 = a >> 32;
+  uint64_t b0 = (uint32_t)b, b1 = b >> 32;
+  uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+  *lo = (mid << 32) | (uint32_t)p00;
+  return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+static inline int clz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(x);
+#else
+  int n = 0;
+  for (; !(x >> 63); x <<= 1, n++)
+    ;
+  return n;
+#endif
+}
+
+static inline double bits_to_double(uint64_t bits) {
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+// Eisel-Lemire: convert w * 10^e10 (w != 0) to the bits of the nearest
+// double. Return -1 if it cannot decide, or if the result is not a
+// normal double.
+static int eisel_lemire(uint64_t w, int e10, uint64_t *ret) {
+  if (e10 < POW5_MIN || e10 > POW5_MAX) {
+    return -1;
+  }
+  const uint64_t *pow5 = pow5_128[e10 - POW5_MIN];
+
+  // Normalize w; 217706 / 2^16 approximates log2(10).
+  int clz = clz64(w);
+  w <<= clz;
+  uint64_t exp2 = (uint64_t)(((217706 * e10) >> 16) + 64 + 1023 - clz);
+
+  // Multiply by the high 64 bits of 5^e10, and by the low 64 bits too if
+  // the truncated product is too close to a rounding boundary.
+  uint64_t lo;
+  uint64_t hi = mul128(w, pow5[0], &lo);
+  if ((hi & 0x1ff) == 0x1ff && lo + w < w) {
+    uint64_t lo2;
+    uint64_t hi2 = mul128(w, pow5[1], &lo2);
+    uint64_t mlo = lo + hi2;
+    uint64_t mhi = hi + (mlo < lo);
+    if ((mhi & 0x1ff) == 0x1ff && mlo + 1 == 0 && lo2 + w < w) {
+      return -1;
+    }
+    hi = mhi, lo = mlo;
+  }
+
+  // Keep 54 bits.
+  uint64_t msb = hi >> 63;
+  uint64_t mant = hi >> (msb + 9);
+  exp2 -= 1 ^ msb;
+
+  // Exactly halfway between two doubles: cannot tell without the rest.
+  if (lo == 0 && (hi & 0x1ff) == 0 && (mant & 3) == 1) {
+    return -1;
+  }
+
+  // Round to 53 bits.
+  mant += mant & 1;
+  mant >>= 1;
+  if (mant >> 53) {
+    mant >>= 1;
+    exp2++;
+  }
+  // exp2 is unsigned; this is (exp2 <= 0 || exp2 >= 0x7ff).
+  if (exp2 - 1 >= 0x7ff - 1) {
+    return -1;
+  }
+  *ret = (exp2 << 52) | (mant & ((1ull << 52) - 1));
+  return 0;
+}
+
+/*
+ *  An exact decimal 0.d[0]d[1]...d[nd-1] * 10^dp. Digits are ASCII.
+ *  Only the first DECIMAL_MAXDIGIT digits are kept; trunc tells if any
+ *  non-zero digit was dropped, which is all that rounding needs.
+ */
+#define DECIMAL_MAXDIGIT 800
+#define DECIMAL_MAXSHIFT 60
+typedef struct decimal_t decimal_t;
+struct decimal_t {
+  char d[DECIMAL_MAXDIGIT];
+  int nd;
+  int dp;
+  bool trunc;
+};
+
+// Drop trailing zeros.
+static void decimal_trim(decimal_t *a) {
+  while (a->nd > 0 && a->d[a->nd - 1] == '0') {
+    a->nd--;
+  }
+  if (a->nd == 0) {
+    a->dp = 0;
+  }
+}
+
+// a = a / 2^k, for k <= DECIMAL_MAXSHIFT.
+static void decimal_rshift(decimal_t *a, int k) {
+  int r = 0, w = 0;
+  uint64_t n = 0;
+
+  // Pick up enough leading digits to cover the first shift.
+  for (; (n >> k) == 0; r++) {
+    if (r >= a->nd) {
+      if (n == 0) {
+        a->nd = 0;
+        return;
+      }
+      for (; (n >> k) == 0; r++) {
+        n *= 10;
+      }
+      break;
+    }
+    n = n * 10 + (a->d[r] - '0');
+  }
+  a->dp -= r - 1;
+
+  // Pick up a digit, put down a digit.
+  uint64_t mask = (1ull << k) - 1;
+  for (; r < a->nd; r++) {
+    a->d[w++] = (char)('0' + (n >> k));
+    n = (n & mask) * 10 + (a->d[r] - '0');
+  }
+
+  // Put down the remaining digits.
+  while (n > 0) {
+    int dig = n >> k;
+    n = (n & mask) * 10;
+    if (w < DECIMAL_MAXDIGIT) {
+      a->d[w++] = (char)('0' + dig);
+    } else if (dig > 0) {
+      a->trunc = true;
+    }
+  }
+  a->nd = w;
+  decimal_trim(a);
+}
+
+// a = a * 2^k, for k <= DECIMAL_MAXSHIFT.
+static void decimal_lshift(decimal_t *a, int k) {
+  // Produce the digits right to left; k <= 60 adds at most 19 digits.
+  char tmp[DECIMAL_MAXDIGIT + 20];
+  int w = sizeof(tmp);
+  uint64_t n = 0;
+  for (int r = a->nd - 1; r >= 0; r--) {
+    n += (uint64_t)(a->d[r] - '0') << k;
+    tmp[--w] = (char)('0' + n % 10);
+    n /= 10;
+  }
+  for (; n > 0; n /= 10) {
+    tmp[--w] = (char)('0' + n % 10);
+  }
+  int nd = sizeof(tmp) - w;
+  a->dp += nd - a->nd;
+  if (nd > DECIMAL_MAXDIGIT) {
+    for (int i = DECIMAL_MAXDIGIT; i < nd; i++) {
+      a->trunc |= (tmp[w + i] != '0');
+    }
+    nd = DECIMAL_MAXDIGIT;
+  }
+  memcpy(a->d, tmp + w, nd);
+  a->nd = nd;
+  decimal_trim(a);
+}
+
+// a = a * 2^k; k may be negative.
+static void decimal_shift(decimal_t *a, int k) {
+  if (a->nd == 0) {
+    return;
+  }
+  for (; k > DECIMAL_MAXSHIFT; k -= DECIMAL_MAXSHIFT) {
+    decimal_lshift(a, DECIMAL_MAXSHIFT);
+  }
+  for (; k < -DECIMAL_MAXSHIFT; k += DECIMAL_MAXSHIFT) {
+    decimal_rshift(a, DECIMAL_MAXSHIFT);
+  }
+  if (k > 0) {
+    decimal_lshift(a, k);
+  } else if (k < 0) {
+    decimal_rshift(a, -k);
+  }
+}
+
+// Should a be rounded up if truncated to nd digits? Ties go to even.
+static bool decimal_roundup(const decimal_t *a, int nd) {
+  if (nd < 0 || nd >= a->nd) {
+    return false;
+  }
+  if (a->d[nd] == '5' && nd + 1 == a->nd) {
+    if (a->trunc) {
+      return true; // a little above half
+    }
+    return nd > 0 && (a->d[nd - 1] - '0') % 2 != 0;
+  }
+  return a->d[nd] >= '5';
+}
+
+// Return a rounded to the nearest integer; a must be below 2^64.
+static uint64_t decimal_round(const decimal_t *a) {
+  uint64_t n = 0;
+  int i;
+  for (i = 0; i < a->dp && i < a->nd; i++) {
+    n = n * 10 + (a->d[i] - '0');
+  }
+  for (; i < a->dp; i++) {
+    n *= 10;
+  }
+  return n + decimal_roundup(a, a->dp);
+}
+
+// Convert a to the bits of the nearest double (without sign). Subnormals
+// are handled; overflow gives infinity.
+static uint64_t decimal_to_bits(decimal_t *a) {
+  static const int powtab[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+  const int ntab = sizeof(powtab) / sizeof(powtab[0]);
+  const int bias = -1023;
+  int exp = 0;
+  uint64_t mant = 0;
+
+  if (a->nd == 0 || a->dp < -330) {
+    return 0; // zero
+  }
+  if (a->dp > 310) {
+    goto overflow;
+  }
+
+  // Scale by powers of two into [0.5, 1).
+  while (a->dp > 0) {
+    int n = a->dp >= ntab ? 27 : powtab[a->dp];
+    decimal_shift(a, -n);
+    exp += n;
+  }
+  while (a->dp < 0 || (a->dp == 0 && a->d[0] < '5')) {
+    int n = -a->dp >= ntab ? 27 : powtab[-a->dp];
+    decimal_shift(a, n);
+    exp -= n;
+  }
+  exp--; // [0.5, 1) -> [1, 2)
+
+  // Below the smallest normal exponent: denormalize.
+  if (exp < bias + 1) {
+    int n = bias + 1 - exp;
+    decimal_shift(a, -n);
+    exp += n;
+  }
+  if (exp - bias >= 0x7ff) {
+    goto overflow;
+  }
+
+  // Take 53 bits, and renormalize if rounding carried out.
+  decimal_shift(a, 53);
+  mant = decimal_round(a);
+  if (mant == (2ull << 52)) {
+    mant >>= 1;
+    exp++;
+    if (exp - bias >= 0x7ff) {
+      goto overflow;
+    }
+  }
+  if (!(mant & (1ull << 52))) {
+    exp = bias; // subnormal
+  }
+  return (mant & ((1ull << 52) - 1)) | ((uint64_t)(exp - bias) << 52);
+
+overflow:
+  return 0x7ffull << 52;
+}
+
+// Read the decimal float in [p, endp) into a. The text has been checked.
+static void decimal_read(decimal_t *a, const char *p, const char *endp) {
+  bool sawdot = false;
+  int e = 0, esign = 1;
+  a->nd = a->dp = 0;
+  a->trunc = false;
+  p += (*p == '+' || *p == '-');
+  for (; p < endp; p++) {
+    int ch = *p;
+    if (ch == '_') {
+      continue;
+    }
+    if (ch == '.') {
+      sawdot = true;
+      a->dp = a->nd;
+      continue;
+    }
+    if (ch == 'e' || ch == 'E') {
+      p++;
+      if (*p == '+' || *p == '-') {
+        esign = (*p++ == '-' ? -1 : 1);
+      }
+      for (; p < endp; p++) {
+        if (*p != '_' && e < 100000) {
+          e = e * 10 + (*p - '0');
+        }
+      }
+      break;
+    }
+    if (ch == '0' && a->nd == 0) {
+      a->dp--; // leading zero
+      continue;
+    }
+    if (a->nd < DECIMAL_MAXDIGIT) {
+      a->d[a->nd++] = (char)ch;
+    } else if (ch != '0') {
+      a->trunc = true;
+    }
+  }
+  if (!sawdot) {
+    a->dp = a->nd;
+  }
+  a->dp += e * esign;
+}
+
+/*
+ *  Parse the float in [p, endp) per the TOML grammar:
+ *
+ *    [+-] digits [. digits] [(e|E) [+-] digits]
+ *
+ *  with at least one of the fraction and exponent parts. Underscores,
+ *  dots and leading zeros must have been checked by check_numstr().
+ *  Values that strtod() flags with ERANGE, i.e. overflows and non-zero
+ *  values that round to a subnormal or zero, are errors.
+ *  Return 0 on success, -1 otherwise.
+ */
+static int parse_decimal(const char *p, const char *endp, double *ret) {
+  const char *start = p;
+  bool neg = false;
+  if (p < endp && (*p == '+' || *p == '-')) {
+    neg = (*p++ == '-');
+  }
+
+  // Take the first 19 significant digits into w; count the dropped
+  // ones into e10 (integer part) and trunc (if non-zero).
+  uint64_t w = 0;
+  int nsig = 0, e10 = 0, ndigit = 0;
+  bool trunc = false;
+  for (; p < endp && (isdigit(*p) || *p == '_'); p++) {
+    if (*p == '_') {
+      continue;
+    }
+    ndigit++;
+    if (nsig < 19) {
+      w = w * 10 + (*p - '0');
+      nsig += (w != 0);
+    } else {
+      e10++;
+      trunc |= (*p != '0');
+    }
+  }
+  if (ndigit == 0) {
+    return -1;
+  }
+  bool isfloat = false;
+  if (p < endp && *p == '.') {
+    p++;
+    ndigit = 0;
+    for (; p < endp && (isdigit(*p) || *p == '_'); p++) {
+      if (*p == '_') {
+        continue;
+      }
+      ndigit++;
+      if (nsig < 19) {
+        w = w * 10 + (*p - '0');
+        nsig += (w != 0);
+        e10--;
+      } else {
+        trunc |= (*p != '0');
+      }
+    }
+    if (ndigit == 0) {
+      return -1;
+    }
+    isfloat = true;
+  }
+  if (p < endp && (*p == 'e' || *p == 'E')) {
+    p++;
+    int esign = 1, e = 0;
+    if (p < endp && (*p == '+' || *p == '-')) {
+      esign = (*p++ == '-' ? -1 : 1);
+    }
+    ndigit = 0;
+    for (; p < endp && (isdigit(*p) || *p == '_'); p++) {
+      if (*p != '_') {
+        ndigit++;
+        e = (e < 100000 ? e * 10 + (*p - '0') : e);
+      }
+    }
+    if (ndigit == 0) {
+      return -1;
+    }
+    e10 += e * esign;
+    isfloat = true;
+  }
+  if (p != endp || !isfloat) {
+    return -1;
+  }
+
+  uint64_t bits, bits1;
+  if (w == 0) {
+    bits = 0;
+  }
+#if FLT_EVAL_METHOD == 0
+  else if (!trunc && w <= (1ull << 53) && -22 <= e10 && e10 <= 22) {
+    // Clinger's fast path.
+    static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                   1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                   1e18, 1e19, 1e20, 1e21, 1e22};
+    double d = (double)w;
+    d = (e10 < 0 ? d / pow10[-e10] : d * pow10[e10]);
+    *ret = neg ? -d : d;
+    return 0;
+  }
+#endif
+  else if (e10 < POW5_MIN) {
+    return -1; // below 2^64 * 10^-343: underflow
+  } else if (e10 > POW5_MAX) {
+    return -1; // overflow
+  } else if (0 == eisel_lemire(w, e10, &bits) &&
+             (!trunc ||
+              (0 == eisel_lemire(w + 1, e10, &bits1) && bits1 == bits))) {
+    ; // w and w+1 bracket the real mantissa; both round the same
+  } else {
+    decimal_t a;
+    decimal_read(&a, start, endp);
+    bits = decimal_to_bits(&a);
+  }
+
+  // strtod() sets ERANGE on these; keep treating them as errors.
+  uint64_t exp2 = bits >> 52;
+  if (exp2 == 0x7ff || (w != 0 && exp2 == 0)) {
+    return -1;
+  }
+  *ret = bits_to_double(bits | ((uint64_t)neg << 63));
+  return 0;
+}
+
+/*
+ *  Double to shortest decimal, as in Go's strconv: expand the double,
+ *  and the midpoints to its neighbours, exactly into decimal_t; then
+ *  take the fewest leading digits that stay strictly between the two
+ *  midpoints (or on one if the mantissa is even, as reads round to
+ *  even), rounding the last of them to nearest.
+ */
+
+// a = v.
+static void decimal_assign(decimal_t *a, uint64_t v) {
+  char tmp[20];
+  int n = 0;
+  for (; v > 0; v /= 10) {
+    tmp[n++] = (char)('0' + v % 10);
+  }
+  for (int i = 0; i < n; i++) {
+    a->d[i] = tmp[n - 1 - i];
+  }
+  a->nd = a->dp = n;
+  a->trunc = false;
+  decimal_trim(a);
+}
+
+// Keep the first nd digits of a, and add one unit to the last of them if
+// up is set.
+static void decimal_cut(decimal_t *a, int nd, bool up) {
+  if (nd < 0 || nd >= a->nd) {
+    return;
+  }
+  if (!up) {
+    a->nd = nd;
+    decimal_trim(a);
+    return;
+  }
+  int i = nd - 1;
+  while (i >= 0 && a->d[i] == '9') {
+    i--;
+  }
+  if (i < 0) {
+    // All nines: 0.99..9 * 10^dp rounds up to 0.1 * 10^(dp + 1).
+    a->d[0] = '1';
+    a->nd = 1;
+    a->dp++;
+    return;
+  }
+  a->d[i]++;
+  a->nd = i + 1;
+}
+
+// Set *a to the shortest decimal that reads back as the double with
+// mantissa mant and exponent exp, i.e., mant * 2^(exp - 52).
+static void decimal_shortest(decimal_t *a, uint64_t mant, int exp) {
+  const int minexp = -1022;
+  decimal_assign(a, mant);
+  decimal_shift(a, exp - 52);
+  // An integer with no more digits than the double has bits is exact.
+  if (exp > minexp && 332 * (a->dp - a->nd) >= 100 * (exp - 52)) {
+    return;
+  }
+
+  // The midpoints to the next double up and down. Below a power of two,
+  // the next double down is half as far.
+  decimal_t upper, lower;
+  decimal_assign(&upper, mant * 2 + 1);
+  decimal_shift(&upper, exp - 53);
+  uint64_t mantlo = mant - 1;
+  int explo = exp;
+  if (mant == (1ull << 52) && exp > minexp) {
+    mantlo = mant * 2 - 1;
+    explo = exp - 1;
+  }
+  decimal_assign(&lower, mantlo * 2 + 1);
+  decimal_shift(&lower, explo - 53);
+  bool inclusive = (mant % 2 == 0);
+
+  // Walk the digits of upper, with those of a and lower aligned to them.
+  int upperdelta = 0; // 0: a == upper so far; 1: a + 1 == upper; 2: more
+  for (int ui = 0;; ui++) {
+    int mi = ui - upper.dp + a->dp;
+    if (mi >= a->nd) {
+      break;
+    }
+    int li = ui - upper.dp + lower.dp;
+    char l = (li >= 0 && li < lower.nd ? lower.d[li] : '0');
+    char m = (mi >= 0 ? a->d[mi] : '0');
+    char u = (ui < upper.nd ? upper.d[ui] : '0');
+
+    // Can a be cut here, or rounded up here, and stay within bounds?
+    bool okdown = (l != m || (inclusive && li + 1 == lower.nd));
+    if (upperdelta == 0 && m + 1 < u) {
+      upperdelta = 2;
+    } else if (upperdelta == 0 && m != u) {
+      upperdelta = 1;
+    } else if (upperdelta == 1 && (m != '9' || u != '0')) {
+      upperdelta = 2;
+    }
+    bool okup = (upperdelta > 0 &&
+                 (inclusive || upperdelta > 1 || ui + 1 < upper.nd));
+    if (okdown || okup) {
+      decimal_cut(a, mi + 1,
+                  okdown && okup ? decimal_roundup(a, mi + 1) : okup);
+      return;
+    }
+  }
+}
+
+// Write the shortest digits that read back as x, a positive finite
+// double, into dig[] and return their count; x is 0.dig * 10^(e10 + 1).
+// Independent of the locale.
+static int shortest_digits(double x, char dig[17], int *ret_e10) {
+  int nd = 0;
+  if (x < 0x1p53 && x == (double)(uint64_t)x) {
+    // An integer below 2^53 is exact; drop its trailing zeros.
+    uint64_t v = (uint64_t)x;
+    int nzero = 0;
+    for (; v % 10 == 0; v /= 10) {
+      nzero++;
+    }
+    char tmp[20];
+    int n = 0;
+    for (; v > 0; v /= 10) {
+      tmp[n++] = (char)('0' + v % 10);
+    }
+    while (n > 0) {
+      dig[nd++] = tmp[--n];
+    }
+    *ret_e10 = nd + nzero - 1;
+    return nd;
+  }
+
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  int exp = (int)(bits >> 52);
+  uint64_t mant = bits & ((1ull << 52) - 1);
+  if (exp == 0) {
+    exp = -1022; // subnormal
+  } else {
+    mant |= 1ull << 52;
+    exp -= 1023;
+  }
+  decimal_t a;
+  decimal_shortest(&a, mant, exp);
+  assert(0 < a.nd && a.nd <= 17);
+  memcpy(dig, a.d, a.nd);
+  *ret_e10 = a.dp - 1;
+  return a.nd;
+}
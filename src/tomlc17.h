@@ -13,6 +13,9 @@
  *     result.toptab
  *  4. Call toml_free() to release resources.
  *
+ *  To stream a document through callbacks without building a tree,
+ *  call toml_sax_parse() instead.
+ *
  */
 
 #include <stdbool.h>
@@ -50,7 +53,7 @@ struct toml_datum_t {
   union {
     const char *s; // same as str.ptr; use if there are no NUL in string.
     struct {
-      const char *ptr; // NUL terminated string
+      const char *ptr; // NUL terminated string, unless borrow_src is set
       int len;         // length excluding the terminating NUL.
     } str;
     int64_t int64; // integer
@@ -93,6 +96,59 @@ struct toml_result_t {
  */
 TOML_EXTERN toml_result_t toml_parse(const char *src, int len);
 
+/**
+ * Parse a toml document held in src[0..len-1]. Same as toml_parse(),
+ * except that src[] need not be NUL terminated: the parser never reads
+ * at or beyond src + len. Use this on mmap'd files, network buffers, or
+ * slices of a larger blob.
+ */
+TOML_EXTERN toml_result_t toml_parse_n(const char *src, int len);
+
+/**
+ * Parse a toml document held in src[0..len-1] with nthreads threads, or
+ * one per CPU if nthreads <= 0. The document is split at its table
+ * headers, and the tables they define are parsed concurrently. Returns
+ * the same result as toml_parse_n(), except that an error may be
+ * reported as a different one when there are several.
+ *
+ * The mem_realloc and mem_free options must be thread-safe. The lazy
+ * option does not apply.
+ */
+TOML_EXTERN toml_result_t toml_parse_parallel(const char *src, int len,
+                                              int nthreads);
+
+/* A parser context, for parsing many documents without allocating
+ * memory for each. */
+typedef struct toml_context_t toml_context_t;
+
+/**
+ * Create a parser context. Returns NULL if out of memory; it is fine to
+ * pass that NULL on, and toml_parse_with() will report it. Release it
+ * with toml_context_free().
+ */
+TOML_EXTERN toml_context_t *toml_context_new(void);
+
+/**
+ * Parse a toml document held in src[0..len-1], as toml_parse_n() does,
+ * into the memory of ctx, with the options in effect when ctx was
+ * created. The result stays valid until ctx is reset or freed;
+ * toml_free() on it is a no-op. Tables and arrays are always allocated
+ * from an arena, and the lazy option does not apply.
+ */
+TOML_EXTERN toml_result_t toml_parse_with(toml_context_t *ctx,
+                                          const char *src, int len);
+
+/**
+ * Release all results parsed with ctx, but keep its memory for the next
+ * parses. Once ctx has seen its biggest load, parsing does not allocate.
+ */
+TOML_EXTERN void toml_context_reset(toml_context_t *ctx);
+
+/**
+ * Release ctx and all results parsed with it.
+ */
+TOML_EXTERN void toml_context_free(toml_context_t *ctx);
+
 /**
  * Parse a toml file. Returns a toml_result which must be freed
  * using toml_free() eventually.
@@ -107,6 +163,108 @@ TOML_EXTERN toml_result_t toml_parse_file(FILE *fp);
  */
 TOML_EXTERN toml_result_t toml_parse_file_ex(const char *fname);
 
+/**
+ * Save the tree of result to the file at path as a binary image, which
+ * toml_load_binary() can load without parsing. Lazy sections are parsed
+ * first. Returns 0 on success, or -1 on error.
+ *
+ * The image is in the memory layout of this platform, and can only be
+ * loaded by a build of tomlc17 for the same one.
+ */
+TOML_EXTERN int toml_save_binary(const toml_result_t *result,
+                                 const char *path);
+
+/**
+ * Load an image written by toml_save_binary(). The file is mapped into
+ * memory and its tree is read in place, so this takes about as long as
+ * mapping the file. Returns a toml_result which must be freed using
+ * toml_free() eventually; strings in it are NUL terminated.
+ *
+ * Only the header of the image is checked. Do not load images from
+ * untrusted sources.
+ */
+TOML_EXTERN toml_result_t toml_load_binary(const char *path);
+
+/* Callbacks for toml_sax_parse(). Any of them may be NULL. A callback
+ * returns 0 to continue, or non-zero to stop the parse.
+ *
+ * Keys are passed as key[0..nkey) with lengths len[0..nkey); a dotted
+ * key has several parts. Keys and string values are NOT NUL terminated
+ * and are only valid during the call.
+ *
+ * Each key/value is a key() event followed by its value:
+ *   - a scalar is one value() event, with value.type set;
+ *   - an array is array_begin(), a value per element, then array_end();
+ *   - an inline table is table_begin(), key/values, then table_end().
+ */
+typedef struct toml_sax_handler_t toml_sax_handler_t;
+struct toml_sax_handler_t {
+  // [a.b.c]: later key/values belong to this table.
+  int (*table)(void *ctx, int nkey, const char *const *key, const int *len);
+  // [[a.b.c]]: a new element of an array of tables.
+  int (*array_table)(void *ctx, int nkey, const char *const *key,
+                     const int *len);
+  int (*key)(void *ctx, int nkey, const char *const *key, const int *len);
+  int (*value)(void *ctx, toml_datum_t value); // never an array or table
+  int (*array_begin)(void *ctx);
+  int (*array_end)(void *ctx);
+  int (*table_begin)(void *ctx); // inline table
+  int (*table_end)(void *ctx);
+};
+
+/**
+ * Parse src[0..len-1] and report it to handler as a stream of events,
+ * without building a tree. Only the keys and table structure needed to
+ * reject duplicate keys and redefined tables are kept, and only until
+ * the call returns. src[] need not be NUL terminated.
+ *
+ * Returns a result whose toptab is an empty table. Check result.ok and
+ * result.errmsg; if a callback stopped the parse, ok is false. Events
+ * are delivered as the parse goes, so a document found invalid later
+ * may already have produced some. toml_free() is not needed.
+ */
+TOML_EXTERN toml_result_t toml_sax_parse(const char *src, int len,
+                                         const toml_sax_handler_t *handler,
+                                         void *ctx);
+
+/* A push parser, for input that arrives in chunks. */
+typedef struct toml_parser_t toml_parser_t;
+
+/**
+ * Create a push parser. Feed it the document with toml_parser_feed(),
+ * then call toml_parser_finish(). Returns NULL if out of memory; it is
+ * fine to pass that NULL on, and toml_parser_finish() will report it.
+ */
+TOML_EXTERN toml_parser_t *toml_parser_new(void);
+
+/**
+ * Append chunk[0..len-1] to the document. Chunks may split lines,
+ * tokens and UTF-8 chars anywhere. Complete lines are parsed into the
+ * tree right away and their text is dropped, so only the unparsed tail
+ * of the input is held. Returns 0 on success, or -1 on error; the
+ * error message comes with the result of toml_parser_finish().
+ */
+TOML_EXTERN int toml_parser_feed(toml_parser_t *parser, const char *chunk,
+                                 int len);
+
+/**
+ * Parse the rest of the document and release the parser, which must
+ * not be used again. Returns a toml_result which must be freed using
+ * toml_free() eventually. The borrow_src option does not apply: all
+ * strings are copied.
+ */
+TOML_EXTERN toml_result_t toml_parser_finish(toml_parser_t *parser);
+
+/**
+ * With the lazy option, errors in a section are found when toml_get()
+ * first reaches it, and toml_get() then returns a TOML_UNKNOWN. Return
+ * the message of the first such error, or NULL if there is none.
+ *
+ * Note: toml_get() parses sections of a lazy result on demand, so a
+ * lazy result must not be read by several threads at once.
+ */
+TOML_EXTERN const char *toml_lazy_error(const toml_result_t *result);
+
 /**
  * Release the result.
  */
@@ -118,16 +276,97 @@ TOML_EXTERN void toml_free(toml_result_t result);
  */
 TOML_EXTERN toml_datum_t toml_get(toml_datum_t table, const char *key);
 
+/**
+ * Same as toml_get(), but key[0..keylen-1] need not be NUL terminated.
+ */
+TOML_EXTERN toml_datum_t toml_get_n(toml_datum_t table, const char *key,
+                                    int keylen);
+
+/**
+ * Same as toml_get_n(), with hash = toml_hash(key, keylen) computed by
+ * the caller, e.g. once for a key that is looked up in many tables.
+ */
+TOML_EXTERN toml_datum_t toml_get_h(toml_datum_t table, const char *key,
+                                    int keylen, uint32_t hash);
+
+/**
+ * Return the hash of key[0..len-1] for toml_get_h().
+ */
+TOML_EXTERN uint32_t toml_hash(const char *key, int len);
+
+/**
+ * A key interned by toml_intern(). A result stores each distinct key
+ * once, and ptr is that copy.
+ */
+typedef struct toml_key_t toml_key_t;
+struct toml_key_t {
+  const char *ptr; // NULL if the result has no such key
+  int len;
+  uint32_t hash;
+};
+
+/**
+ * Return the copy of key[0..len-1] interned in result, which stays valid
+ * until the result is freed. Its ptr is NULL if no key of the result is
+ * spelled so.
+ */
+TOML_EXTERN toml_key_t toml_intern(const toml_result_t *result,
+                                   const char *key, int len);
+
+/**
+ * Same as toml_get_h(), for a key interned in the result that table is
+ * part of. Keys are compared by pointer only.
+ */
+TOML_EXTERN toml_datum_t toml_get_interned(toml_datum_t table,
+                                           toml_key_t key);
+
+/**
+ * Index every table of result with a minimal perfect hash, so that
+ * toml_get() and the other lookups probe a single slot. Tables of a few
+ * keys keep their scan, which is faster. Lazy sections are loaded first.
+ * The tree must not change afterwards; results merged from it with
+ * toml_merge() are not frozen, and subtrees that result shares with
+ * another one (see toml_merge_shared()) are frozen with that one. Return
+ * 0 on success, -1 if out of memory or a section fails to load.
+ */
+TOML_EXTERN int toml_freeze(toml_result_t *result);
+
 /**
  * Locate a value starting from a toml_table. Return the value of the key if
  * found, or a TOML_UNKNOWN otherwise.
  *
  * Note: the multipart-key is separated by DOT, and must not have any escape
- * chars. The maximum length of the multipart_key must not exceed 127 bytes.
+ * chars. For quoted keys or array indices, or to look up the same key
+ * many times, use toml_path_compile().
  */
 TOML_EXTERN toml_datum_t toml_seek(toml_datum_t table,
                                    const char *multipart_key);
 
+/* A compiled key path */
+typedef struct toml_path_t toml_path_t;
+
+/**
+ * Compile a key path for toml_path_eval(). The path is a dotted key as in
+ * TOML, whose parts are bare, "basic" or 'literal' keys, and each part
+ * may be followed by array indices, e.g. servers."web.1".ports[0].
+ * A path may also start with an index, and the empty path is the datum
+ * itself. Returns NULL on a syntax error or if out of memory. Release it
+ * with toml_path_free().
+ */
+TOML_EXTERN toml_path_t *toml_path_compile(const char *path);
+
+/**
+ * Locate the value at path starting from datum. Return the value if
+ * found, or a TOML_UNKNOWN otherwise.
+ */
+TOML_EXTERN toml_datum_t toml_path_eval(toml_datum_t datum,
+                                        const toml_path_t *path);
+
+/**
+ * Release a path returned by toml_path_compile().
+ */
+TOML_EXTERN void toml_path_free(toml_path_t *path);
+
 /**
  * OBSOLETE: use toml_get() instead.
  * Find a key in a toml_table. Return the value of the key if found,
@@ -160,18 +399,106 @@ static inline toml_datum_t toml_table_find(toml_datum_t table,
 TOML_EXTERN toml_result_t toml_merge(const toml_result_t *r1,
                                      const toml_result_t *r2);
 
+/**
+ *  Same as toml_merge(), except that the result shares the tables,
+ *  arrays and strings of r1 that r2 does not touch instead of copying
+ *  them: only the tables and arrays on the paths to the values of r2 are
+ *  copied, along with r2 itself. The memory of r1 is kept until both r1
+ *  and the result are freed, in either order; r1 must not be freed or
+ *  merged from concurrently with the result. If r1 was parsed with
+ *  toml_parse_with(), it is copied as toml_merge() does.
+ */
+TOML_EXTERN toml_result_t toml_merge_shared(const toml_result_t *r1,
+                                            const toml_result_t *r2);
+
+/**
+ *  Merge n layers, each overriding the ones before it, in one pass.
+ *  Returns the same result as merging layers[1], layers[2], ... in turn
+ *  onto layers[0] with toml_merge(), but copies each value that ends up
+ *  in the result once, and none that a later layer replaces. The result
+ *  is allocated with the options of layers[0], and must be freed using
+ *  toml_free().
+ */
+TOML_EXTERN toml_result_t toml_merge_many(const toml_result_t **layers,
+                                          int n);
+
 /**
  *  Check if two results are the same. Dictinary and array orders are
  *  sensitive.
  */
 TOML_EXTERN bool toml_equiv(const toml_result_t *r1, const toml_result_t *r2);
 
+/**
+ *  Receive output from toml_dump() or toml_to_json(): len bytes at buf,
+ *  which is not NUL terminated. Return 0 to continue, or non-zero to stop.
+ */
+typedef int (*toml_writer_t)(void *ctx, const char *buf, int len);
+
+/**
+ *  Write a table as a TOML document, passing the text to writer in
+ *  chunks. Parsing the text gives a result that is toml_equiv() to the
+ *  table; key order is kept. Return 0 on success, -1 if the writer
+ *  stopped or a lazy section failed to load.
+ */
+TOML_EXTERN int toml_dump(toml_datum_t table, toml_writer_t writer,
+                          void *ctx);
+
+/**
+ *  Like toml_dump(), but write the text into buf[], truncated to fit
+ *  and NUL terminated. Return the length of the whole text (as with
+ *  snprintf), or -1 on error.
+ */
+TOML_EXTERN int toml_dump_to_buffer(toml_datum_t table, char *buf,
+                                    int bufsz);
+
+/* Output formats of toml_to_json() */
+enum toml_json_mode_t {
+  TOML_JSON_COMPACT = 0, // plain JSON, no whitespace
+  TOML_JSON_TYPED,       // toml-test encoding, indented
+};
+typedef enum toml_json_mode_t toml_json_mode_t;
+
+/**
+ *  Write a datum as JSON, passing the text to writer in chunks.
+ *
+ *  TOML_JSON_COMPACT writes strings, numbers and booleans as JSON values,
+ *  and dates, times, inf and nan as strings. TOML_JSON_TYPED writes each
+ *  scalar as {"type": ..., "value": "..."}, as in toml-test.
+ *
+ *  Return 0 on success, -1 if the writer stopped or a lazy section failed
+ *  to load.
+ */
+TOML_EXTERN int toml_to_json(toml_datum_t datum, toml_writer_t writer,
+                             void *ctx, toml_json_mode_t mode);
+
 /* Options that override tomlc17 defaults globally */
 typedef struct toml_option_t toml_option_t;
 struct toml_option_t {
   bool check_utf8; // Check all chars are valid utf8; default: false.
   void *(*mem_realloc)(void *ptr, size_t size); // default: realloc()
   void (*mem_free)(void *ptr);                  // default: free()
+  bool use_arena; // Allocate tables and arrays of a result from arenas so
+                  // that toml_free() releases them all at once instead of
+                  // walking the tree; default: false.
+  bool borrow_src; // Point strings and keys without escape chars into the
+                   // source text instead of copying them. Such strings are
+                   // NOT NUL terminated; use str.len and tab.len[]. The
+                   // caller of toml_parse()/toml_parse_n() must keep src[]
+                   // alive until toml_free(); the file parsers keep their
+                   // buffer alive themselves. default: false.
+  bool lazy; // Parse the root table and all table headers up front, but
+             // the tables that headers define, with their sub-tables,
+             // only when toml_get() or toml_seek() first reaches them.
+             // Until then they are empty in toptab; go through
+             // toml_get(). As with borrow_src, src[] must stay alive
+             // until toml_free(). See toml_lazy_error(). default: false.
+
+  // An allocator with a context. If mem_realloc_ex is set, it and
+  // mem_free_ex are called with mem_user instead of mem_realloc and
+  // mem_free. default: NULL.
+  void *(*mem_realloc_ex)(void *user, void *ptr, size_t size);
+  void (*mem_free_ex)(void *user, void *ptr);
+  void *mem_user;
 };
 
 /**
@@ -187,4 +514,73 @@ TOML_EXTERN toml_option_t toml_default_option(void);
  */
 TOML_EXTERN void toml_set_option(toml_option_t opt);
 
+/**
+ * Same as toml_parse_n(), but with the options opt instead of the global
+ * ones. The result keeps a copy of opt, and toml_free() releases it
+ * with the same allocator; toml_merge() allocates with that of r1. Use
+ * this to parse with different allocators or options on different
+ * threads.
+ */
+TOML_EXTERN toml_result_t toml_parse_ex(const char *src, int len,
+                                        const toml_option_t *opt);
+
+/**
+ * Same as toml_context_new(), but with the options opt instead of the
+ * global ones.
+ */
+TOML_EXTERN toml_context_t *toml_context_new_ex(const toml_option_t *opt);
+
+/**
+ * Same as toml_parse_file() and toml_parse_file_ex(), but with the
+ * options opt instead of the global ones.
+ */
+TOML_EXTERN toml_result_t toml_parse_fp_ex(FILE *fp, const toml_option_t *opt);
+TOML_EXTERN toml_result_t toml_parse_path_ex(const char *fname,
+                                             const toml_option_t *opt);
+
+/**
+ * Same as toml_parse_parallel(), but with the options opt instead of the
+ * global ones. The allocator of opt must be thread-safe.
+ */
+TOML_EXTERN toml_result_t toml_parse_parallel_ex(const char *src, int len,
+                                                 int nthreads,
+                                                 const toml_option_t *opt);
+
+/**
+ * Same as toml_sax_parse(), but with the options opt instead of the
+ * global ones.
+ */
+TOML_EXTERN toml_result_t toml_sax_parse_ex(const char *src, int len,
+                                            const toml_sax_handler_t *handler,
+                                            void *ctx,
+                                            const toml_option_t *opt);
+
+/**
+ * Same as toml_parser_new(), but with the options opt instead of the
+ * global ones. The parser keeps a copy of opt.
+ */
+TOML_EXTERN toml_parser_t *toml_parser_new_ex(const toml_option_t *opt);
+
+/**
+ * Same as toml_path_compile(), but allocating with opt instead of the
+ * global options. The path keeps a copy of opt for toml_path_free().
+ */
+TOML_EXTERN toml_path_t *toml_path_compile_ex(const char *path,
+                                              const toml_option_t *opt);
+
+/**
+ * Same as toml_save_binary(), but allocating with opt instead of the
+ * options of result (or the global ones if result has none).
+ */
+TOML_EXTERN int toml_save_binary_ex(const toml_result_t *result,
+                                    const char *path,
+                                    const toml_option_t *opt);
+
+/**
+ * Same as toml_load_binary(), but with the options opt instead of the
+ * global ones. The result keeps a copy of opt, as with toml_parse_ex().
+ */
+TOML_EXTERN toml_result_t toml_load_binary_ex(const char *path,
+                                              const toml_option_t *opt);
+
 #endif // TOMLC17_H
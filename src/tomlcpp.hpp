@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace toml {
@@ -156,22 +157,16 @@ public:
   }
 
   // For tables. Retrieve the value of a composite key from this datum
-  // (which is a table).
+  // (which is a table). Goes through toml_get_n() so that the sections
+  // of a lazy result are loaded on the way.
   std::optional<Datum> get(std::initializer_list<std::string_view> keys) const {
     Datum tab = *this;
     Datum value;
     for (auto key : keys) {
-      value = {};
       if (tab.type != TOML_TABLE) {
         return std::nullopt;
       }
-      for (int i = 0; i < tab.u.tab.size; i++) {
-        if (key ==
-            std::string_view{tab.u.tab.key[i], (size_t)tab.u.tab.len[i]}) {
-          value = tab.u.tab.value[i];
-          break;
-        }
-      }
+      value = toml_get_n(tab, key.data(), (int)key.size());
       tab = value;
     }
     return value;
@@ -232,8 +227,8 @@ static inline Result parse_file_ex(const char *fname) {
   return toml_parse_file_ex(fname);
 }
 
-static inline Result parse(const std::string &s) {
-  return toml_parse(s.data(), s.size());
+static inline Result parse(std::string_view s) {
+  return toml_parse_n(s.data(), s.size());
 }
 
 }; // namespace toml
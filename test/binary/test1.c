@@ -0,0 +1,162 @@
+#include "../../src/tomlc17.c"
+#include "../common.h"
+
+static const char *IMGFILE = "test1.img";
+
+// Save the result of parsing src[], load it back, and compare.
+static void check(const char *name, const char *src, int len) {
+  toml_result_t r1 = toml_parse_n(src, len);
+  if (!r1.ok) {
+    CHECK(-1 == toml_save_binary(&r1, IMGFILE));
+    return;
+  }
+  CHECK(0 == toml_save_binary(&r1, IMGFILE));
+  toml_result_t r2 = toml_load_binary(IMGFILE);
+  if (!r2.ok) {
+    printf("%s: %s\n", name, r2.errmsg);
+    failed();
+  }
+  CHECK(same(r1.toptab, r2.toptab));
+  toml_free(r1);
+  toml_free(r2);
+}
+
+static void test_roundtrip() {
+  printf("Running test_roundtrip...\n");
+  const char *doc = "title = \"caf\\u00e9\"\n"
+                    "nul = \"a\\u0000b\"\n"
+                    "n = -42\n"
+                    "pi = 3.14\n"
+                    "ok = true\n"
+                    "when = 1979-05-27T07:32:00-08:00\n"
+                    "empty = {}\n"
+                    "none = []\n"
+                    "[server]\n"
+                    "ports = [8000, [1, 'x'], {a = 1}]\n"
+                    "[[fruit]]\n"
+                    "name = 'apple'\n"
+                    "[[fruit]]\n"
+                    "name = 'banana'\n";
+  check("roundtrip", doc, strlen(doc));
+
+  toml_result_t r = toml_parse(doc, strlen(doc));
+  CHECK(0 == toml_save_binary(&r, IMGFILE));
+  toml_free(r);
+  r = toml_load_binary(IMGFILE);
+  CHECK(r.ok);
+  CHECK(0 == strcmp(toml_get(r.toptab, "title").u.s, "caf\xc3\xa9"));
+  CHECK(toml_get(r.toptab, "nul").u.str.len == 3);
+  CHECK(toml_seek(r.toptab, "server.ports").u.arr.elem[0].u.int64 == 8000);
+  CHECK(toml_get(r.toptab, "when").u.ts.tz == -480);
+  CHECK(toml_get(r.toptab, "fruit").u.arr.size == 2);
+
+  // Merge and save again from a loaded image.
+  toml_result_t r2 = toml_merge(&r, &r);
+  CHECK(r2.ok && toml_get(r2.toptab, "fruit").u.arr.size == 4);
+  CHECK(0 == toml_save_binary(&r2, IMGFILE));
+  toml_result_t r3 = toml_load_binary(IMGFILE);
+  CHECK(r3.ok && same(r2.toptab, r3.toptab));
+  toml_free(r);
+  toml_free(r2);
+  toml_free(r3);
+}
+
+// A big table is looked up through its index, which is saved too. Two
+// images loaded at once cannot both be where they were meant to be, so
+// one of them is relocated.
+static void test_relocate() {
+  printf("Running test_relocate...\n");
+  static char doc[100000];
+  int len = 0;
+  for (int i = 0; i < 1000; i++) {
+    len += sprintf(doc + len, "k%d = 'v%d'\n", i, i);
+  }
+  toml_result_t r1 = toml_parse(doc, len);
+  CHECK(r1.ok && tab_meta(&r1.toptab)->nslot > 0);
+  CHECK(0 == toml_save_binary(&r1, IMGFILE));
+  toml_result_t r2 = toml_load_binary(IMGFILE);
+  toml_result_t r3 = toml_load_binary(IMGFILE);
+  CHECK(r2.ok && r3.ok);
+  CHECK(r2.toptab.u.tab.key != r3.toptab.u.tab.key);
+  CHECK(same(r1.toptab, r2.toptab) && same(r1.toptab, r3.toptab));
+  CHECK(0 == strcmp(toml_get(r3.toptab, "k777").u.s, "v777"));
+  CHECK(toml_get(r3.toptab, "k1000").type == TOML_UNKNOWN);
+  toml_free(r1);
+  toml_free(r2);
+  toml_free(r3);
+}
+
+// Lazy sections are parsed before they are saved.
+static void test_lazy() {
+  printf("Running test_lazy...\n");
+  const char *doc = "[a]\nx = 1\n[b]\ny = 2\n";
+  toml_option_t opt = toml_default_option();
+  opt.lazy = true;
+  toml_result_t r = toml_parse_ex(doc, strlen(doc), &opt);
+  CHECK(r.ok);
+  CHECK(0 == toml_save_binary(&r, IMGFILE));
+  toml_free(r);
+  r = toml_load_binary(IMGFILE);
+  CHECK(r.ok && toml_seek(r.toptab, "b.y").u.int64 == 2);
+  toml_free(r);
+
+  doc = "[a]\nx = 1\n[b]\ny = 2\ny = 3\n";
+  r = toml_parse_ex(doc, strlen(doc), &opt);
+  CHECK(r.ok);
+  CHECK(-1 == toml_save_binary(&r, IMGFILE));
+  toml_free(r);
+}
+
+static void test_errors() {
+  printf("Running test_errors...\n");
+  toml_result_t r = toml_load_binary("no-such-file.img");
+  CHECK(!r.ok && 0 == strncmp(r.errmsg, "fopen: ", 7));
+  r = toml_load_binary("Makefile");
+  CHECK(!r.ok && 0 == strncmp(r.errmsg, "not a tomlc17 image", 19));
+
+  // A truncated image is caught.
+  const char *doc = "a = 'hello'\n";
+  r = toml_parse(doc, strlen(doc));
+  CHECK(0 == toml_save_binary(&r, IMGFILE));
+  toml_free(r);
+  FILE *fp = fopen(IMGFILE, "rb");
+  static char buf[4096];
+  int len = fread(buf, 1, sizeof(buf), fp);
+  fclose(fp);
+  fp = fopen(IMGFILE, "wb");
+  fwrite(buf, 1, len - 1, fp);
+  fclose(fp);
+  r = toml_load_binary(IMGFILE);
+  CHECK(!r.ok && 0 == strncmp(r.errmsg, "truncated image", 15));
+
+  // So is another platform.
+  ((imghdr_t *)buf)->datumsz++;
+  fp = fopen(IMGFILE, "wb");
+  fwrite(buf, 1, len, fp);
+  fclose(fp);
+  r = toml_load_binary(IMGFILE);
+  CHECK(!r.ok && 0 == strncmp(r.errmsg, "image was written on another", 28));
+  CHECK(-1 == toml_save_binary(&r, IMGFILE));
+}
+
+int main(int argc, char **argv) {
+  test_roundtrip();
+  test_relocate();
+  test_lazy();
+  test_errors();
+
+  printf("Checking %d files...\n", argc - 1);
+  check_files(argc, argv, check);
+
+  // Again, from results allocated from arenas.
+  printf("Using arena...\n");
+  toml_option_t opt = toml_default_option();
+  opt.use_arena = true;
+  toml_set_option(opt);
+  test_roundtrip();
+  test_relocate();
+
+  remove(IMGFILE);
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ *  Helpers shared by the tests. Include after ../../src/tomlc17.c.
+ */
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+static void failed() {
+  printf("FAILED\n");
+  exit(1);
+}
+
+#define CHECK(x)                                                               \
+  if (x)                                                                       \
+    ;                                                                          \
+  else                                                                         \
+    failed()
+
+// Like toml_equiv(), except that floats must have the same bits, so that
+// a nan equals itself. Lazy sections are loaded as they are reached, and
+// keys and strings need not be NUL terminated.
+static inline bool same(toml_datum_t a, toml_datum_t b) {
+  const char *reason;
+  if (lazy_load(&a, &reason) || lazy_load(&b, &reason) || a.type != b.type) {
+    return false;
+  }
+  switch (a.type) {
+  case TOML_FP64:
+    return 0 == memcmp(&a.u.fp64, &b.u.fp64, sizeof(double));
+  case TOML_ARRAY:
+    if (a.u.arr.size != b.u.arr.size) {
+      return false;
+    }
+    for (int i = 0; i < a.u.arr.size; i++) {
+      if (!same(a.u.arr.elem[i], b.u.arr.elem[i])) {
+        return false;
+      }
+    }
+    return true;
+  case TOML_TABLE:
+    if (a.u.tab.size != b.u.tab.size) {
+      return false;
+    }
+    for (int i = 0; i < a.u.tab.size; i++) {
+      if (a.u.tab.len[i] != b.u.tab.len[i] ||
+          memcmp(a.u.tab.key[i], b.u.tab.key[i], a.u.tab.len[i]) ||
+          !same(a.u.tab.value[i], b.u.tab.value[i])) {
+        return false;
+      }
+    }
+    return true;
+  default: {
+    toml_result_t ra = {.ok = true, .toptab = a};
+    toml_result_t rb = {.ok = true, .toptab = b};
+    return toml_equiv(&ra, &rb);
+  }
+  }
+}
+
+// Read the file fname into a buffer that the next call reuses, and set
+// *len to its length. The file must fit in the buffer.
+static inline const char *read_file(const char *fname, int *len) {
+  static char src[1 << 20];
+  FILE *fp = fopen(fname, "rb");
+  CHECK(fp);
+  *len = fread(src, 1, sizeof(src), fp);
+  fclose(fp);
+  CHECK(*len < (int)sizeof(src));
+  return src;
+}
+
+// Call check(fname, src, len) on each file fname in argv[1..argc).
+static inline void check_files(int argc, char **argv,
+                               void (*check)(const char *name,
+                                             const char *src, int len)) {
+  for (int i = 1; i < argc; i++) {
+    int len;
+    const char *src = read_file(argv[i], &len);
+    check(argv[i], src, len);
+  }
+}
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,134 @@
+#include "../../src/tomlc17.c"
+#include "../common.h"
+
+static long ncall = 0;
+
+static void *counting_realloc(void *ptr, size_t size) {
+  ncall++;
+  return realloc(ptr, size);
+}
+
+// A parse with a context must give the same result as toml_parse_n().
+static void check(toml_context_t *ctx, const char *name, const char *src,
+                  int len) {
+  toml_result_t r1 = toml_parse_n(src, len);
+  toml_result_t r2 = toml_parse_with(ctx, src, len);
+  if (r1.ok != r2.ok || strcmp(r1.errmsg, r2.errmsg)) {
+    printf("%s: '%s' vs '%s'\n", name, r1.errmsg, r2.errmsg);
+    failed();
+  }
+  CHECK(!r1.ok || same(r1.toptab, r2.toptab));
+  toml_free(r1);
+  toml_free(r2); // no-op
+}
+
+static const char *doc = "title = 'x'\n"
+                         "[server]\n"
+                         "ip = \"10.0.0.1\"\n"
+                         "ports = [8000, 8001, 8002]\n"
+                         "[[fruit]]\n"
+                         "name = 'apple'\n"
+                         "color.red = 1\n"
+                         "[[fruit]]\n"
+                         "name = 'banana'\n"
+                         "when = 1979-05-27T07:32:00Z\n";
+
+// Results stay valid until the context is reset.
+static void test_results() {
+  printf("Running test_results...\n");
+  toml_context_t *ctx = toml_context_new();
+  CHECK(ctx);
+  toml_result_t r[3];
+  for (int i = 0; i < 3; i++) {
+    r[i] = toml_parse_with(ctx, doc, strlen(doc));
+    CHECK(r[i].ok);
+  }
+  toml_result_t r3 = toml_parse_n(doc, strlen(doc));
+  for (int i = 0; i < 3; i++) {
+    CHECK(same(r[i].toptab, r3.toptab));
+  }
+  toml_result_t r4 = toml_merge(&r[0], &r[1]);
+  CHECK(r4.ok && toml_get(r4.toptab, "fruit").u.arr.size == 4);
+  toml_free(r3);
+  toml_free(r4);
+
+  const char *bad = "a = 1\na = 2\n";
+  toml_result_t r5 = toml_parse_with(ctx, bad, strlen(bad));
+  CHECK(!r5.ok && 0 == strcmp(r5.errmsg, "(line 2) duplicate key"));
+  CHECK(same(r[2].toptab, toml_parse_with(ctx, doc, strlen(doc)).toptab));
+  toml_context_free(ctx);
+
+  // A NULL context reports out of memory.
+  r5 = toml_parse_with(NULL, doc, strlen(doc));
+  CHECK(!r5.ok && 0 == strcmp(r5.errmsg, "out of memory"));
+  toml_context_reset(NULL);
+  toml_context_free(NULL);
+}
+
+// Once the context has seen its biggest load, parsing does not allocate.
+static void test_reuse() {
+  printf("Running test_reuse...\n");
+  toml_option_t save = toml_option;
+  toml_option.mem_realloc = counting_realloc;
+
+  // A big document that spills from the pool and the first arena chunk.
+  int max = 200000;
+  char *big = malloc(max);
+  CHECK(big);
+  int len = 0;
+  for (int i = 0; len < max - 1000; i++) {
+    len += sprintf(big + len, "[t%d]\nk = \"v\\n%d\"\nv = [1, 2, 3]\n", i, i);
+  }
+
+  toml_context_t *ctx = toml_context_new();
+  CHECK(ctx);
+  for (int round = 0; round < 3; round++) {
+    ncall = 0;
+    for (int i = 0; i < 10; i++) {
+      CHECK(toml_parse_with(ctx, doc, strlen(doc)).ok);
+    }
+    CHECK(toml_parse_with(ctx, big, len).ok);
+    toml_context_reset(ctx);
+    CHECK(round == 0 ? ncall > 0 : ncall == 0);
+  }
+
+  // A smaller load fits too.
+  ncall = 0;
+  CHECK(toml_parse_with(ctx, doc, strlen(doc)).ok);
+  toml_context_reset(ctx);
+  CHECK(ncall == 0);
+  toml_context_free(ctx);
+  free(big);
+  toml_option = save;
+}
+
+static void check_file(toml_context_t *ctx, const char *fname) {
+  int len;
+  const char *src = read_file(fname, &len);
+  check(ctx, fname, src, len);
+  toml_context_reset(ctx);
+}
+
+int main(int argc, char **argv) {
+  test_results();
+  test_reuse();
+
+  printf("Checking %d files...\n", argc - 1);
+  toml_context_t *ctx = toml_context_new();
+  CHECK(ctx);
+  for (int i = 1; i < argc; i++) {
+    check_file(ctx, argv[i]);
+  }
+  toml_context_free(ctx);
+
+  // Again, with strings borrowed from the source text.
+  printf("Using borrow_src...\n");
+  toml_option_t opt = toml_default_option();
+  opt.borrow_src = true;
+  toml_set_option(opt);
+  test_results();
+  test_reuse();
+
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -116,6 +116,58 @@ static void test_array() {
   auto value = *(*toptab.get("array")).as_intvec();
   CHECK(value == (std::vector<int64_t>{1, 2, 3}));
 }
+static void test_slice() {
+  printf("test slice ...\n");
+  // parse a prefix of a larger buffer; the bound cuts the number short.
+  const char doc[] = {'a', ' ', '=', ' ', '1', '2', '3', '4'};
+  auto result = toml_parse_n(doc, 5);
+  CHECK(result.ok);
+  Datum toptab{result.toptab};
+  CHECK(*(*toptab.get("a")).as_int() == 1);
+  toml_free(result);
+
+  auto r2 = parse(std::string_view("b = true\nc = 1", 8));
+  CHECK(r2.ok());
+  CHECK(*r2.get({"b"})->as_bool() == true);
+  CHECK(!r2.get({"c"})->as_int());
+}
+static void test_borrow() {
+  printf("test borrow ...\n");
+  toml_option_t opt = toml_default_option();
+  opt.borrow_src = true;
+  toml_set_option(opt);
+  const char doc[] = "a = 'plain'\nb = \"esc\\taped\"\n[t]\nc = 1";
+  auto result = toml_parse_n(doc, sizeof(doc) - 1);
+  toml_set_option(toml_default_option());
+  CHECK(result.ok);
+  Datum toptab{result.toptab};
+  // escape-free strings and keys point into doc[]
+  auto a = *(*toptab.get("a")).as_str();
+  CHECK(a == "plain" && a.data() == doc + 5);
+  CHECK(result.toptab.u.tab.key[0] == doc);
+  // escaped strings are materialized
+  auto b = *(*toptab.get("b")).as_str();
+  CHECK(b == "esc\taped");
+  CHECK(!(doc <= b.data() && b.data() < doc + sizeof(doc)));
+  CHECK(*(*toptab.get({"t", "c"})).as_int() == 1);
+  CHECK(toml_seek(result.toptab, "t.c").u.int64 == 1);
+  toml_free(result);
+}
+static void test_lazy() {
+  printf("test lazy ...\n");
+  toml_option_t opt = toml_default_option();
+  opt.lazy = true;
+  toml_set_option(opt);
+  const char doc[] = "a = 1\n[t.u]\nb = 2\n[[v]]\nc = 3\n[[v]]\nc = 4\n";
+  Result result = toml_parse_n(doc, sizeof(doc) - 1);
+  toml_set_option(toml_default_option());
+  CHECK(result.ok());
+  // get() loads the sections on the way
+  CHECK(*result.get({"t", "u", "b"})->as_int() == 2);
+  auto v = *result.get({"v"})->as_vector();
+  CHECK(v.size() == 2 && *(*v[1].get("c")).as_int() == 4);
+  CHECK(!result.get({"x", "y"}));
+}
 
 int main() {
   test_string();
@@ -127,5 +179,8 @@ int main() {
   test_datetime();
   test_datetimetz();
   test_array();
+  test_slice();
+  test_borrow();
+  test_lazy();
   return 0;
 }
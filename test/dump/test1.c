@@ -0,0 +1,264 @@
+#include "../../src/tomlc17.c"
+#include <locale.h>
+#include "../common.h"
+
+// Collect the output of toml_dump() in a growing buffer.
+typedef struct text_t text_t;
+struct text_t {
+  char *ptr;
+  int len;
+  int ncall;
+  int limit; // stop after this many bytes
+};
+
+static int text_write(void *ctx, const char *buf, int len) {
+  text_t *t = (text_t *)ctx;
+  t->ncall++;
+  if (t->len + len > t->limit) {
+    return -1;
+  }
+  t->ptr = realloc(t->ptr, t->len + len + 1);
+  CHECK(t->ptr);
+  memcpy(t->ptr + t->len, buf, len);
+  t->len += len;
+  t->ptr[t->len] = 0;
+  return 0;
+}
+
+// Dump a document and parse the output again; the result must be the
+// same. A document that does not parse is skipped; with the lazy option,
+// the dump fails when a section does not parse.
+static void check(const char *name, const char *src, int len) {
+  toml_result_t r1 = toml_parse_n(src, len);
+  text_t t = {0, 0, 0, INT_MAX};
+  if (!r1.ok || toml_dump(r1.toptab, text_write, &t)) {
+    CHECK(!r1.ok || toml_lazy_error(&r1));
+    free(t.ptr);
+    toml_free(r1);
+    return;
+  }
+  toml_result_t r2 = toml_parse_n(t.ptr ? t.ptr : "", t.len);
+  if (!r2.ok || !same(r1.toptab, r2.toptab)) {
+    printf("%s: %s\n%s\n", name, r2.errmsg, t.ptr);
+    failed();
+  }
+
+  // Same text through toml_dump_to_buffer().
+  char *buf = malloc(t.len + 1);
+  CHECK(buf);
+  CHECK(t.len == toml_dump_to_buffer(r1.toptab, buf, t.len + 1));
+  CHECK(t.len == 0 || (0 == memcmp(buf, t.ptr, t.len) && buf[t.len] == 0));
+  free(buf);
+  free(t.ptr);
+  toml_free(r1);
+  toml_free(r2);
+}
+
+// Dump a document and compare the output with the expected text.
+static void expect(const char *src, const char *want) {
+  toml_result_t r = toml_parse(src, strlen(src));
+  CHECK(r.ok);
+  char buf[1000];
+  int n = toml_dump_to_buffer(r.toptab, buf, sizeof(buf));
+  if (n < 0 || strcmp(buf, want)) {
+    printf("got:\n%s\nwant:\n%s\n", buf, want);
+    failed();
+  }
+  toml_free(r);
+  check(src, src, strlen(src));
+}
+
+static void test_layout() {
+  printf("Running test_layout...\n");
+  expect("a = 1\n[b]\nc = 2\n", "a = 1\n\n[b]\nc = 2\n");
+  // A table before a key/value is written with dotted keys.
+  expect("[b]\nc = 2\n[b.d]\ne = 3\n[b.f]\n",
+         "[b]\nc = 2\n\n[b.d]\ne = 3\n\n[b.f]\n");
+  expect("x.y.z = 1\nx.w = {}\nv = 2\n", "x.y.z = 1\nx.w = {}\nv = 2\n");
+  expect("t = {}\nu.v = {a = 1}\nw = 1\n", "t = {}\nu.v = { a = 1 }\nw = 1\n");
+  // A table of sections has no header of its own.
+  expect("[a.b.c]\nd = 1\n", "[a.b.c]\nd = 1\n");
+  expect("[[a]]\nb = 1\n[[a]]\n[a.c]\n", "[[a]]\nb = 1\n\n[[a]]\n\n[a.c]\n");
+  expect("a = [{b = 1}, {}]\n", "a = [{ b = 1 }, {}]\n");
+  // Before a key/value, an array of tables is written inline, and a
+  // table with dotted keys.
+  expect("[[t.b]]\nc = 1\n[t]\nd = 2\n", "[t]\nb = [{ c = 1 }]\nd = 2\n");
+  expect("[t.u.v]\nc = 1\n[t]\nd = 2\n", "[t]\nu.v.c = 1\nd = 2\n");
+  expect("a = 1\n[[b]]\nc = 1\n[b.d]\ne = 2\n",
+         "a = 1\n\n[[b]]\nc = 1\n\n[b.d]\ne = 2\n");
+  expect("'a b' = 1\n\"\" = 2\n'\xc3\xa9' = 3\n",
+         "\"a b\" = 1\n\"\" = 2\n\"\xc3\xa9\" = 3\n");
+}
+
+static void test_values() {
+  printf("Running test_values...\n");
+  expect("a = \"x\\\"\\\\\\t\\u0001\\u007f\"\n",
+         "a = \"x\\\"\\\\\\t\\u0001\\u007F\"\n");
+  expect("a = [0, -1, 9223372036854775807, -9223372036854775808]\n",
+         "a = [0, -1, 9223372036854775807, -9223372036854775808]\n");
+  expect("a = [1.0, 0.1, -0.0, 1e100, 2.2250738585072014e-308]\n",
+         "a = [1.0, 0.1, -0.0, 1e+100, 2.2250738585072014e-308]\n");
+  expect("a = [inf, -inf, nan]\n", "a = [inf, -inf, nan]\n");
+  expect("a = [true, false, [], [[]]]\n", "a = [true, false, [], [[]]]\n");
+  expect("a = 1979-05-27\nb = 07:32:00.250\nc = 1979-05-27T00:32:00.999999\n"
+         "d = 1979-05-27T07:32:00Z\ne = 1979-05-27T00:32:00-07:30\n",
+         "a = 1979-05-27\nb = 07:32:00.25\nc = 1979-05-27T00:32:00.999999\n"
+         "d = 1979-05-27T07:32:00Z\ne = 1979-05-27T00:32:00-07:30\n");
+
+  // Shortest form that reads back.
+  char buf[32];
+  static const double fp[] = {0.3, 2.0 / 3, 1e23, 123456789012345680.0,
+                              DBL_MAX, DBL_MIN, 0.1 + 0.2};
+  for (int i = 0; i < (int)(sizeof(fp) / sizeof(fp[0])); i++) {
+    int n = format_float(fp[i], buf);
+    buf[n] = 0;
+    CHECK(strtod(buf, 0) == fp[i]);
+  }
+  CHECK(format_float(0.3, buf) == 3 && 0 == memcmp(buf, "0.3", 3));
+  CHECK(format_float(1e23, buf) == 5 && 0 == memcmp(buf, "1e+23", 5));
+  CHECK(format_float(5e-324, buf) == 6 && 0 == memcmp(buf, "5e-324", 6));
+
+  // No shorter "%.*e" reads back, over doubles of all exponents.
+  uint64_t seed = 88172645463325252ull;
+  for (int i = 0; i < 20000; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    double x;
+    memcpy(&x, &seed, sizeof(x));
+    if (!isfinite(x)) {
+      continue;
+    }
+    int n = format_float(x, buf);
+    buf[n] = 0;
+    CHECK(strtod(buf, 0) == x);
+    char dig[17], tmp[40];
+    int e10, nd = shortest_digits(fabs(x), dig, &e10);
+    if (nd > 1) {
+      snprintf(tmp, sizeof(tmp), "%.*e", nd - 2, x);
+      CHECK(strtod(tmp, 0) != x);
+    }
+  }
+}
+
+static void test_writer() {
+  printf("Running test_writer...\n");
+  // Output larger than the buffer comes in several chunks.
+  char *src = malloc(100000);
+  CHECK(src);
+  int len = 0;
+  for (int i = 0; i < 2000; i++) {
+    len += sprintf(src + len, "[t%d]\nname = 'section %d'\n", i, i);
+  }
+  check("big", src, len);
+  toml_result_t r = toml_parse(src, len);
+  CHECK(r.ok);
+  text_t t = {0, 0, 0, INT_MAX};
+  CHECK(0 == toml_dump(r.toptab, text_write, &t));
+  CHECK(t.ncall > 1);
+  int total = t.len;
+  free(t.ptr);
+
+  // The dump stops when the writer does.
+  t = (text_t){0, 0, 0, 5000};
+  CHECK(-1 == toml_dump(r.toptab, text_write, &t));
+  CHECK(t.len < 5000);
+  free(t.ptr);
+
+  // A small buffer gets the head of the text.
+  char buf[8];
+  CHECK(total == toml_dump_to_buffer(r.toptab, buf, sizeof(buf)));
+  CHECK(0 == strcmp(buf, "[t0]\nna"));
+  CHECK(total == toml_dump_to_buffer(r.toptab, NULL, 0));
+  toml_free(r);
+  free(src);
+
+  // Only a table can be dumped.
+  toml_datum_t d = {.type = TOML_INT64};
+  CHECK(-1 == toml_dump_to_buffer(d, buf, sizeof(buf)));
+}
+
+// Convert a document to JSON and compare with the expected text.
+static void expect_json(const char *src, toml_json_mode_t mode,
+                        const char *want) {
+  toml_result_t r = toml_parse(src, strlen(src));
+  CHECK(r.ok);
+  text_t t = {0, 0, 0, INT_MAX};
+  CHECK(0 == toml_to_json(r.toptab, text_write, &t, mode));
+  if (strcmp(t.ptr, want)) {
+    printf("got:\n%s\nwant:\n%s\n", t.ptr, want);
+    failed();
+  }
+  free(t.ptr);
+  toml_free(r);
+}
+
+static void test_json() {
+  printf("Running test_json...\n");
+  expect_json("", TOML_JSON_COMPACT, "{}");
+  expect_json("a = 1\nb = \"x\\\"\\u0001\"\nc = [true, 1.5, -0.0]\n",
+              TOML_JSON_COMPACT,
+              "{\"a\":1,\"b\":\"x\\\"\\u0001\",\"c\":[true,1.5,-0.0]}");
+  expect_json("a = [inf, nan]\nb = 1979-05-27T07:32:00Z\n[t]\n[[u]]\n",
+              TOML_JSON_COMPACT,
+              "{\"a\":[\"inf\",\"nan\"],\"b\":\"1979-05-27T07:32:00Z\","
+              "\"t\":{},\"u\":[{}]}");
+  expect_json("a = 1\n[t]\nb = [{c = 07:32:00}]\n", TOML_JSON_TYPED,
+              "{\n"
+              "  \"a\": {\"type\": \"integer\", \"value\": \"1\"},\n"
+              "  \"t\": {\n"
+              "    \"b\": [{\n"
+              "      \"c\": {\"type\": \"time-local\", "
+              "\"value\": \"07:32:00\"}\n"
+              "    }]\n"
+              "  }\n"
+              "}");
+
+  // Any datum converts, not only tables.
+  toml_datum_t d = {.type = TOML_INT64, .u.int64 = 42};
+  text_t t = {0, 0, 0, INT_MAX};
+  CHECK(0 == toml_to_json(d, text_write, &t, TOML_JSON_COMPACT));
+  CHECK(0 == strcmp(t.ptr, "42"));
+  free(t.ptr);
+}
+
+// Floats are written with a '.' whatever the locale.
+static void test_locale() {
+  printf("Running test_locale...\n");
+  static const char *const name[] = {"de_DE.UTF-8", "de_DE.utf8",
+                                     "fr_FR.UTF-8", "fr_FR.utf8", "de_DE",
+                                     "fr_FR"};
+  const char *loc = NULL;
+  for (int i = 0; !loc && i < (int)(sizeof(name) / sizeof(name[0])); i++) {
+    loc = setlocale(LC_NUMERIC, name[i]);
+  }
+  if (!loc) {
+    printf("  no locale with a comma radix; checking in the C locale\n");
+  }
+  expect("a = [1.5, 0.25, -2.0, 1e100, 6.626e-34]\n",
+         "a = [1.5, 0.25, -2.0, 1e+100, 6.626e-34]\n");
+  expect_json("a = [1.5, 1e-06]\n", TOML_JSON_COMPACT,
+              "{\"a\":[1.5,1e-06]}");
+  setlocale(LC_NUMERIC, "C");
+}
+
+int main(int argc, char **argv) {
+  test_layout();
+  test_values();
+  test_writer();
+  test_json();
+  test_locale();
+
+  printf("Checking %d files...\n", argc - 1);
+  check_files(argc, argv, check);
+
+  // Again, with lazy sections.
+  printf("Using lazy...\n");
+  toml_option_t opt = toml_default_option();
+  opt.lazy = true;
+  toml_set_option(opt);
+  check_files(argc, argv, check);
+
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -0,0 +1,205 @@
+#include "../../src/tomlc17.c"
+#include "../common.h"
+
+static const char *IMGFILE = "test1.img";
+
+static bool is_frozen(toml_datum_t tab) {
+  if (tab.u.tab.size < TAB_INDEX_MIN) {
+    return true; // kept unindexed
+  }
+  tabmeta_t *meta = tab_meta(&tab);
+  return meta && meta->disp && meta->nslot == tab.u.tab.size;
+}
+
+// Each table under d must be frozen and find each of its keys, and no
+// other key.
+static void check_tree(toml_datum_t d) {
+  if (d.type == TOML_ARRAY) {
+    for (int i = 0; i < d.u.arr.size; i++) {
+      check_tree(d.u.arr.elem[i]);
+    }
+  }
+  if (d.type != TOML_TABLE) {
+    return;
+  }
+  CHECK(is_frozen(d));
+  for (int i = 0; i < d.u.tab.size; i++) {
+    const char *key = d.u.tab.key[i];
+    int len = d.u.tab.len[i];
+    CHECK(tab_find(&d, (span_t){key, len}) == i);
+    // A copy of the key, so that it is not found by pointer.
+    char buf[200];
+    if (len + 1 < (int)sizeof(buf)) {
+      memcpy(buf, key, len);
+      buf[len] = 'x';
+      CHECK(tab_find(&d, (span_t){buf, len}) == i);
+      CHECK(toml_get_n(d, buf, len + 1).type == TOML_UNKNOWN ||
+            tab_find(&d, (span_t){buf, len + 1}) >= 0);
+    }
+    toml_datum_t v = toml_get_h(d, key, len, toml_hash(key, len));
+    CHECK(v.type);
+    check_tree(v);
+  }
+}
+
+// Freeze r and check it, if it parsed, then free it.
+static void check(toml_result_t r) {
+  if (r.ok) {
+    if (toml_freeze(&r)) {
+      // A lazy section that fails to load.
+      CHECK(toml_lazy_error(&r));
+    } else {
+      check_tree(r.toptab);
+      CHECK(0 == toml_freeze(&r));
+    }
+  }
+  toml_free(r);
+}
+
+static toml_result_t parse_lazy_n(const char *src, int len) {
+  toml_option_t opt = toml_default_option();
+  opt.lazy = true;
+  return toml_parse_ex(src, len, &opt);
+}
+
+static void check_all(const char *src, int len) {
+  check(toml_parse_n(src, len));
+  check(parse_lazy_n(src, len));
+  check(toml_parse_parallel(src, len, 3));
+
+  // Freeze a loaded image, and load a frozen one.
+  toml_result_t r = toml_parse_n(src, len);
+  if (r.ok) {
+    CHECK(0 == toml_save_binary(&r, IMGFILE));
+    check(toml_load_binary(IMGFILE));
+    CHECK(0 == toml_freeze(&r));
+    CHECK(0 == toml_save_binary(&r, IMGFILE));
+    toml_result_t r2 = toml_load_binary(IMGFILE);
+    CHECK(r2.ok);
+    check_tree(r2.toptab);
+    toml_free(r2);
+  }
+  toml_free(r);
+}
+
+// Tables of every width up to 2000 keys.
+static void test_widths() {
+  printf("Running test_widths...\n");
+  static char doc[100000];
+  for (int n = 1; n <= 2000; n = (n < 40 ? n + 1 : n * 3 / 2)) {
+    int len = 0;
+    for (int i = 0; i < n; i++) {
+      len += sprintf(doc + len, "key%d = %d\n", i * 7, i);
+    }
+    toml_result_t r = toml_parse(doc, len);
+    CHECK(r.ok && 0 == toml_freeze(&r));
+    CHECK(is_frozen(r.toptab));
+    char key[32];
+    for (int i = 0; i < n * 7; i++) {
+      sprintf(key, "key%d", i);
+      toml_datum_t v = toml_get(r.toptab, key);
+      CHECK(i % 7 ? v.type == TOML_UNKNOWN : v.u.int64 == i / 7);
+    }
+    check_tree(r.toptab);
+    toml_free(r);
+  }
+}
+
+static void test_values() {
+  printf("Running test_values...\n");
+  const char *doc = "title = 'x'\n"
+                    "arr = [{a = 1}, {b = 2, c = [{d = 3}]}]\n"
+                    "[server.alpha]\n"
+                    "ip = '10.0.0.1'\n"
+                    "[[fruit]]\n"
+                    "name = 'apple'\n"
+                    "[fruit.color]\n"
+                    "red = 1\n";
+  check_all(doc, strlen(doc));
+
+  toml_result_t r = parse_lazy_n(doc, strlen(doc));
+  CHECK(r.ok && 0 == toml_freeze(&r));
+  CHECK(0 == strcmp(toml_seek(r.toptab, "server.alpha.ip").u.s, "10.0.0.1"));
+  toml_datum_t fruit = toml_get(r.toptab, "fruit");
+  CHECK(toml_seek(fruit.u.arr.elem[0], "color.red").u.int64 == 1);
+  toml_datum_t arr = toml_get(r.toptab, "arr");
+  CHECK(toml_get(arr.u.arr.elem[1], "c").u.arr.size == 1);
+  toml_key_t k = toml_intern(&r, "b", 1);
+  CHECK(toml_get_interned(arr.u.arr.elem[1], k).u.int64 == 2);
+  CHECK(toml_get_interned(arr.u.arr.elem[0], k).type == TOML_UNKNOWN);
+  toml_path_t *path = toml_path_compile("arr[1].c[0].d");
+  CHECK(toml_path_eval(r.toptab, path).u.int64 == 3);
+  toml_path_free(path);
+
+  // A merge of frozen results is a new tree, which is not frozen.
+  toml_result_t r2 = toml_parse("title = 'y'", 11);
+  toml_result_t r3 = toml_merge(&r, &r2);
+  CHECK(r3.ok && !tab_meta(&r3.toptab)->disp);
+  CHECK(0 == strcmp(toml_get(r3.toptab, "title").u.s, "y"));
+  toml_free(r2);
+  toml_free(r3);
+  toml_free(r);
+
+  // A section that fails to load fails the freeze.
+  doc = "[a]\nx = 1\n[b]\ny = 2\ny = 3\n";
+  r = parse_lazy_n(doc, strlen(doc));
+  CHECK(r.ok && -1 == toml_freeze(&r));
+  toml_free(r);
+}
+
+// Keys with equal hashes cannot be apart in a perfect hash; their table
+// keeps its index.
+static void test_collision() {
+  printf("Running test_collision...\n");
+  CHECK(hash_key("costarring", 10) == hash_key("liquid", 6));
+  static char doc[2000];
+  int len = sprintf(doc, "[t]\ncostarring = 1\nliquid = 2\nother = 3\n");
+  for (int i = 0; i < TAB_INDEX_MIN; i++) {
+    len += sprintf(doc + len, "k%d = 0\n", i);
+  }
+  len += sprintf(doc + len, "[u]\ndeclinate = 4\n");
+  for (int i = 0; i < TAB_INDEX_MIN; i++) {
+    len += sprintf(doc + len, "k%d = 0\n", i);
+  }
+  toml_result_t r = toml_parse(doc, len);
+  CHECK(r.ok && 0 == toml_freeze(&r));
+  toml_datum_t t = toml_get(r.toptab, "t");
+  CHECK(!is_frozen(t) && tab_meta(&t)->nslot > t.u.tab.size);
+  CHECK(is_frozen(toml_get(r.toptab, "u")));
+  CHECK(toml_get(t, "costarring").u.int64 == 1);
+  CHECK(toml_get(t, "liquid").u.int64 == 2);
+  CHECK(toml_get(t, "other").u.int64 == 3);
+  CHECK(toml_seek(r.toptab, "u.macallums").type == TOML_UNKNOWN);
+  CHECK(toml_seek(r.toptab, "u.declinate").u.int64 == 4);
+  toml_free(r);
+}
+
+static void check_file(const char *fname) {
+  int len;
+  const char *src = read_file(fname, &len);
+  check_all(src, len);
+}
+
+int main(int argc, char **argv) {
+  test_widths();
+  test_values();
+  test_collision();
+
+  printf("Checking %d files...\n", argc - 1);
+  for (int i = 1; i < argc; i++) {
+    check_file(argv[i]);
+  }
+
+  // Again, with tables and arrays allocated from arenas.
+  printf("Using arena...\n");
+  toml_option_t opt = toml_default_option();
+  opt.use_arena = true;
+  toml_set_option(opt);
+  test_widths();
+  test_values();
+  test_collision();
+
+  remove(IMGFILE);
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -0,0 +1,204 @@
+#include "../../src/tomlc17.c"
+#include "../common.h"
+
+static const char *IMGFILE = "test1.img";
+
+// Each key under d must be the copy interned in r, and
+// toml_get_interned() must find it.
+static void check_tree(const toml_result_t *r, toml_datum_t d) {
+  if (d.type == TOML_ARRAY) {
+    for (int i = 0; i < d.u.arr.size; i++) {
+      check_tree(r, d.u.arr.elem[i]);
+    }
+  }
+  if (d.type != TOML_TABLE) {
+    return;
+  }
+  for (int i = 0; i < d.u.tab.size; i++) {
+    toml_key_t k = toml_intern(r, d.u.tab.key[i], d.u.tab.len[i]);
+    CHECK(k.ptr == d.u.tab.key[i] && k.len == d.u.tab.len[i]);
+    CHECK(k.hash == toml_hash(d.u.tab.key[i], d.u.tab.len[i]));
+    toml_datum_t v1 = toml_get_n(d, d.u.tab.key[i], d.u.tab.len[i]);
+    toml_datum_t v2 = toml_get_interned(d, k);
+    if (!v1.type) {
+      // A lazy section that fails to load.
+      CHECK(toml_lazy_error(r));
+      continue;
+    }
+    CHECK(0 == memcmp(&v1, &v2, sizeof(v1)));
+    check_tree(r, v1);
+  }
+}
+
+// Check the keys of r, if it parsed, and free it.
+static void check(const char *name, toml_result_t r) {
+  if (r.ok) {
+    // Lazy sections are loaded as they are reached.
+    check_tree(&r, r.toptab);
+    CHECK(toml_intern(&r, "no such key", 11).ptr == NULL ||
+          ((mem_t *)r.__internal)->lazy);
+  } else if (!r.errmsg[0]) {
+    printf("%s: no error message\n", name);
+    failed();
+  }
+  toml_free(r);
+}
+
+static toml_result_t parse_opt(const char *src, int len, bool lazy,
+                               bool borrow) {
+  toml_option_t opt = toml_default_option();
+  opt.lazy = lazy;
+  opt.borrow_src = borrow;
+  return toml_parse_ex(src, len, &opt);
+}
+
+static toml_result_t push(const char *src, int len, int chunksz) {
+  toml_parser_t *tp = toml_parser_new();
+  for (int i = 0; i < len; i += chunksz) {
+    int n = (len - i < chunksz ? len - i : chunksz);
+    if (toml_parser_feed(tp, src + i, n)) {
+      break;
+    }
+  }
+  return toml_parser_finish(tp);
+}
+
+// Check the keys of src parsed every way there is.
+static void check_all(const char *name, const char *src, int len) {
+  check(name, toml_parse_n(src, len));
+  check(name, parse_opt(src, len, true, false));
+  check(name, parse_opt(src, len, false, true));
+  check(name, push(src, len, 1));
+  check(name, push(src, len, 7));
+  check(name, toml_parse_parallel(src, len, 3));
+
+  toml_context_t *ctx = toml_context_new();
+  CHECK(ctx);
+  check(name, toml_parse_with(ctx, src, len));
+  toml_context_reset(ctx);
+  check(name, toml_parse_with(ctx, src, len));
+  toml_context_free(ctx);
+
+  toml_result_t r1 = toml_parse_n(src, len);
+  if (r1.ok) {
+    toml_result_t r2 = toml_parse_n(src, len);
+    check(name, toml_merge(&r1, &r2));
+    check(name, toml_merge_shared(&r1, &r2));
+    const toml_result_t *layers[] = {&r1, &r2, &r1};
+    check(name, toml_merge_many(layers, 3));
+    CHECK(0 == toml_save_binary(&r1, IMGFILE));
+    toml_free(r2);
+    check(name, toml_load_binary(IMGFILE));
+  }
+  toml_free(r1);
+}
+
+static void test_hosts() {
+  printf("Running test_hosts...\n");
+  static char doc[100000];
+  int len = 0;
+  for (int i = 0; i < 1000; i++) {
+    len += sprintf(doc + len, "[[hosts]]\nname = 'h%d'\naddr = '10.0.0.%d'\n",
+                   i, i % 256);
+    len += sprintf(doc + len, "\"port\" = %d\n", 8000 + i);
+  }
+  check_all("hosts", doc, len);
+
+  // Equal keys are one copy.
+  toml_result_t r = toml_parse(doc, len);
+  CHECK(r.ok);
+  mem_t *mem = (mem_t *)r.__internal;
+  CHECK(mem->keys.u.tab.size == 4);
+  toml_datum_t hosts = toml_get(r.toptab, "hosts");
+  CHECK(hosts.u.arr.size == 1000);
+  toml_datum_t h0 = hosts.u.arr.elem[0];
+  for (int i = 1; i < hosts.u.arr.size; i++) {
+    toml_datum_t h = hosts.u.arr.elem[i];
+    CHECK(h.u.tab.size == 3);
+    for (int j = 0; j < 3; j++) {
+      CHECK(h.u.tab.key[j] == h0.u.tab.key[j]);
+    }
+  }
+  toml_key_t port = toml_intern(&r, "port", 4);
+  CHECK(port.ptr == h0.u.tab.key[2]);
+  CHECK(toml_get_interned(hosts.u.arr.elem[999], port).u.int64 == 8999);
+  toml_free(r);
+}
+
+static void test_spelling() {
+  printf("Running test_spelling...\n");
+  // The same key spelled four ways.
+  const char *doc = "ab = 1\n"
+                    "[t]\n"
+                    "'ab' = 2\n"
+                    "[u]\n"
+                    "\"a\\u0062\" = 3\n"
+                    "[v.\"ab\"]\n";
+  check_all("spelling", doc, strlen(doc));
+  toml_result_t r = toml_parse(doc, strlen(doc));
+  CHECK(r.ok);
+  toml_key_t k = toml_intern(&r, "ab", 2);
+  CHECK(k.ptr && k.ptr == r.toptab.u.tab.key[0]);
+  CHECK(toml_get_interned(toml_get(r.toptab, "t"), k).u.int64 == 2);
+  CHECK(toml_get_interned(toml_get(r.toptab, "u"), k).u.int64 == 3);
+  CHECK(toml_get_interned(toml_get(r.toptab, "v"), k).type == TOML_TABLE);
+  CHECK(toml_get_interned(r.toptab, toml_intern(&r, "abc", 3)).type == 0);
+
+  // A key interned in another result is not found.
+  toml_result_t r2 = toml_parse(doc, strlen(doc));
+  CHECK(toml_get_interned(r.toptab, toml_intern(&r2, "ab", 2)).type == 0);
+  toml_free(r2);
+  toml_free(r);
+}
+
+// A key interned before its section is loaded is the one it loads with.
+static void test_lazy() {
+  printf("Running test_lazy...\n");
+  const char *doc = "[a]\nx = 1\n[b]\ny = 2\n";
+  toml_result_t r = parse_opt(doc, strlen(doc), true, false);
+  CHECK(r.ok);
+  toml_key_t y = toml_intern(&r, "y", 1);
+  CHECK(y.ptr);
+  CHECK(toml_get_interned(toml_get(r.toptab, "b"), y).u.int64 == 2);
+  CHECK(toml_get(r.toptab, "b").u.tab.key[0] == y.ptr);
+  toml_free(r);
+}
+
+// A push parser drops the keys of an expression cut off by a chunk.
+static void test_push() {
+  printf("Running test_push...\n");
+  toml_parser_t *tp = toml_parser_new();
+  toml_datum_t *keys = &tp->parser.mem->keys;
+  CHECK(0 == toml_parser_feed(tp, "a = 1\nx = [\n{ k1 = 1 },\n", 24));
+  CHECK(keys->u.tab.size == 1);
+  CHECK(0 == toml_parser_feed(tp, "{ k2 = 2 }]\n", 12));
+  toml_result_t r = toml_parser_finish(tp);
+  CHECK(r.ok);
+  keys = &((mem_t *)r.__internal)->keys;
+  CHECK(keys->u.tab.size == 4);
+  CHECK(toml_seek(r.toptab, "x").u.arr.size == 2);
+  check("push", r);
+}
+
+int main(int argc, char **argv) {
+  test_hosts();
+  test_spelling();
+  test_lazy();
+  test_push();
+
+  printf("Checking %d files...\n", argc - 1);
+  check_files(argc, argv, check_all);
+
+  // Again, with tables and arrays allocated from arenas.
+  printf("Using arena...\n");
+  toml_option_t opt = toml_default_option();
+  opt.use_arena = true;
+  toml_set_option(opt);
+  test_hosts();
+  test_spelling();
+  test_lazy();
+
+  remove(IMGFILE);
+  printf("All tests completed.\n");
+  return 0;
+}
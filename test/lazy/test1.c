@@ -0,0 +1,185 @@
+#include "../../src/tomlc17.c"
+#include "../common.h"
+
+static toml_result_t parse_lazy_n(const char *src, int len) {
+  toml_option_t save = toml_option;
+  toml_option.lazy = true;
+  toml_result_t r = toml_parse_n(src, len);
+  toml_option = save;
+  return r;
+}
+
+// Load every section of a lazy result.
+static void load_all(toml_result_t r) {
+  for (int i = 0; i < r.toptab.u.tab.size; i++) {
+    toml_get(r.toptab, r.toptab.u.tab.key[i]);
+  }
+}
+
+// A lazy parse must give the same tree as toml_parse_n(). A document
+// that toml_parse_n() rejects fails either up front or on load.
+static void check(const char *name, const char *src, int len) {
+  toml_result_t r1 = toml_parse_n(src, len);
+  toml_result_t r2 = parse_lazy_n(src, len);
+  const char *errmsg = r2.errmsg;
+  if (r2.ok) {
+    load_all(r2);
+    errmsg = toml_lazy_error(&r2);
+    errmsg = errmsg ? errmsg : "";
+  }
+  if (r1.ok != !errmsg[0] || strcmp(r1.errmsg, errmsg)) {
+    printf("%s: '%s' vs '%s'\n", name, r1.errmsg, errmsg);
+    failed();
+  }
+  CHECK(!r1.ok || same(r1.toptab, r2.toptab));
+  toml_free(r1);
+  toml_free(r2);
+}
+
+static void test_sections() {
+  printf("Running test_sections...\n");
+  const char *doc = "title = 'x' # [not a header]\n"
+                    "s = \"\"\"\n"
+                    "[not a header]\"\"\"\n"
+                    "a = [\n"
+                    "  [1, 2],\n"
+                    "  { b = ']' },\n"
+                    "]\n"
+                    "[server.alpha]\n"
+                    "ip = '10.0.0.1'\n"
+                    "[[fruit]]\n"
+                    "name = 'apple'\n"
+                    "  [fruit.color]\n"
+                    "  red = 1\n"
+                    "[server.beta]\n"
+                    "ip = '10.0.0.2'\n"
+                    "[[fruit]]\n"
+                    "name = 'banana'\n"
+                    "[title2.'a.b']\n"
+                    "c = 1";
+  check("sections", doc, strlen(doc));
+
+  toml_result_t r = parse_lazy_n(doc, strlen(doc));
+  CHECK(r.ok);
+  // The root table is parsed; the units are placeholders.
+  CHECK(r.toptab.u.tab.size == 6);
+  CHECK(0 == strcmp(toml_get(r.toptab, "title").u.s, "x"));
+  toml_datum_t server = toml_get(r.toptab, "server");
+  CHECK(server.type == TOML_TABLE && server.u.tab.size == 2);
+  lazy_t *alpha = lazy_of(server.u.tab.value[0]);
+  lazy_t *beta = lazy_of(server.u.tab.value[1]);
+  lazy_t *fruit = lazy_of(r.toptab.u.tab.value[4]);
+  CHECK(alpha && alpha->nsec == 1 && alpha->state == 0);
+  CHECK(beta && beta->nsec == 1 && beta->state == 0);
+  CHECK(fruit && fruit->nsec == 3);
+  CHECK(r.toptab.u.tab.value[4].type == TOML_ARRAY);
+
+  // Only the unit reached is parsed.
+  CHECK(0 == strcmp(toml_seek(r.toptab, "server.beta.ip").u.s, "10.0.0.2"));
+  CHECK(beta->state == 1 && alpha->state == 0 && fruit->state == 0);
+  toml_datum_t arr = toml_get(r.toptab, "fruit");
+  CHECK(arr.type == TOML_ARRAY && arr.u.arr.size == 2);
+  CHECK(toml_seek(arr.u.arr.elem[0], "color.red").u.int64 == 1);
+  CHECK(toml_get(toml_get(r.toptab, "title2"), "a.b").u.tab.size == 1);
+  CHECK(toml_lazy_error(&r) == NULL);
+  toml_free(r);
+
+  // A header of its own makes a table one unit; a table that the root
+  // table reaches into is parsed up front.
+  doc = "a.b.x = 1\n"
+        "[a.b.y]\n"
+        "[a.c.d]\n"
+        "[a.c]\n"
+        "[a.e]\n";
+  check("units", doc, strlen(doc));
+  r = parse_lazy_n(doc, strlen(doc));
+  CHECK(r.ok);
+  toml_datum_t a = toml_get(r.toptab, "a");
+  CHECK(a.u.tab.size == 3);
+  CHECK(!lazy_of(a.u.tab.value[0]) && toml_seek(a, "b.y").type == TOML_TABLE);
+  CHECK(lazy_of(a.u.tab.value[1]) && lazy_of(a.u.tab.value[1])->nsec == 2);
+  CHECK(lazy_of(a.u.tab.value[2]));
+  toml_free(r);
+}
+
+static void test_errors() {
+  printf("Running test_errors...\n");
+  // Header errors are reported up front.
+  const char *doc = "[a]\nx = 1\n[b]\nx = 2\n[a]\n";
+  toml_result_t r = parse_lazy_n(doc, strlen(doc));
+  CHECK(!r.ok);
+  CHECK(0 == strcmp(r.errmsg, "(line 5) table defined more than once"));
+  doc = "[a]\nx = 1\n[b] y = 2\n";
+  r = parse_lazy_n(doc, strlen(doc));
+  CHECK(!r.ok && 0 == strcmp(r.errmsg, "(line 3) ENDL expected"));
+  doc = "a.b = 1\n[a.c]\n[a]\nx = 1\n[a]\n";
+  r = parse_lazy_n(doc, strlen(doc));
+  CHECK(!r.ok);
+  CHECK(0 == strcmp(r.errmsg, "(line 5) table defined more than once"));
+
+  // Errors in a section are reported when it is reached.
+  doc = "[a]\nx = 1\n[b]\ny = 2\ny = 3\n";
+  r = parse_lazy_n(doc, strlen(doc));
+  CHECK(r.ok);
+  CHECK(toml_seek(r.toptab, "a.x").u.int64 == 1);
+  CHECK(toml_lazy_error(&r) == NULL);
+  CHECK(toml_get(r.toptab, "b").type == TOML_UNKNOWN);
+  CHECK(toml_get(r.toptab, "b").type == TOML_UNKNOWN);
+  CHECK(0 == strcmp(toml_lazy_error(&r), "(line 5) duplicate key"));
+  toml_free(r);
+
+  check("errors", doc, strlen(doc));
+  doc = "[a]\nx = [1,\n[b]\n";
+  check("unbalanced", doc, strlen(doc));
+}
+
+// Merge and compare lazy results; both load what they reach.
+static void test_merge() {
+  printf("Running test_merge...\n");
+  const char *doc1 = "[a]\nx = 1\n[[b]]\ny = 1\n";
+  const char *doc2 = "[a]\nz = 2\n[[b]]\ny = 2\n";
+  toml_result_t r1 = parse_lazy_n(doc1, strlen(doc1));
+  toml_result_t r2 = parse_lazy_n(doc2, strlen(doc2));
+  toml_result_t r3 = toml_merge(&r1, &r2);
+  CHECK(r3.ok);
+  CHECK(toml_seek(r3.toptab, "a.x").u.int64 == 1);
+  CHECK(toml_seek(r3.toptab, "a.z").u.int64 == 2);
+  CHECK(toml_get(r3.toptab, "b").u.arr.size == 2);
+
+  toml_result_t r4 = toml_parse_n(doc1, strlen(doc1));
+  CHECK(toml_equiv(&r1, &r4) && !toml_equiv(&r2, &r4));
+  toml_free(r1);
+  toml_free(r2);
+  toml_free(r3);
+  toml_free(r4);
+
+  // A section that fails to load fails the merge.
+  const char *doc5 = "[a]\nx = 1\nx = 2\n";
+  toml_result_t r5 = parse_lazy_n(doc5, strlen(doc5));
+  toml_result_t r6 = parse_lazy_n(doc1, strlen(doc1));
+  toml_result_t r7 = toml_merge(&r6, &r5);
+  CHECK(!r7.ok && 0 == strcmp(r7.errmsg, "(line 3) duplicate key"));
+  toml_free(r5);
+  toml_free(r6);
+}
+
+int main(int argc, char **argv) {
+  test_sections();
+  test_errors();
+  test_merge();
+
+  printf("Checking %d files...\n", argc - 1);
+  check_files(argc, argv, check);
+
+  // Again, with tables and arrays allocated from arenas.
+  printf("Using arena...\n");
+  toml_option_t opt = toml_default_option();
+  opt.use_arena = true;
+  toml_set_option(opt);
+  test_sections();
+  test_errors();
+  test_merge();
+
+  printf("All tests completed.\n");
+  return 0;
+}
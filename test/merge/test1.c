@@ -16,11 +16,19 @@ static void check(const char *doc1, const char *doc2, const char *expected) {
   toml_result_t r1 = toml_parse(doc1, strlen(doc1));
   toml_result_t r2 = toml_parse(doc2, strlen(doc2));
   toml_result_t merged = toml_merge(&r1, &r2);
+  toml_result_t shared = toml_merge_shared(&r1, &r2);
+  const toml_result_t *layers[] = {&r1, &r2};
+  toml_result_t many = toml_merge_many(layers, 2);
   toml_result_t exp = toml_parse(expected, strlen(expected));
   CHECK(toml_equiv(&merged, &exp));
+  CHECK(toml_equiv(&many, &exp));
+  toml_free(many);
   toml_free(r1);
   toml_free(r2);
   toml_free(merged);
+  // The shared result outlives its inputs.
+  CHECK(toml_equiv(&shared, &exp));
+  toml_free(shared);
   toml_free(exp);
 }
 
@@ -157,7 +165,207 @@ static void test_empty_documents() {
   check("", "", "");
 }
 
-int main() {
+// A key and value of r1 that r2 leaves alone are the same pointers in a
+// shared merge; the tables on the paths of r2 are copies.
+static void test_sharing() {
+  printf("Running test_sharing...\n");
+  const char *doc1 = "[a]\n"
+                     "s = 'alpha'\n"
+                     "[b]\n"
+                     "s = 'beta'\n"
+                     "t = [1, 2]\n"
+                     "[b.c]\n"
+                     "u = 1\n"
+                     "[[d]]\n"
+                     "v = 1\n";
+  const char *doc2 = "[b]\n"
+                     "t = [3]\n"
+                     "w = 'new'\n"
+                     "[[d]]\n"
+                     "v = 2\n";
+  toml_result_t r1 = toml_parse(doc1, strlen(doc1));
+  toml_result_t r2 = toml_parse(doc2, strlen(doc2));
+  toml_result_t m = toml_merge_shared(&r1, &r2);
+  CHECK(m.ok);
+  toml_datum_t a1 = toml_get(r1.toptab, "a");
+  toml_datum_t b1 = toml_get(r1.toptab, "b");
+  toml_datum_t a = toml_get(m.toptab, "a");
+  toml_datum_t b = toml_get(m.toptab, "b");
+  CHECK(a.u.tab.value == a1.u.tab.value);
+  CHECK(b.u.tab.value != b1.u.tab.value);
+  CHECK(toml_get(b, "s").u.s == toml_get(b1, "s").u.s);
+  CHECK(toml_get(b, "c").u.tab.value == toml_get(b1, "c").u.tab.value);
+  CHECK(toml_get(b, "t").u.arr.size == 1);
+  CHECK(toml_get(b1, "t").u.arr.size == 2);
+  CHECK(toml_get(b1, "w").type == TOML_UNKNOWN);
+  CHECK(toml_seek(m.toptab, "d").u.arr.size == 2);
+  CHECK(toml_seek(r1.toptab, "d").u.arr.size == 1);
+
+  // One copy of each key, found in r1 or in the result.
+  toml_key_t s = toml_intern(&m, "s", 1);
+  toml_key_t w = toml_intern(&m, "w", 1);
+  CHECK(s.ptr == toml_intern(&r1, "s", 1).ptr);
+  CHECK(w.ptr && w.ptr != toml_get(r2.toptab, "b").u.tab.key[1]);
+  CHECK(toml_get_interned(a, s).u.s == toml_get(a1, "s").u.s);
+  CHECK(toml_get_interned(b, w).type == TOML_STRING);
+
+  // Free the inputs first, then merge onto the result.
+  toml_free(r1);
+  toml_free(r2);
+  const char *doc3 = "[b.c]\nu = 2\n";
+  toml_result_t r3 = toml_parse(doc3, strlen(doc3));
+  toml_result_t m2 = toml_merge_shared(&m, &r3);
+  CHECK(m2.ok && toml_seek(m2.toptab, "b.c.u").u.int64 == 2);
+  CHECK(toml_seek(m.toptab, "b.c.u").u.int64 == 1);
+  CHECK(toml_seek(m2.toptab, "a").u.tab.value == a.u.tab.value);
+  toml_free(m);
+  toml_free(r3);
+
+  // The result freezes and saves as any other.
+  CHECK(0 == toml_freeze(&m2));
+  CHECK(0 == strcmp(toml_seek(m2.toptab, "b.w").u.s, "new"));
+  const char *img = "test1.img";
+  CHECK(0 == toml_save_binary(&m2, img));
+  toml_result_t m3 = toml_load_binary(img);
+  CHECK(toml_equiv(&m2, &m3));
+  toml_free(m3);
+  toml_free(m2);
+  remove(img);
+}
+
+// The result shares sections of r1 that are not loaded yet.
+static void test_sharing_lazy() {
+  printf("Running test_sharing_lazy...\n");
+  const char *doc1 = "[a]\nx = 1\n[b]\ny = 2\n[c]\nz = 3\n";
+  const char *doc2 = "[a]\ny = 4\n";
+  toml_option_t opt = toml_default_option();
+  opt.lazy = true;
+  toml_result_t r1 = toml_parse_ex(doc1, strlen(doc1), &opt);
+  toml_result_t r2 = toml_parse(doc2, strlen(doc2));
+  toml_result_t m = toml_merge_shared(&r1, &r2);
+  CHECK(m.ok);
+  toml_free(r2);
+  // Key y of r2 is the one section b loads with.
+  toml_key_t y = toml_intern(&m, "y", 1);
+  CHECK(toml_get_interned(toml_get(m.toptab, "a"), y).u.int64 == 4);
+  CHECK(toml_get_interned(toml_get(m.toptab, "b"), y).u.int64 == 2);
+  toml_free(r1);
+  CHECK(toml_seek(m.toptab, "c.z").u.int64 == 3);
+  CHECK(toml_seek(m.toptab, "a.x").u.int64 == 1);
+  toml_free(m);
+}
+
+// A frozen table on the path of r2 is copied into an indexed one.
+static void test_sharing_frozen() {
+  printf("Running test_sharing_frozen...\n");
+  static char doc1[1000];
+  int len = sprintf(doc1, "[t]\n");
+  for (int i = 0; i < 40; i++) {
+    len += sprintf(doc1 + len, "k%d = %d\n", i, i);
+  }
+  toml_result_t r1 = toml_parse(doc1, len);
+  CHECK(r1.ok && 0 == toml_freeze(&r1));
+  const char *doc2 = "[t]\nk40 = 40\nk1 = -1\n";
+  toml_result_t r2 = toml_parse(doc2, strlen(doc2));
+  toml_result_t m = toml_merge_shared(&r1, &r2);
+  CHECK(m.ok);
+  toml_datum_t t = toml_get(m.toptab, "t");
+  CHECK(t.u.tab.size == 41 && !tab_meta(&t)->disp);
+  char key[8];
+  for (int i = 0; i <= 40; i++) {
+    sprintf(key, "k%d", i);
+    CHECK(toml_get(t, key).u.int64 == (i == 1 ? -1 : i));
+  }
+  CHECK(toml_seek(r1.toptab, "t.k1").u.int64 == 1);
+  CHECK(toml_seek(r1.toptab, "t.k40").type == TOML_UNKNOWN);
+  toml_free(r1);
+  toml_free(r2);
+  toml_free(m);
+}
+
+// Merge the n documents with toml_merge_many(), and check that the
+// result is the same as merging them in turn with toml_merge().
+static void check_layers(const char **doc, int n) {
+  toml_result_t r[20];
+  const toml_result_t *layers[20];
+  CHECK(n <= 20);
+  for (int i = 0; i < n; i++) {
+    r[i] = toml_parse(doc[i], strlen(doc[i]));
+    CHECK(r[i].ok);
+    layers[i] = &r[i];
+  }
+  toml_result_t many = toml_merge_many(layers, n);
+  CHECK(many.ok);
+  toml_result_t acc = toml_merge_many(layers, 1);
+  CHECK(toml_equiv(&acc, &r[0]));
+  for (int i = 1; i < n; i++) {
+    toml_result_t next = toml_merge(&acc, &r[i]);
+    CHECK(next.ok);
+    toml_free(acc);
+    acc = next;
+  }
+  for (int i = 0; i < n; i++) {
+    toml_free(r[i]);
+  }
+  // The result does not point into the layers.
+  CHECK(toml_equiv(&many, &acc));
+  toml_free(acc);
+  toml_free(many);
+}
+
+static void test_merge_many() {
+  printf("Running test_merge_many...\n");
+  const char *doc[] = {
+      "name = 'defaults'\n"
+      "ports = [80]\n"
+      "[db]\n"
+      "host = 'localhost'\n"
+      "opts = { timeout = 5, retry = 3 }\n"
+      "[[rule]]\n"
+      "id = 1\n",
+      "[db]\n"
+      "host = 'db.region'\n"
+      "opts = { retry = 5 }\n"
+      "[[rule]]\n"
+      "id = 2\n",
+      // db becomes a string, then a table again.
+      "db = 'none'\n"
+      "ports = [443, 8443]\n",
+      "[db]\n"
+      "host = 'db.host'\n"
+      "[cache]\n"
+      "size = 10\n",
+      "rule = []\n"
+      "[cache]\n"
+      "ttl = 60\n",
+      "[[rule]]\n"
+      "id = 3\n"
+      "[cache]\n"
+      "size = 20\n",
+  };
+  int n = sizeof(doc) / sizeof(doc[0]);
+  for (int i = 1; i <= n; i++) {
+    check_layers(doc, i);
+    check_layers(doc + n - i, i);
+  }
+
+  // More layers than fit on the stack.
+  const char *many[20];
+  char buf[20][64];
+  for (int i = 0; i < 20; i++) {
+    sprintf(buf[i], "[t]\nk%d = %d\nlast = %d\n[[a]]\nx = %d\n", i % 7, i,
+            i, i);
+    many[i] = buf[i];
+  }
+  check_layers(many, 20);
+
+  const toml_result_t *none[1] = {0};
+  toml_result_t r = toml_merge_many(none, 0);
+  CHECK(!r.ok && r.errmsg[0]);
+  toml_free(r);
+}
+
+static void run_all() {
   test_simple_merge();
   test_overwrite_values();
   test_nested_tables();
@@ -167,6 +375,28 @@ int main() {
   test_array_of_tables();
   test_type_conflicts();
   test_empty_documents();
+  test_sharing();
+  test_sharing_lazy();
+  test_sharing_frozen();
+  test_merge_many();
+}
+
+int main() {
+  run_all();
+
+  // Again, with tables and arrays allocated from arenas.
+  printf("Using arena...\n");
+  toml_option_t opt = toml_default_option();
+  opt.use_arena = true;
+  toml_set_option(opt);
+  run_all();
+
+  // Again, with strings and keys borrowed from the source text.
+  printf("Borrowing source...\n");
+  opt = toml_default_option();
+  opt.borrow_src = true;
+  toml_set_option(opt);
+  run_all();
 
   printf("All tests completed.\n");
   return 0;
@@ -0,0 +1,221 @@
+#include "../../src/tomlc17.c"
+#include "../common.h"
+
+// An allocator that counts the blocks it has out.
+typedef struct tracker_t tracker_t;
+struct tracker_t {
+  long nlive; // blocks allocated and not freed
+  long ncall; // calls of any kind
+};
+
+static void *track_realloc(void *user, void *ptr, size_t size) {
+  tracker_t *t = (tracker_t *)user;
+  t->ncall++;
+  void *ret = realloc(ptr, size);
+  if (ret && !ptr) {
+    t->nlive++;
+  }
+  return ret;
+}
+
+static void track_free(void *user, void *ptr) {
+  tracker_t *t = (tracker_t *)user;
+  t->ncall++;
+  if (ptr) {
+    t->nlive--;
+  }
+  free(ptr);
+}
+
+static toml_option_t tracked(tracker_t *t) {
+  toml_option_t opt = toml_default_option();
+  opt.mem_realloc_ex = track_realloc;
+  opt.mem_free_ex = track_free;
+  opt.mem_user = t;
+  return opt;
+}
+
+// The global allocator must not be used by toml_parse_ex().
+static long nglobal = 0;
+
+static void *global_realloc(void *ptr, size_t size) {
+  nglobal++;
+  return realloc(ptr, size);
+}
+
+static const char *doc = "title = 'x'\n"
+                         "[server]\n"
+                         "ip = \"10.0.0.1\"\n"
+                         "ports = [8000, 8001, 8002]\n"
+                         "[[fruit]]\n"
+                         "name = 'apple'\n"
+                         "color.red = 1\n"
+                         "[[fruit]]\n"
+                         "name = 'banana'\n"
+                         "when = 1979-05-27T07:32:00Z\n";
+
+// Each result is allocated and released by its own allocator.
+static void test_alloc() {
+  printf("Running test_alloc...\n");
+  tracker_t t1 = {0}, t2 = {0};
+  toml_option_t opt1 = tracked(&t1);
+  toml_option_t opt2 = tracked(&t2);
+  opt2.use_arena = true;
+  toml_result_t r1 = toml_parse_ex(doc, strlen(doc), &opt1);
+  toml_result_t r2 = toml_parse_ex(doc, strlen(doc), &opt2);
+  CHECK(r1.ok && r2.ok);
+  CHECK(t1.nlive > 0 && t2.nlive > 0);
+  CHECK(toml_equiv(&r1, &r2));
+
+  // The merge allocates with the allocator of r1.
+  long n2 = t2.ncall;
+  toml_result_t r3 = toml_merge(&r2, &r1);
+  CHECK(r3.ok && toml_get(r3.toptab, "fruit").u.arr.size == 4);
+  CHECK(t2.ncall > n2);
+  toml_free(r1);
+  CHECK(t1.nlive == 0);
+  toml_free(r2);
+  toml_free(r3);
+  CHECK(t2.nlive == 0);
+
+  // So is a failed parse.
+  const char *bad = "a = 1\na = 2\n";
+  r1 = toml_parse_ex(bad, strlen(bad), &opt1);
+  CHECK(!r1.ok && 0 == strcmp(r1.errmsg, "(line 2) duplicate key"));
+  CHECK(t1.nlive == 0);
+
+  // And a context.
+  toml_context_t *ctx = toml_context_new_ex(&opt1);
+  CHECK(ctx && toml_parse_with(ctx, doc, strlen(doc)).ok);
+  toml_context_free(ctx);
+  CHECK(t1.nlive == 0);
+}
+
+// The other options apply to the call only.
+static void test_options() {
+  printf("Running test_options...\n");
+  toml_option_t opt = toml_default_option();
+  const char *bad_utf8 = "a = \"\xff\"\n";
+  toml_result_t r = toml_parse_ex(bad_utf8, strlen(bad_utf8), &opt);
+  CHECK(r.ok);
+  toml_free(r);
+  opt.check_utf8 = true;
+  r = toml_parse_ex(bad_utf8, strlen(bad_utf8), &opt);
+  CHECK(!r.ok);
+  toml_result_t r2 = toml_parse_n(bad_utf8, strlen(bad_utf8));
+  CHECK(r2.ok);
+  toml_free(r2);
+
+  opt = toml_default_option();
+  opt.borrow_src = true;
+  r = toml_parse_ex(doc, strlen(doc), &opt);
+  CHECK(r.ok);
+  toml_datum_t ip = toml_seek(r.toptab, "server.ip");
+  CHECK(ip.u.str.ptr > doc && ip.u.str.ptr < doc + strlen(doc));
+  toml_free(r);
+
+  opt = toml_default_option();
+  opt.lazy = true;
+  r = toml_parse_ex(doc, strlen(doc), &opt);
+  CHECK(r.ok && lazy_of(toml_get(r.toptab, "fruit")) == NULL);
+  CHECK(((mem_t *)r.__internal)->lazy != NULL);
+  toml_free(r);
+}
+
+// Threads parse with allocators of their own, and not the global one.
+static void *thread_run(void *arg) {
+  toml_option_t opt = tracked((tracker_t *)arg);
+  for (int i = 0; i < 200; i++) {
+    opt.use_arena = (i & 1);
+    toml_result_t r = toml_parse_ex(doc, strlen(doc), &opt);
+    if (!r.ok || toml_seek(r.toptab, "server.ports").u.arr.size != 3) {
+      return arg;
+    }
+    toml_free(r);
+  }
+  return NULL;
+}
+
+static void test_threads() {
+  printf("Running test_threads...\n");
+  toml_option_t save = toml_option;
+  toml_option.mem_realloc = global_realloc;
+  nglobal = 0;
+  tracker_t t[4] = {0};
+  pthread_t tid[4];
+  for (int i = 0; i < 4; i++) {
+    CHECK(0 == pthread_create(&tid[i], NULL, thread_run, &t[i]));
+  }
+  for (int i = 0; i < 4; i++) {
+    void *ret;
+    CHECK(0 == pthread_join(tid[i], &ret) && ret == NULL);
+    CHECK(t[i].ncall > 0 && t[i].nlive == 0);
+  }
+  CHECK(nglobal == 0);
+  toml_option = save;
+}
+
+// Every entry point with options allocates with them alone.
+static void test_entry_points() {
+  printf("Running test_entry_points...\n");
+  toml_option_t save = toml_option;
+  toml_option.mem_realloc = global_realloc;
+  nglobal = 0;
+  tracker_t t = {0};
+  toml_option_t opt = tracked(&t);
+  const char *fname = "test_option.toml";
+  const char *imgname = "test_option.img";
+  FILE *fp = fopen(fname, "w");
+  CHECK(fp && fputs(doc, fp) >= 0 && 0 == fclose(fp));
+
+  fp = fopen(fname, "r");
+  CHECK(fp);
+  toml_result_t r = toml_parse_fp_ex(fp, &opt);
+  fclose(fp);
+  CHECK(r.ok && t.nlive > 0);
+  toml_free(r);
+  CHECK(t.nlive == 0);
+  for (int borrow = 0; borrow < 2; borrow++) {
+    opt.borrow_src = borrow;
+    r = toml_parse_path_ex(fname, &opt);
+    CHECK(r.ok && toml_seek(r.toptab, "server.ports").u.arr.size == 3);
+    toml_free(r);
+    CHECK(t.nlive == 0);
+  }
+  opt.borrow_src = false;
+
+  toml_sax_handler_t handler = {0};
+  r = toml_sax_parse_ex(doc, strlen(doc), &handler, NULL, &opt);
+  CHECK(r.ok && t.ncall > 0 && t.nlive == 0);
+
+  toml_parser_t *tp = toml_parser_new_ex(&opt);
+  CHECK(tp && 0 == toml_parser_feed(tp, doc, strlen(doc)));
+  r = toml_parser_finish(tp);
+  CHECK(r.ok);
+
+  toml_path_t *path = toml_path_compile_ex("fruit[1].name", &opt);
+  CHECK(path && 0 == strcmp(toml_path_eval(r.toptab, path).u.s, "banana"));
+  toml_path_free(path);
+
+  CHECK(0 == toml_save_binary_ex(&r, imgname, &opt));
+  toml_free(r);
+  CHECK(t.nlive == 0);
+  r = toml_load_binary_ex(imgname, &opt);
+  CHECK(r.ok && toml_seek(r.toptab, "server.ports").u.arr.size == 3);
+  toml_free(r);
+  CHECK(t.nlive == 0);
+
+  CHECK(nglobal == 0);
+  toml_option = save;
+  remove(fname);
+  remove(imgname);
+}
+
+int main() {
+  test_alloc();
+  test_options();
+  test_threads();
+  test_entry_points();
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -0,0 +1,165 @@
+#include "../../src/tomlc17.c"
+#include <pthread.h>
+#include "../common.h"
+
+// A parallel parse must give the same result as toml_parse_n(), with
+// any number of threads.
+static void check(const char *name, const char *src, int len) {
+  static const int nthreads[] = {1, 2, 3, 8};
+  toml_result_t r1 = toml_parse_n(src, len);
+  for (int i = 0; i < (int)(sizeof(nthreads) / sizeof(nthreads[0])); i++) {
+    toml_result_t r2 = toml_parse_parallel(src, len, nthreads[i]);
+    if (r1.ok != r2.ok || strcmp(r1.errmsg, r2.errmsg)) {
+      printf("%s (%d threads): '%s' vs '%s'\n", name, nthreads[i],
+             r1.errmsg, r2.errmsg);
+      failed();
+    }
+    CHECK(!r1.ok || same(r1.toptab, r2.toptab));
+    toml_free(r2);
+  }
+  toml_free(r1);
+}
+
+// Strings may be borrowed from the source, and not NUL terminated.
+static bool streq(toml_datum_t d, const char *s) {
+  return d.type == TOML_STRING && d.u.str.len == (int)strlen(s) &&
+         0 == memcmp(d.u.str.ptr, s, d.u.str.len);
+}
+
+static void test_units() {
+  printf("Running test_units...\n");
+  const char *doc = "title = 'x'\n"
+                    "a.b.x = 1\n"
+                    "[a.b.y]\n"
+                    "[server.alpha]\n"
+                    "ip = '10.0.0.1'\n"
+                    "[[fruit]]\n"
+                    "name = 'apple'\n"
+                    "  [fruit.color]\n"
+                    "  red = 1\n"
+                    "[server.beta]\n"
+                    "ip = '10.0.0.2'\n"
+                    "[[fruit]]\n"
+                    "name = 'banana'\n"
+                    "[a.c]\n"
+                    "z = [\n"
+                    "  1, # ]\n"
+                    "]\n";
+  check("units", doc, strlen(doc));
+
+  toml_result_t r = toml_parse_parallel(doc, strlen(doc), 4);
+  CHECK(r.ok);
+  CHECK(streq(toml_seek(r.toptab, "server.beta.ip"), "10.0.0.2"));
+  toml_datum_t fruit = toml_get(r.toptab, "fruit");
+  CHECK(fruit.u.arr.size == 2);
+  CHECK(fruit.u.arr.elem[0].u.tab.value[1].u.tab.value[0].u.int64 == 1);
+  toml_free(r);
+}
+
+static void test_errors() {
+  printf("Running test_errors...\n");
+  // Whichever unit fails, the error on the first line is reported.
+  const char *doc = "[a]\nx = 1\n[b]\ny = 2\ny = 3\n[c]\nz = 1\nz = 2\n";
+  check("errors", doc, strlen(doc));
+  doc = "[a]\nx = 1\n[b] y = 2\n";
+  check("header", doc, strlen(doc));
+}
+
+// A big array of tables is parsed in pieces by several threads, and a
+// big document of many units too.
+static void test_big() {
+  printf("Running test_big...\n");
+  int max = 8 << 20;
+  char *src = malloc(max);
+  CHECK(src);
+  int len = sprintf(src, "top = 1\n");
+  for (int i = 0; i < 30000; i++) {
+    len += sprintf(src + len, "[[item]]\nid = %d\n[item.sub]\ns = 'v%d'\n", i,
+                   i);
+  }
+  check("big array", src, len);
+  toml_result_t r = toml_parse_parallel(src, len, 4);
+  CHECK(r.ok);
+  toml_datum_t item = toml_get(r.toptab, "item");
+  CHECK(item.u.arr.size == 30000);
+  CHECK(toml_get(item.u.arr.elem[29999], "id").u.int64 == 29999);
+  CHECK(streq(toml_seek(item.u.arr.elem[5], "sub.s"), "v5"));
+  toml_free(r);
+
+  len = 0;
+  for (int i = 0; i < 20000; i++) {
+    len += sprintf(src + len, "[svc.s%d]\nport = %d\n", i, i);
+  }
+  len += sprintf(src + len, "[svc.s17]\n");
+  check("big redefined", src, len);
+  len -= strlen("[svc.s17]\n");
+  len += sprintf(src + len, "[svc.s19999.x]\ny = [1, 2\n");
+  check("big unterminated", src, len);
+  free(src);
+}
+
+// Count the calls of the allocator passed to toml_parse_parallel_ex(),
+// which the workers share.
+static pthread_mutex_t nalloc_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *counting_realloc(void *user, void *ptr, size_t size) {
+  pthread_mutex_lock(&nalloc_mutex);
+  ++*(int *)user;
+  pthread_mutex_unlock(&nalloc_mutex);
+  return realloc(ptr, size);
+}
+
+static void counting_free(void *user, void *ptr) {
+  (void)user;
+  free(ptr);
+}
+
+static void test_option() {
+  printf("Running test_option...\n");
+  static char src[200000];
+  int len = 0;
+  for (int i = 0; i < 5000; i++) {
+    len += sprintf(src + len, "[t%d]\nx = %d\n", i, i);
+  }
+  int nalloc = 0;
+  toml_option_t opt = toml_default_option();
+  opt.mem_realloc_ex = counting_realloc;
+  opt.mem_free_ex = counting_free;
+  opt.mem_user = &nalloc;
+  toml_result_t r1 = toml_parse_n(src, len);
+  toml_result_t r2 = toml_parse_parallel_ex(src, len, 3, &opt);
+  CHECK(r2.ok && same(r1.toptab, r2.toptab));
+  CHECK(nalloc > 0);
+  toml_free(r2);
+  toml_free(r1);
+}
+
+int main(int argc, char **argv) {
+  test_units();
+  test_errors();
+  test_big();
+  test_option();
+
+  printf("Checking %d files...\n", argc - 1);
+  check_files(argc, argv, check);
+
+  // Again, with tables and arrays allocated from arenas.
+  printf("Using arena...\n");
+  toml_option_t opt = toml_default_option();
+  opt.use_arena = true;
+  toml_set_option(opt);
+  test_units();
+  test_errors();
+  test_big();
+
+  // Again, with strings borrowed from the source.
+  printf("Using borrow_src...\n");
+  opt.use_arena = false;
+  opt.borrow_src = true;
+  toml_set_option(opt);
+  test_units();
+  test_big();
+
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -0,0 +1,209 @@
+#include "../../src/tomlc17.c"
+#include "../common.h"
+
+// Compile and evaluate path against d.
+static toml_datum_t eval(toml_datum_t d, const char *path) {
+  toml_path_t *cp = toml_path_compile(path);
+  CHECK(cp);
+  toml_datum_t ret = toml_path_eval(d, cp);
+  toml_path_free(cp);
+  return ret;
+}
+
+static bool streq(toml_datum_t d, const char *s) {
+  return d.type == TOML_STRING && 0 == strcmp(d.u.s, s);
+}
+
+static void test_syntax() {
+  printf("Running test_syntax...\n");
+  static const char *const bad[] = {
+      ".",     "a.",    ".a",     "a..b",    "a b",    "a[",      "a[]",
+      "a[x]",  "a[1",   "a[0]b",  "a.[0]",   "\"a",    "'a",      "\"\\x\"",
+      "\"\\u12\"", "\"\\uD800\"", "a[2147483648]", "a.b c",
+  };
+  for (int i = 0; i < (int)(sizeof(bad) / sizeof(bad[0])); i++) {
+    if (toml_path_compile(bad[i])) {
+      printf("compiled: %s\n", bad[i]);
+      failed();
+    }
+  }
+  static const char *const good[] = {
+      "", "a", "a.b-c_9", "\"\"", "''", "a[0]", "[0][1].x", "a[2147483647]",
+      "'a.b'.\"c\\\"d\".e", "\"\\u00e9\\U0001F600\"",
+  };
+  for (int i = 0; i < (int)(sizeof(good) / sizeof(good[0])); i++) {
+    toml_path_t *cp = toml_path_compile(good[i]);
+    CHECK(cp);
+    toml_path_free(cp);
+  }
+  toml_path_free(NULL);
+}
+
+static void test_eval() {
+  printf("Running test_eval...\n");
+  const char *doc = "title = 'x'\n"
+                    "'a.b' = 1\n"
+                    "\"\" = 2\n"
+                    "\"\xc3\xa9\" = 3\n"
+                    "[server]\n"
+                    "ports = [8000, [1, 2]]\n"
+                    "[server.\"web.1\"]\n"
+                    "ip = '10.0.0.1'\n"
+                    "[[fruit]]\n"
+                    "name = 'apple'\n"
+                    "[[fruit]]\n"
+                    "name = 'banana'\n";
+  toml_result_t r = toml_parse(doc, strlen(doc));
+  CHECK(r.ok);
+  toml_datum_t top = r.toptab;
+  CHECK(streq(eval(top, "title"), "x"));
+  CHECK(eval(top, "'a.b'").u.int64 == 1);
+  CHECK(eval(top, "a.b").type == TOML_UNKNOWN);
+  CHECK(eval(top, "\"\"").u.int64 == 2);
+  CHECK(eval(top, "\"\\u00e9\"").u.int64 == 3);
+  CHECK(eval(top, "").type == TOML_TABLE);
+  CHECK(eval(top, "server.ports[0]").u.int64 == 8000);
+  CHECK(eval(top, "server.ports[1][1]").u.int64 == 2);
+  CHECK(eval(top, "server.ports[2]").type == TOML_UNKNOWN);
+  CHECK(eval(top, "server.ports.x").type == TOML_UNKNOWN);
+  CHECK(eval(top, "title[0]").type == TOML_UNKNOWN);
+  CHECK(streq(eval(top, "server.\"web.1\".ip"), "10.0.0.1"));
+  CHECK(streq(eval(top, "server.'web.1'.ip"), "10.0.0.1"));
+  CHECK(streq(eval(top, "fruit[1].name"), "banana"));
+  CHECK(streq(eval(eval(top, "fruit"), "[0].name"), "apple"));
+  toml_free(r);
+}
+
+// Tables big enough to be indexed, and a path longer than toml_seek()
+// used to allow.
+static void test_big() {
+  printf("Running test_big...\n");
+  static char doc[40000];
+  char path[1000];
+  int len = 0;
+  int plen = 0;
+  for (int i = 0; i < 8; i++) {
+    plen += sprintf(path + plen, "%sa_rather_long_key_%d", i ? "." : "", i);
+  }
+  len += sprintf(doc + len, "%s = 7\n", path);
+  for (int i = 0; i < 40; i++) {
+    len += sprintf(doc + len, "[t%d]\n", i);
+    for (int j = 0; j < 40; j++) {
+      len += sprintf(doc + len, "k%d = %d\n", j, i * 100 + j);
+    }
+  }
+  toml_result_t r = toml_parse(doc, len);
+  CHECK(r.ok);
+  for (int i = 0; i < 40; i++) {
+    for (int j = 0; j < 40; j++) {
+      char key[32];
+      snprintf(key, sizeof(key), "t%d.k%d", i, j);
+      CHECK(eval(r.toptab, key).u.int64 == i * 100 + j);
+      CHECK(toml_seek(r.toptab, key).u.int64 == i * 100 + j);
+    }
+  }
+  CHECK(eval(r.toptab, "t39.k40").type == TOML_UNKNOWN);
+  CHECK(plen > 127);
+  CHECK(eval(r.toptab, path).u.int64 == 7);
+  CHECK(toml_seek(r.toptab, path).u.int64 == 7);
+  toml_free(r);
+}
+
+// toml_get_n() and toml_get_h() on small and indexed tables.
+static void test_get() {
+  printf("Running test_get...\n");
+  static char doc[20000];
+  int len = sprintf(doc, "small = {a = 1, ab = 2, \"a\\u0000b\" = 3}\n");
+  len += sprintf(doc + len, "[big]\n");
+  for (int i = 0; i < 200; i++) {
+    len += sprintf(doc + len, "key%d = %d\n", i, i);
+  }
+  toml_result_t r = toml_parse(doc, len);
+  CHECK(r.ok);
+
+  toml_datum_t small = toml_get(r.toptab, "small");
+  CHECK(toml_get_n(small, "abc", 1).u.int64 == 1);
+  CHECK(toml_get_n(small, "abc", 2).u.int64 == 2);
+  CHECK(toml_get_n(small, "a\0b", 3).u.int64 == 3);
+  CHECK(toml_get_n(small, "abc", 3).type == TOML_UNKNOWN);
+  CHECK(toml_get_h(small, "ab", 2, toml_hash("ab", 2)).u.int64 == 2);
+  CHECK(toml_get_n(toml_get(small, "a"), "a", 1).type == TOML_UNKNOWN);
+
+  toml_datum_t big = toml_get(r.toptab, "big");
+  CHECK(tab_meta(&big)->nslot > 0);
+  for (int i = 0; i < 200; i++) {
+    char key[32];
+    int n = snprintf(key, sizeof(key), "key%d", i);
+    uint32_t h = toml_hash(key, n);
+    CHECK(toml_get_n(big, key, n).u.int64 == i);
+    CHECK(toml_get_h(big, key, n, h).u.int64 == i);
+    // A wrong hash finds nothing in an indexed table.
+    CHECK(toml_get_h(big, key, n, h + 1).type == TOML_UNKNOWN);
+  }
+  CHECK(toml_get_n(big, "key1999", 7).type == TOML_UNKNOWN);
+  CHECK(toml_get_n(big, "key1999", 6).u.int64 == 199);
+  toml_free(r);
+}
+
+// Every key reachable in a document is found through a path of quoted
+// keys and indices.
+static void walk(toml_datum_t top, toml_datum_t d, char *path, int len) {
+  CHECK(len < 900);
+  toml_path_t *cp = toml_path_compile(path);
+  CHECK(cp);
+  toml_datum_t got = toml_path_eval(top, cp);
+  toml_path_free(cp);
+  CHECK(got.type == d.type);
+  if (d.type == TOML_TABLE) {
+    CHECK(got.u.tab.key == d.u.tab.key);
+    for (int i = 0; i < d.u.tab.size; i++) {
+      const char *key = d.u.tab.key[i];
+      if (memchr(key, 0, d.u.tab.len[i]) || strchr(key, '\'') ||
+          d.u.tab.len[i] > 100) {
+        continue;
+      }
+      int n = sprintf(path + len, "%s'%s'", len ? "." : "", key);
+      walk(top, toml_get(d, key), path, len + n);
+    }
+  } else if (d.type == TOML_ARRAY) {
+    CHECK(got.u.arr.elem == d.u.arr.elem);
+    for (int i = 0; i < d.u.arr.size; i++) {
+      int n = sprintf(path + len, "[%d]", i);
+      walk(top, d.u.arr.elem[i], path, len + n);
+    }
+  }
+  path[len] = 0;
+}
+
+static void check_file(const char *fname) {
+  toml_result_t r = toml_parse_file_ex(fname);
+  if (r.ok) {
+    char path[1000] = {0};
+    walk(r.toptab, r.toptab, path, 0);
+  }
+  toml_free(r);
+}
+
+int main(int argc, char **argv) {
+  test_syntax();
+  test_eval();
+  test_big();
+  test_get();
+
+  printf("Checking %d files...\n", argc - 1);
+  for (int i = 1; i < argc; i++) {
+    check_file(argv[i]);
+  }
+
+  // Again, with lazy sections.
+  printf("Using lazy...\n");
+  toml_option_t opt = toml_default_option();
+  opt.lazy = true;
+  toml_set_option(opt);
+  test_eval();
+  test_big();
+  test_get();
+
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -0,0 +1,128 @@
+#include "../../src/tomlc17.c"
+#include <inttypes.h>
+#include "../common.h"
+
+// Feed src[] to a push parser in chunks of chunksz bytes.
+static toml_result_t push(const char *src, int len, int chunksz) {
+  toml_parser_t *tp = toml_parser_new();
+  for (int i = 0; i < len; i += chunksz) {
+    int n = (len - i < chunksz ? len - i : chunksz);
+    if (toml_parser_feed(tp, src + i, n)) {
+      break;
+    }
+  }
+  return toml_parser_finish(tp);
+}
+
+// The push parser must give the same result as toml_parse_n(), however
+// the input is chunked.
+static void check(const char *name, const char *src, int len) {
+  static const int chunksz[] = {1, 2, 3, 7, 64, 4096};
+  toml_result_t r1 = toml_parse_n(src, len);
+  for (int i = 0; i < (int)(sizeof(chunksz) / sizeof(chunksz[0])); i++) {
+    toml_result_t r2 = push(src, len, chunksz[i]);
+    if (r1.ok != r2.ok || strcmp(r1.errmsg, r2.errmsg)) {
+      printf("%s (chunk %d): '%s' vs '%s'\n", name, chunksz[i], r1.errmsg,
+             r2.errmsg);
+      failed();
+    }
+    CHECK(!r1.ok || same(r1.toptab, r2.toptab));
+    toml_free(r2);
+  }
+  toml_free(r1);
+}
+
+static void test_split() {
+  printf("Running test_split...\n");
+  const char *doc = "# comment\n"
+                    "a = \"\"\"multi\n"
+                    "line\"\"\"\n"
+                    "b = [\n"
+                    "  1, 2, # c\n"
+                    "  3.5e2,\n"
+                    "]\n"
+                    "[t]\r\n"
+                    "s = 'caf\xc3\xa9'\n"
+                    "[[arr]]\n"
+                    "x = {y = 1979-05-27T07:32:00Z}\n"
+                    "last = true"; // no newline at the end
+  check("split", doc, strlen(doc));
+
+  toml_result_t r = push(doc, strlen(doc), 1);
+  CHECK(r.ok);
+  CHECK(toml_seek(r.toptab, "b").u.arr.size == 3);
+  CHECK(0 == strcmp(toml_seek(r.toptab, "t.s").u.s, "caf\xc3\xa9"));
+  toml_datum_t arr = toml_get(r.toptab, "arr");
+  CHECK(arr.u.arr.size == 1 && toml_get(arr.u.arr.elem[0], "last").u.boolean);
+  toml_free(r);
+}
+
+static void test_errors() {
+  printf("Running test_errors...\n");
+  const char *doc = "a = 1\nb = [1,\n2\nc = 3\n";
+  check("errors", doc, strlen(doc));
+
+  // The error is reported as soon as its line is complete.
+  toml_parser_t *tp = toml_parser_new();
+  CHECK(0 == toml_parser_feed(tp, "a = 1\na = ", 10));
+  CHECK(-1 == toml_parser_feed(tp, "2\n", 2));
+  CHECK(-1 == toml_parser_feed(tp, "b = 3\n", 6));
+  toml_result_t r = toml_parser_finish(tp);
+  CHECK(!r.ok);
+  CHECK(0 == strcmp(r.errmsg, "(line 2) duplicate key"));
+
+  // An unterminated string is only an error at the end.
+  const char *doc2 = "a = '''x\n\n";
+  check("unterminated", doc2, strlen(doc2));
+}
+
+// Feed a big array one line at a time; each feed only keeps the tail.
+static void test_big_array() {
+  printf("Running test_big_array...\n");
+  toml_parser_t *tp = toml_parser_new();
+  char line[100];
+  CHECK(0 == toml_parser_feed(tp, "x = [\n", 6));
+  for (int i = 0; i < 100000; i++) {
+    int n = snprintf(line, sizeof(line), "%d,\n", i);
+    CHECK(0 == toml_parser_feed(tp, line, n));
+  }
+  CHECK(0 == toml_parser_feed(tp, "]\n", 2));
+  toml_result_t r = toml_parser_finish(tp);
+  CHECK(r.ok);
+  toml_datum_t x = toml_get(r.toptab, "x");
+  CHECK(x.u.arr.size == 100000 && x.u.arr.elem[99999].u.int64 == 99999);
+  toml_free(r);
+}
+
+// Finish with nothing fed, or with only comments and blank lines.
+static void test_empty() {
+  printf("Running test_empty...\n");
+  toml_result_t r = toml_parser_finish(toml_parser_new());
+  CHECK(r.ok && r.toptab.u.tab.size == 0);
+  toml_free(r);
+
+  const char *doc = "# comment\n\n  \n# another";
+  check("empty", doc, strlen(doc));
+  check("empty", "", 0);
+}
+
+int main(int argc, char **argv) {
+  test_split();
+  test_errors();
+  test_big_array();
+  test_empty();
+
+  printf("Checking %d files...\n", argc - 1);
+  check_files(argc, argv, check);
+
+  // Again, with tables and arrays allocated from arenas.
+  printf("Using arena...\n");
+  toml_option_t opt = toml_default_option();
+  opt.use_arena = true;
+  toml_set_option(opt);
+  test_split();
+  test_errors();
+
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -0,0 +1,207 @@
+#include "../../src/tomlc17.c"
+#include <inttypes.h>
+#include "../common.h"
+
+// Event trace, e.g. "K(a.b) V(1) [ V(x) ] T(t) { K(c) V(true) }"
+typedef struct trace_t trace_t;
+struct trace_t {
+  char buf[2000];
+  int len;
+  int nscalar; // #value events
+  int depth;   // open arrays and inline tables
+  int stopat;  // stop the parse at this event if > 0
+  int nevent;
+};
+
+static int emit(trace_t *t, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(t->buf + t->len, sizeof(t->buf) - t->len, fmt, args);
+  va_end(args);
+  if (n > 0 && t->len + n < (int)sizeof(t->buf)) {
+    t->len += n;
+  }
+  return ++t->nevent == t->stopat;
+}
+
+static int emit_key(trace_t *t, const char *tag, int nkey,
+                    const char *const *key, const int *len) {
+  emit(t, "%s(", tag);
+  for (int i = 0; i < nkey; i++) {
+    emit(t, "%s%.*s", i ? "." : "", len[i], key[i]);
+  }
+  t->nevent -= nkey + 1; // count the whole key as one event
+  return emit(t, ") ");
+}
+
+static int on_table(void *ctx, int nkey, const char *const *key,
+                    const int *len) {
+  return emit_key(ctx, "T", nkey, key, len);
+}
+
+static int on_array_table(void *ctx, int nkey, const char *const *key,
+                          const int *len) {
+  return emit_key(ctx, "AT", nkey, key, len);
+}
+
+static int on_key(void *ctx, int nkey, const char *const *key,
+                  const int *len) {
+  return emit_key(ctx, "K", nkey, key, len);
+}
+
+static int on_value(void *ctx, toml_datum_t v) {
+  trace_t *t = ctx;
+  t->nscalar++;
+  switch (v.type) {
+  case TOML_STRING:
+    return emit(t, "V(%.*s) ", v.u.str.len, v.u.str.ptr);
+  case TOML_INT64:
+    return emit(t, "V(%" PRId64 ") ", v.u.int64);
+  case TOML_FP64:
+    return emit(t, "V(%g) ", v.u.fp64);
+  case TOML_BOOLEAN:
+    return emit(t, "V(%s) ", v.u.boolean ? "true" : "false");
+  case TOML_DATE:
+    return emit(t, "V(%04d-%02d-%02d) ", v.u.ts.year, v.u.ts.month,
+                v.u.ts.day);
+  default:
+    return emit(t, "V(type %d) ", v.type);
+  }
+}
+
+static int on_array_begin(void *ctx) {
+  ((trace_t *)ctx)->depth++;
+  return emit(ctx, "[ ");
+}
+
+static int on_array_end(void *ctx) {
+  ((trace_t *)ctx)->depth--;
+  return emit(ctx, "] ");
+}
+
+static int on_table_begin(void *ctx) {
+  ((trace_t *)ctx)->depth++;
+  return emit(ctx, "{ ");
+}
+
+static int on_table_end(void *ctx) {
+  ((trace_t *)ctx)->depth--;
+  return emit(ctx, "} ");
+}
+
+static const toml_sax_handler_t handler = {
+    on_table,       on_array_table, on_key,         on_value,
+    on_array_begin, on_array_end,   on_table_begin, on_table_end,
+};
+
+// Parse doc with the SAX API; check the trace and the error message.
+static void check(const char *doc, const char *expected, const char *errmsg) {
+  trace_t t = {0};
+  toml_result_t result = toml_sax_parse(doc, strlen(doc), &handler, &t);
+  if (strcmp(t.buf, expected)) {
+    printf("expected: '%s'\n     got: '%s'\n", expected, t.buf);
+    failed();
+  }
+  CHECK(result.ok == (errmsg == 0));
+  CHECK(result.ok || 0 == strcmp(result.errmsg, errmsg));
+  CHECK(result.toptab.type == TOML_TABLE && result.toptab.u.tab.size == 0);
+}
+
+static void test_events() {
+  printf("Running test_events...\n");
+  check("a = 1\n"
+        "b.c = 'x'\n"
+        "[t.u]\n"
+        "d = [1, [2.5], {e = true}]\n"
+        "[[arr]]\n"
+        "f = \"a\\tb\"\n"
+        "[[arr]]\n"
+        "g = {h.i = 2024-01-02}\n",
+        "K(a) V(1) K(b.c) V(x) T(t.u) K(d) [ V(1) [ V(2.5) ] { K(e) V(true) "
+        "} ] AT(arr) K(f) V(a\tb) AT(arr) K(g) { K(h.i) V(2024-01-02) } ",
+        0);
+}
+
+static void test_errors() {
+  printf("Running test_errors...\n");
+  // Duplicate keys and redefined tables are still caught.
+  check("a = 1\na = 2\n", "K(a) V(1) K(a) V(2) ", "(line 2) duplicate key");
+  check("[t]\n[t]\n", "T(t) ", "(line 2) table defined more than once");
+  check("a = {b = 1}\n[a]\n", "K(a) { K(b) V(1) } ",
+        "(line 2) table defined more than once");
+  // Only the last element of an array of tables is kept; it is still
+  // the one that a sub-table extends.
+  check("[[a]]\nx = 1\n[[a]]\n[a.b]\n[a.b]\n", "AT(a) K(x) V(1) AT(a) T(a.b) ",
+        "(line 5) table defined more than once");
+  check("[[a]]\n[a.b]\n[[a]]\n[a.b]\n", "AT(a) T(a.b) AT(a) T(a.b) ", 0);
+}
+
+static void test_stop() {
+  printf("Running test_stop...\n");
+  trace_t t = {0};
+  t.stopat = 2;
+  const char *doc = "a = 1\nb = 2\n";
+  toml_result_t result = toml_sax_parse(doc, strlen(doc), &handler, &t);
+  CHECK(!result.ok);
+  CHECK(0 == strcmp(result.errmsg, "(line 1) stopped by handler"));
+  CHECK(0 == strcmp(t.buf, "K(a) V(1) "));
+}
+
+// Count the scalars in a tree.
+static int count_scalars(toml_datum_t d) {
+  int n = 0;
+  if (d.type == TOML_TABLE) {
+    for (int i = 0; i < d.u.tab.size; i++) {
+      n += count_scalars(d.u.tab.value[i]);
+    }
+  } else if (d.type == TOML_ARRAY) {
+    for (int i = 0; i < d.u.arr.size; i++) {
+      n += count_scalars(d.u.arr.elem[i]);
+    }
+  } else {
+    n = 1;
+  }
+  return n;
+}
+
+// The SAX parse of a file must agree with toml_parse_n() on errors and
+// see every scalar of the tree.
+static void check_file(const char *fname) {
+  int len;
+  const char *src = read_file(fname, &len);
+
+  toml_result_t r1 = toml_parse_n(src, len);
+  trace_t t = {0};
+  toml_result_t r2 = toml_sax_parse(src, len, &handler, &t);
+  if (r1.ok != r2.ok || strcmp(r1.errmsg, r2.errmsg)) {
+    printf("%s: '%s' vs '%s'\n", fname, r1.errmsg, r2.errmsg);
+    failed();
+  }
+  if (r1.ok) {
+    CHECK(t.depth == 0);
+    CHECK(t.nscalar == count_scalars(r1.toptab));
+  }
+  toml_free(r1);
+}
+
+int main(int argc, char **argv) {
+  test_events();
+  test_errors();
+  test_stop();
+
+  printf("Checking %d files...\n", argc - 1);
+  for (int i = 1; i < argc; i++) {
+    check_file(argv[i]);
+  }
+
+  // Again, with tables and arrays allocated from arenas.
+  printf("Using arena...\n");
+  toml_option_t opt = toml_default_option();
+  opt.use_arena = true;
+  toml_set_option(opt);
+  test_events();
+  test_errors();
+
+  printf("All tests completed.\n");
+  return 0;
+}
@@ -103,7 +103,7 @@ int main(int argc, const char *argv[]) {
 
   scanner_t scanner;
   scanner_t *sp = &scanner;
-  scan_init(sp, content, len, errbuf, sizeof(errbuf));
+  scan_init(sp, content, len, errbuf, sizeof(errbuf), false);
 
   for (;;) {
     (void)scan_value; // silent compiler